@@ -22,7 +22,24 @@
 
 #include <cabac/encoder.h>
 #include <cabac/decoder.h>
+#include <cabac/bounded.h>
+#include <cabac/wide.h>
+#include <cabac/split.h>
+#include <cabac/sparse.h>
 #include <cabac/counting.h>
 #include <cabac/integer.h>
+#include <cabac/binarization.h>
+#include <cabac/array.h>
+#include <cabac/rate.h>
+#include <cabac/residual.h>
+#include <cabac/bilevel.h>
+#include <cabac/dispatch.h>
+#include <cabac/trace.h>
+#include <cabac/metrics.h>
+#include <cabac/packet.h>
+#include <cabac/training.h>
+#include <cabac/model.h>
+#include <cabac/append.h>
+#include <cabac/seek.h>
 
 #endif
@@ -0,0 +1,78 @@
+//
+// This file is part of libcabac.
+//
+// Copyright 2008 Johannes Ballé <balle@ient.rwth-aachen.de>
+//
+// libcabac is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libcabac is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libcabac.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef _OHTU7AY3EI_CABAC_APPEND_H
+#define _OHTU7AY3EI_CABAC_APPEND_H 1
+
+#include <cabac/encoder.h>
+#include <iosfwd>
+
+namespace cabac {
+
+/**
+ * @file
+ * Appending to an encoded bitstream.
+ *
+ * An encoder can be resumed from a state saved with encoder::save(). Saving the state right before
+ * destroying the encoder allows to continue the bitstream later, as if it had been written in one pass:
+ *
+ * @code
+ * cabac::encoder_state tail;
+ * {
+ *   cabac::encoder< iter_type > enc( iter_type( bs ), initial_states );
+ *   enc.encode( ... );
+ *   enc.save( tail );
+ * } // the bitstream is terminated and can be decoded
+ * cabac::write_encoder_state( tail_file, tail );
+ *
+ * // later
+ * cabac::read_encoder_state( tail_file, tail );
+ * bs.resize( tail.bytes ); // discard the termination
+ * {
+ *   cabac::encoder< iter_type > enc( iter_type( bs ), tail );
+ *   enc.encode( ... ); // continue from here
+ *   enc.save( tail );
+ * }
+ * @endcode
+ *
+ * The first tail.bytes bytes of the bitstream are final, only the termination written by the destructor
+ * after them is discarded. Hence, the cost of an append is independent of the length of the bitstream,
+ * apart from reading and writing the context states.
+ */
+
+/**
+ * Write an encoder state to a binary file.
+ *
+ * @param os the output stream, opened in binary mode
+ * @param state the encoder state
+ */
+void write_encoder_state( ::std::ostream &os, const encoder_state &state );
+
+/**
+ * Read an encoder state from a binary file.
+ *
+ * @param is the input stream, opened in binary mode
+ * @param state receives the encoder state
+ * @return true on success, false if the stream does not contain a valid encoder state
+ */
+bool read_encoder_state( ::std::istream &is, encoder_state &state );
+
+}
+
+#endif
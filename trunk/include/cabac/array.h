@@ -0,0 +1,237 @@
+//
+// This file is part of libcabac.
+//
+// Copyright 2008 Johannes Ballé <balle@ient.rwth-aachen.de>
+//
+// libcabac is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libcabac is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libcabac.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef _OHTU7AY3EI_CABAC_ARRAY_H
+#define _OHTU7AY3EI_CABAC_ARRAY_H 1
+
+#include <cabac/integer.h>
+#include <cstddef>
+#if defined( __SSE2__ )
+# include <emmintrin.h>
+#endif
+
+namespace cabac {
+
+namespace impl {
+
+/**
+ * @internal Map signed to unsigned integers as done by encode_seg, i.e. 0, -1, 1, -2, 2, ... to 0, 1, 2, 3, 4, ...
+ */
+inline void zigzag( const signed int *values, unsigned int *mapped, const ::std::size_t num ) {
+  ::std::size_t i = 0;
+#if defined( __SSE2__ )
+  for ( ; i + 4 <= num; i += 4 ) {
+    const __m128i v = _mm_loadu_si128( reinterpret_cast< const __m128i* >( values + i ) );
+    _mm_storeu_si128( reinterpret_cast< __m128i* >( mapped + i ), _mm_xor_si128( _mm_slli_epi32( v, 1 ), _mm_srai_epi32( v, 31 ) ) );
+  }
+#endif
+  for ( ; i < num; ++i )
+    mapped[ i ] = ( static_cast< unsigned int >( values[ i ] ) << 1 ) ^ static_cast< unsigned int >( values[ i ] >> 31 );
+}
+
+/**
+ * @internal Inverse of zigzag, in place.
+ */
+inline void unzigzag( signed int *values, const ::std::size_t num ) {
+  ::std::size_t i = 0;
+#if defined( __SSE2__ )
+  const __m128i one = _mm_set1_epi32( 1 );
+  for ( ; i + 4 <= num; i += 4 ) {
+    const __m128i v = _mm_loadu_si128( reinterpret_cast< const __m128i* >( values + i ) );
+    const __m128i sign = _mm_sub_epi32( _mm_setzero_si128(), _mm_and_si128( v, one ) );
+    _mm_storeu_si128( reinterpret_cast< __m128i* >( values + i ), _mm_xor_si128( _mm_srli_epi32( v, 1 ), sign ) );
+  }
+#endif
+  for ( ; i < num; ++i ) {
+    const unsigned int v = values[ i ];
+    values[ i ] = static_cast< signed int >( ( v >> 1 ) ^ -( v & 1 ) );
+  }
+}
+
+/**
+ * @internal Encode up to 64 bypass bins, most significant bit first.
+ */
+template< class E >
+inline void encode_bypass_bits( E &e, const uint64_t bits, unsigned int n ) {
+  while ( n > 16 ) {
+    n -= 16;
+    e.encode_bypass_bits( static_cast< unsigned int >( bits >> n ) & 0xffff, 16 );
+  }
+  e.encode_bypass_bits( static_cast< unsigned int >( bits ) & ( ( 1u << n ) - 1 ), n );
+}
+
+/**
+ * @internal Decode up to 64 bypass bins, most significant bit first.
+ */
+template< class D >
+inline uint64_t decode_bypass_bits( D &d, unsigned int n ) {
+  uint64_t bits = 0;
+  while ( n > 16 ) {
+    n -= 16;
+    bits = ( bits << 16 ) | d.decode_bypass_bits( 16 );
+  }
+  return ( bits << n ) | d.decode_bypass_bits( n );
+}
+
+/**
+ * @internal Encode an unsigned integer like encode_ueg, with the Exp-Golomb part in two bulk bypass chunks.
+ */
+template< class E >
+inline void encode_ueg_bulk( E &e, unsigned int value, const unsigned int k, state_vector::size_type idx,
+    const unsigned int num_ctx ) {
+  const state_vector::size_type max_idx = idx + num_ctx;
+  while ( idx < max_idx ) {
+    const bool zero = ( value == 0 );
+    e.encode( idx++, zero );
+    if ( zero )
+      return;
+    value--;
+  }
+  // the prefix is m - k ones, the suffix is a zero and the m lower bits of value + 2^k
+  const uint64_t x = value + ( static_cast< uint64_t >( 1 ) << k );
+  const unsigned int m = x >> 32 ? 63 - clz( static_cast< uint32_t >( x >> 32 ) ) : 31 - clz( static_cast< uint32_t >( x ) );
+  encode_bypass_bits( e, ~static_cast< uint64_t >( 0 ), m - k );
+  encode_bypass_bits( e, x ^ ( static_cast< uint64_t >( 1 ) << m ), m + 1 );
+}
+
+/**
+ * @internal Decode an unsigned integer like decode_ueg, with the suffix in one bulk bypass chunk.
+ */
+template< class D >
+inline unsigned int decode_ueg_bulk( D &d, unsigned int k, state_vector::size_type idx, const unsigned int num_ctx ) {
+  unsigned int value = 0;
+  const state_vector::size_type max_idx = idx + num_ctx;
+  while ( idx < max_idx ) {
+    if ( d.decode( idx++ ) )
+      return value;
+    value++;
+  }
+  while ( d.decode_bypass() )
+    value += 1 << k++;
+  return value + static_cast< unsigned int >( decode_bypass_bits( d, k ) );
+}
+
+}
+
+/**
+ * Encode an array of unsigned integers.
+ *
+ * Produces the same bitstream as calling encode_ueg for each value, but codes the bypass bins of the
+ * Exp-Golomb part in chunks of up to 16 bins, with the prefix length determined by a single count of
+ * leading zeros. Requires an encoder providing encode_bypass_bits, e.g. encoder or encoder< void >.
+ *
+ * @param e the encoder object to be used
+ * @param values the integer values
+ * @param num the number of values
+ * @param k parameterization value of the Exp-Golomb encoding
+ * @param idx first context index to be used
+ * @param num_ctx number of context indexes to be used
+ */
+template< class E >
+inline void encode_ueg_array( E &e, const unsigned int *values, const ::std::size_t num, const unsigned int k,
+    const state_vector::size_type idx = ~0, const unsigned int num_ctx = 0 ) {
+  for ( ::std::size_t i = 0; i < num; ++i )
+    impl::encode_ueg_bulk( e, values[ i ], k, idx, num_ctx );
+}
+
+/**
+ * Encode an array of signed integers.
+ *
+ * Produces the same bitstream as calling encode_seg for each value. The values are mapped to unsigned
+ * integers in blocks, using SSE2 if available, and coded by encode_ueg_array.
+ *
+ * @see encode_ueg_array
+ */
+template< class E >
+inline void encode_seg_array( E &e, const signed int *values, const ::std::size_t num, const unsigned int k,
+    const state_vector::size_type idx = ~0, const unsigned int num_ctx = 0 ) {
+  unsigned int mapped[ 256 ];
+  for ( ::std::size_t i = 0; i < num; i += 256 ) {
+    const ::std::size_t n = num - i < 256 ? num - i : 256;
+    impl::zigzag( values + i, mapped, n );
+    encode_ueg_array( e, mapped, n, k, idx, num_ctx );
+  }
+}
+
+/**
+ * Encode an array of unsigned integers of fixed length.
+ *
+ * Produces the same bitstream as calling encode_uf for each value.
+ *
+ * @param e the encoder object to be used
+ * @param values the integer values
+ * @param num the number of values
+ * @param k the number of bits of each value
+ */
+template< class E >
+inline void encode_uf_array( E &e, const unsigned int *values, const ::std::size_t num, const unsigned int k ) {
+  assert( k && k <= 32 );
+  for ( ::std::size_t i = 0; i < num; ++i )
+    impl::encode_bypass_bits( e, values[ i ], k );
+}
+
+/**
+ * Decode an array of unsigned integers.
+ *
+ * @see encode_ueg_array
+ *
+ * @param d the decoder object to be used
+ * @param values receives the integer values
+ * @param num the number of values
+ * @param k parameterization value of the Exp-Golomb encoding
+ * @param idx first context index to be used
+ * @param num_ctx number of context indexes to be used
+ */
+template< class D >
+inline void decode_ueg_array( D &d, unsigned int *values, const ::std::size_t num, const unsigned int k,
+    const state_vector::size_type idx = ~0, const unsigned int num_ctx = 0 ) {
+  for ( ::std::size_t i = 0; i < num; ++i )
+    values[ i ] = impl::decode_ueg_bulk( d, k, idx, num_ctx );
+}
+
+/**
+ * Decode an array of signed integers.
+ *
+ * The unsigned values are mapped back to signed integers after decoding, using SSE2 if available.
+ *
+ * @see encode_seg_array
+ */
+template< class D >
+inline void decode_seg_array( D &d, signed int *values, const ::std::size_t num, const unsigned int k,
+    const state_vector::size_type idx = ~0, const unsigned int num_ctx = 0 ) {
+  for ( ::std::size_t i = 0; i < num; ++i )
+    values[ i ] = static_cast< signed int >( impl::decode_ueg_bulk( d, k, idx, num_ctx ) );
+  impl::unzigzag( values, num );
+}
+
+/**
+ * Decode an array of unsigned integers of fixed length.
+ *
+ * @see encode_uf_array
+ */
+template< class D >
+inline void decode_uf_array( D &d, unsigned int *values, const ::std::size_t num, const unsigned int k ) {
+  assert( k && k <= 32 );
+  for ( ::std::size_t i = 0; i < num; ++i )
+    values[ i ] = static_cast< unsigned int >( impl::decode_bypass_bits( d, k ) );
+}
+
+}
+
+#endif
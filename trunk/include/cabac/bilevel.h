@@ -0,0 +1,271 @@
+//
+// This file is part of libcabac.
+//
+// Copyright 2008 Johannes Ballé <balle@ient.rwth-aachen.de>
+//
+// libcabac is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libcabac is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libcabac.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef _OHTU7AY3EI_CABAC_BILEVEL_H
+#define _OHTU7AY3EI_CABAC_BILEVEL_H 1
+
+#include <cabac/common.h>
+#include <algorithm>
+#include <cstddef>
+
+namespace cabac {
+
+/**
+ * Neighborhood of a pixel used to form its context in bilevel_coder.
+ *
+ * The template consists of a contiguous range of pixels in each of the two rows above the current pixel
+ * and of the pixels immediately left of it, given as horizontal offsets relative to the current pixel.
+ * The template may contain at most 16 pixels, the offsets must lie between -16 and 8.
+ */
+struct bilevel_template {
+  /** leftmost and rightmost offset two rows above, the range is empty if left > right */
+  int row2_left, row2_right;
+  /** leftmost and rightmost offset one row above, the range is empty if left > right */
+  int row1_left, row1_right;
+  /** leftmost offset in the current row, the pixels end at offset -1, 0 for none */
+  int row0_left;
+};
+
+/**
+ * The three-line template of JBIG (ITU-T T.82) without adaptive pixel, 10 pixels.
+ */
+inline bilevel_template jbig_three_line_template() {
+  const bilevel_template t = { -1, 1, -2, 2, -2 };
+  return t;
+}
+
+/**
+ * The two-line template of JBIG (ITU-T T.82) without adaptive pixel, 10 pixels.
+ */
+inline bilevel_template jbig_two_line_template() {
+  const bilevel_template t = { 1, 0, -3, 2, -4 };
+  return t;
+}
+
+/**
+ * Generic region template 0 of JBIG2 (ITU-T T.88) with the adaptive pixels at their nominal positions,
+ * 16 pixels.
+ */
+inline bilevel_template jbig2_template0() {
+  const bilevel_template t = { -2, 2, -3, 3, -4 };
+  return t;
+}
+
+/**
+ * Context modeling for bilevel images, such as scanned documents, binary masks or bitplanes.
+ *
+ * Codes an image row by row, each pixel with a context formed by the pixels of a bilevel_template. Rows are
+ * packed with eight pixels per byte, the leftmost pixel in the most significant bit, as in PBM files.
+ * Pixels outside the image, as well as the padding bits of the last byte of a row, are taken as 0.
+ *
+ * Instead of gathering the template pixel by pixel, the coder keeps a register of each reference row,
+ * which is refilled a byte at a time every eight pixels, and extracts the part of each row in the template
+ * by a shift and a mask.
+ *
+ * With typical prediction, a flag precedes each row, which tells whether it is identical to the row above,
+ * in which case its pixels are not coded. This saves most of the bins of blank and repeated rows.
+ *
+ * The coder uses the contexts offset to offset + num_contexts() - 1 of the engine, which must be initialized
+ * by the caller, e.g. with state 0. The same coder object may be used with an encoder or a decoder.
+ *
+ * @code
+ * cabac::bilevel_coder coder( cabac::jbig2_template0(), width );
+ * cabac::encoder< iter_type > enc( iter_type( bs ), cabac::state_vector( coder.num_contexts(), 0 ) );
+ * for ( unsigned int y = 0; y < height; ++y )
+ *   coder.encode_row( enc, image + y * coder.row_bytes() );
+ * @endcode
+ */
+class bilevel_coder {
+
+  bilevel_template _template;
+  unsigned int _width;
+  ::std::size_t _bytes;
+  bool _typical_prediction;
+  state_vector::size_type _offset;
+  unsigned int _bits1, _bits0;
+  uint32_t _mask2, _mask1, _mask0;
+  uint8_t _last_mask;
+
+  // the rows two and one above and the current row, padded by a zero byte
+  ::std::vector< uint8_t > _rows[ 3 ];
+
+  // pack the pixels of the template into a context, see the class documentation
+  template< class F >
+  void scan( F &code_pixel ) {
+    const uint8_t *row2 = &_rows[ 0 ][ 0 ];
+    const uint8_t *row1 = &_rows[ 1 ][ 0 ];
+    const int shift2 = 15 - _template.row2_right;
+    const int shift1 = 15 - _template.row1_right;
+    // pixel x0 + k is at bit 15 - k in the registers, pixels beyond x0 + 15 are loaded with the next byte
+    uint32_t reg2 = row2[ 0 ], reg1 = row1[ 0 ], reg0 = 0;
+    for ( unsigned int x0 = 0; x0 < _width; x0 += 8 ) {
+      reg2 = ( reg2 << 8 ) | row2[ ( x0 >> 3 ) + 1 ];
+      reg1 = ( reg1 << 8 ) | row1[ ( x0 >> 3 ) + 1 ];
+      const unsigned int end = ::std::min( _width - x0, 8u );
+      for ( unsigned int i = 0; i < end; ++i ) {
+        const uint32_t ctx = ( ( ( reg2 >> ( shift2 - i ) ) & _mask2 ) << ( _bits1 + _bits0 ) ) |
+          ( ( ( reg1 >> ( shift1 - i ) ) & _mask1 ) << _bits0 ) | ( reg0 & _mask0 );
+        reg0 = ( reg0 << 1 ) | code_pixel( _offset + ctx, x0 + i );
+      }
+    }
+  }
+
+  // rotate the rows after coding the current row
+  void next_row() {
+    _rows[ 0 ].swap( _rows[ 1 ] );
+    _rows[ 1 ].swap( _rows[ 2 ] );
+  }
+
+  template< class E >
+  struct pixel_encoder {
+    E &e;
+    const uint8_t *row;
+    inline unsigned int operator()( const state_vector::size_type ctx, const unsigned int x ) {
+      const unsigned int bit = ( row[ x >> 3 ] >> ( 7 - ( x & 7 ) ) ) & 1;
+      e.encode( ctx, bit );
+      return bit;
+    }
+  };
+
+  template< class D >
+  struct pixel_decoder {
+    D &d;
+    uint8_t *row;
+    inline unsigned int operator()( const state_vector::size_type ctx, const unsigned int x ) {
+      const unsigned int bit = d.decode( ctx );
+      row[ x >> 3 ] |= bit << ( 7 - ( x & 7 ) );
+      return bit;
+    }
+  };
+
+  public:
+
+  /**
+   * Constructor.
+   *
+   * @param t the template
+   * @param width the width of the image in pixels
+   * @param typical_prediction whether to skip rows identical to the row above
+   * @param offset the first context index used
+   */
+  bilevel_coder( const bilevel_template &t, const unsigned int width, const bool typical_prediction = true,
+      const state_vector::size_type offset = 0 ) :
+    _template( t ),
+    _width( width ),
+    _bytes( ( width + 7 ) >> 3 ),
+    _typical_prediction( typical_prediction ),
+    _offset( offset ),
+    _last_mask( static_cast< uint8_t >( 0xff << ( 7 - ( ( width + 7 ) & 7 ) ) ) ) {
+    assert( width > 0 );
+    // empty ranges contribute no pixels and need a valid shift
+    if ( _template.row2_left > _template.row2_right ) {
+      _template.row2_left = 1;
+      _template.row2_right = 0;
+    }
+    if ( _template.row1_left > _template.row1_right ) {
+      _template.row1_left = 1;
+      _template.row1_right = 0;
+    }
+    assert( _template.row2_left >= -16 && _template.row2_right <= 8 );
+    assert( _template.row1_left >= -16 && _template.row1_right <= 8 );
+    assert( _template.row0_left >= -16 && _template.row0_left <= 0 );
+    const unsigned int bits2 = _template.row2_right - _template.row2_left + 1;
+    _bits1 = _template.row1_right - _template.row1_left + 1;
+    _bits0 = -_template.row0_left;
+    assert( bits2 + _bits1 + _bits0 <= 16 );
+    _mask2 = ( 1u << bits2 ) - 1;
+    _mask1 = ( 1u << _bits1 ) - 1;
+    _mask0 = ( 1u << _bits0 ) - 1;
+    for ( unsigned int i = 0; i < 3; ++i )
+      _rows[ i ].assign( _bytes + 1, 0 );
+  }
+
+  /**
+   * Get the number of contexts used, including the context of the typical prediction flag.
+   */
+  inline state_vector::size_type num_contexts() const {
+    return ( static_cast< state_vector::size_type >( _mask2 ) << ( _bits1 + _bits0 ) ) +
+      ( _mask1 << _bits0 ) + _mask0 + 2;
+  }
+
+  /**
+   * Get the number of bytes of a row.
+   */
+  inline ::std::size_t row_bytes() const {
+    return _bytes;
+  }
+
+  /**
+   * Start a new image, i.e. take the rows above the next row as 0.
+   */
+  void reset() {
+    for ( unsigned int i = 0; i < 3; ++i )
+      ::std::fill( _rows[ i ].begin(), _rows[ i ].end(), 0 );
+  }
+
+  /**
+   * Encode a row.
+   *
+   * @param e the encoder
+   * @param row the pixels of the row, row_bytes() bytes
+   */
+  template< class E >
+  void encode_row( E &e, const uint8_t *row ) {
+    uint8_t *current = &_rows[ 2 ][ 0 ];
+    ::std::copy( row, row + _bytes, current );
+    current[ _bytes - 1 ] &= _last_mask;
+    if ( _typical_prediction ) {
+      const bool typical = ::std::equal( current, current + _bytes, _rows[ 1 ].begin() );
+      e.encode( _offset + num_contexts() - 1, typical );
+      if ( typical ) {
+        next_row();
+        return;
+      }
+    }
+    pixel_encoder< E > f = { e, current };
+    scan( f );
+    next_row();
+  }
+
+  /**
+   * Decode a row.
+   *
+   * @param d the decoder
+   * @param row receives the pixels of the row, row_bytes() bytes with the padding bits set to 0
+   */
+  template< class D >
+  void decode_row( D &d, uint8_t *row ) {
+    uint8_t *current = &_rows[ 2 ][ 0 ];
+    if ( _typical_prediction && d.decode( _offset + num_contexts() - 1 ) ) {
+      ::std::copy( _rows[ 1 ].begin(), _rows[ 1 ].end(), current );
+    } else {
+      ::std::fill( current, current + _bytes, 0 );
+      pixel_decoder< D > f = { d, current };
+      scan( f );
+    }
+    ::std::copy( current, current + _bytes, row );
+    next_row();
+  }
+
+};
+
+}
+
+#endif
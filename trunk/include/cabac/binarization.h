@@ -0,0 +1,258 @@
+//
+// This file is part of libcabac.
+//
+// Copyright 2008 Johannes Ballé <balle@ient.rwth-aachen.de>
+//
+// libcabac is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libcabac is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libcabac.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef _OHTU7AY3EI_CABAC_BINARIZATION_H
+#define _OHTU7AY3EI_CABAC_BINARIZATION_H 1
+
+#include <cabac/encoder-base.h>
+
+namespace cabac {
+
+/**
+ * Context offset of a bin coded using the bypass engine in a binarization tree.
+ */
+const int bypass_context = -1;
+
+namespace impl {
+
+/**
+ * @internal Number of contexts of a binarization tree from the context of its root and the numbers of its subtrees.
+ */
+constexpr int max_contexts( const int root, const int zero, const int one ) {
+  return root > zero ? ( root > one ? root : one ) : ( zero > one ? zero : one );
+}
+
+}
+
+/**
+ * Leaf of a binarization tree, the symbol value V.
+ *
+ * @see decision
+ */
+template< unsigned int V >
+struct symbol {
+
+  enum { contexts = 0 };
+
+  // the value set, as range and as bit mask if all values are below 64
+  static constexpr unsigned int min_value = V;
+  static constexpr unsigned int max_value = V;
+  static constexpr bool small = V < 64;
+  static constexpr uint64_t mask = V < 64 ? static_cast< uint64_t >( 1 ) << ( V & 63 ) : 0;
+
+  static inline bool contains( const unsigned int value ) {
+    return value == V;
+  }
+
+  template< class E >
+  static inline void encode( E &, const state_vector::size_type, const unsigned int ) {
+  }
+
+  template< class D >
+  static inline unsigned int decode( D &, const state_vector::size_type ) {
+    return V;
+  }
+
+  template< class E >
+  static inline unsigned int cost( const E &, const state_vector::size_type, const unsigned int ) {
+    return 0;
+  }
+
+};
+
+/**
+ * Inner node of a binarization tree.
+ *
+ * A binarization tree defines the binarization of a small alphabet together with the contexts of its bins,
+ * from which encoder, decoder and rate estimation are generated at compile time:
+ *
+ * @code
+ * // 0 -> 0, 1 -> 10, 2 -> 110, 3 -> 111, with a context per node
+ * typedef cabac::decision< 0, cabac::symbol< 0 >,
+ *         cabac::decision< 1, cabac::symbol< 1 >,
+ *         cabac::decision< 2, cabac::symbol< 2 >, cabac::symbol< 3 > > > > mode_tree;
+ *
+ * cabac::encode_symbol< mode_tree >( enc, first_idx, mode );
+ * mode = cabac::decode_symbol< mode_tree >( dec, first_idx );
+ * @endcode
+ *
+ * The bin of a node is coded with context first_idx + Ctx, or using the bypass engine if Ctx is
+ * bypass_context; it is 0 for the symbols of subtree Zero and 1 for the symbols of subtree One. The
+ * symbol values in a tree must be unique. Decoding is unrolled into nested conditionals by the compiler,
+ * without walking the tree at run time. See truncated_unary and fixed_length for common trees.
+ */
+template< int Ctx, class Zero, class One >
+struct decision {
+
+  enum { contexts = impl::max_contexts( Ctx + 1, Zero::contexts, One::contexts ) };
+
+  static constexpr unsigned int min_value = Zero::min_value < One::min_value ? Zero::min_value : One::min_value;
+  static constexpr unsigned int max_value = Zero::max_value > One::max_value ? Zero::max_value : One::max_value;
+  static constexpr bool small = Zero::small && One::small;
+  static constexpr uint64_t mask = Zero::mask | One::mask;
+
+  static inline bool contains( const unsigned int value ) {
+    if ( small )
+      return value < 64 && ( ( mask >> ( value & 63 ) ) & 1 );
+    return Zero::contains( value ) || One::contains( value );
+  }
+
+  /**
+   * The bin of a symbol of the tree in constant time: a comparison if the values of the subtrees are
+   * separated, otherwise a bit test.
+   */
+  static inline bool bin( const unsigned int value ) {
+    if ( Zero::max_value < One::min_value )
+      return value >= One::min_value;
+    if ( One::max_value < Zero::min_value )
+      return value <= One::max_value;
+    if ( small )
+      return ( One::mask >> ( value & 63 ) ) & 1;
+    return One::contains( value );
+  }
+
+  template< class E >
+  static inline void encode( E &e, const state_vector::size_type idx, const unsigned int value ) {
+    const bool bin_val = bin( value );
+    assert( bin_val ? One::contains( value ) : Zero::contains( value ) );
+    if ( Ctx == bypass_context )
+      e.encode_bypass( bin_val );
+    else
+      e.encode( idx + Ctx, bin_val );
+    if ( bin_val )
+      One::encode( e, idx, value );
+    else
+      Zero::encode( e, idx, value );
+  }
+
+  template< class D >
+  static inline unsigned int decode( D &d, const state_vector::size_type idx ) {
+    const bool bin_val = Ctx == bypass_context ? d.decode_bypass() : d.decode( idx + Ctx );
+    return bin_val ? One::decode( d, idx ) : Zero::decode( d, idx );
+  }
+
+  template< class E >
+  static inline unsigned int cost( const E &e, const state_vector::size_type idx, const unsigned int value ) {
+    const bool bin_val = bin( value );
+    const unsigned int bits = Ctx == bypass_context ? 1 << 8 : e.encode_test( idx + Ctx, bin_val );
+    return bits + ( bin_val ? One::cost( e, idx, value ) : Zero::cost( e, idx, value ) );
+  }
+
+};
+
+namespace impl {
+
+/**
+ * @internal Truncated unary tree for the values First to Max, the bin at depth i using context
+ * Ctx + min( i, NumCtx - 1 ).
+ */
+template< unsigned int Max, int Ctx, unsigned int NumCtx, unsigned int First, unsigned int Depth >
+struct truncated_unary_tree {
+  typedef decision< Ctx == bypass_context ? Ctx : Ctx + static_cast< int >( Depth < NumCtx ? Depth : NumCtx - 1 ),
+    symbol< First >, typename truncated_unary_tree< Max, Ctx, NumCtx, First + 1, Depth + 1 >::type > type;
+};
+
+template< unsigned int Max, int Ctx, unsigned int NumCtx, unsigned int Depth >
+struct truncated_unary_tree< Max, Ctx, NumCtx, Max, Depth > {
+  typedef symbol< Max > type;
+};
+
+/**
+ * @internal Fixed-length tree for the values First to First + 2^Bits - 1, most significant bit first. The bin at
+ * depth i uses context Ctx + i, or context Ctx + Node with PerNode, numbering the nodes in breadth-first order.
+ */
+template< unsigned int Bits, int Ctx, bool PerNode, unsigned int First, unsigned int Depth, unsigned int Node >
+struct fixed_length_tree {
+  typedef decision< Ctx == bypass_context ? Ctx : Ctx + static_cast< int >( PerNode ? Node : Depth ),
+    typename fixed_length_tree< Bits - 1, Ctx, PerNode, First, Depth + 1, 2 * Node + 1 >::type,
+    typename fixed_length_tree< Bits - 1, Ctx, PerNode, First + ( 1u << ( Bits - 1 ) ), Depth + 1, 2 * Node + 2 >::type > type;
+};
+
+template< int Ctx, bool PerNode, unsigned int First, unsigned int Depth, unsigned int Node >
+struct fixed_length_tree< 0, Ctx, PerNode, First, Depth, Node > {
+  typedef symbol< First > type;
+};
+
+}
+
+/**
+ * Truncated unary binarization of the values 0 to Max: value v is coded as v ones followed by a zero,
+ * which is omitted for v = Max.
+ *
+ * The i-th bin uses context Ctx + min( i, NumCtx - 1 ), or the bypass engine if Ctx is bypass_context.
+ */
+template< unsigned int Max, int Ctx, unsigned int NumCtx = 1 >
+using truncated_unary = typename impl::truncated_unary_tree< Max, Ctx, NumCtx, 0, 0 >::type;
+
+/**
+ * Fixed-length binarization of the values 0 to 2^Bits - 1, most significant bit first.
+ *
+ * The i-th bin uses context Ctx + i, or the bypass engine if Ctx is bypass_context. With PerNode, each node
+ * of the tree has a context of its own, i.e. the bins use the contexts Ctx to Ctx + 2^Bits - 2, such that
+ * the full distribution of the symbols is learned.
+ */
+template< unsigned int Bits, int Ctx = bypass_context, bool PerNode = false >
+using fixed_length = typename impl::fixed_length_tree< Bits, Ctx, PerNode, 0, 0, 0 >::type;
+
+/**
+ * Encode a symbol with a binarization tree.
+ *
+ * Works with encoder< void > as well, which yields the rate of the symbol including the state updates.
+ *
+ * @param e the encoder
+ * @param idx the first context index of the tree
+ * @param value the symbol value, which must be a leaf of the tree
+ */
+template< class T, class E >
+inline void encode_symbol( E &e, const state_vector::size_type idx, const unsigned int value ) {
+  T::encode( e, idx, value );
+}
+
+/**
+ * Decode a symbol with a binarization tree.
+ *
+ * @param d the decoder
+ * @param idx the first context index of the tree
+ * @return the symbol value
+ */
+template< class T, class D >
+inline unsigned int decode_symbol( D &d, const state_vector::size_type idx ) {
+  return T::decode( d, idx );
+}
+
+/**
+ * Estimate the rate of a symbol with a binarization tree without coding it.
+ *
+ * Like encoder_base::encode_test(), the states are not updated, so this is an approximation if the tree
+ * uses a context more than once on the path of the symbol.
+ *
+ * @param e the encoder
+ * @param idx the first context index of the tree
+ * @param value the symbol value, which must be a leaf of the tree
+ * @return self information of the symbol in bits * 256
+ */
+template< class T, class E >
+inline unsigned int symbol_cost( const E &e, const state_vector::size_type idx, const unsigned int value ) {
+  return T::cost( e, idx, value );
+}
+
+}
+
+#endif
@@ -0,0 +1,526 @@
+//
+// This file is part of libcabac.
+//
+// Copyright 2008 Johannes Ballé <balle@ient.rwth-aachen.de>
+//
+// libcabac is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libcabac is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libcabac.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef _OHTU7AY3EI_CABAC_BOUNDED_H
+#define _OHTU7AY3EI_CABAC_BOUNDED_H 1
+
+#include <cabac/encoder-base.h>
+#include <cabac/observer.h>
+
+namespace cabac {
+
+/**
+ * CABAC %encoder with bounded output latency.
+ *
+ * In the standard encoder, a bit whose value depends on a possible carry is held back as an
+ * outstanding bit until the carry is resolved. Since the number of outstanding bits is not bounded,
+ * output may be delayed arbitrarily. This encoder limits the number of outstanding bits to a given
+ * maximum: when another outstanding bit would be required, the carry is resolved immediately by
+ * restricting the coding interval to the larger of its two parts below and above the carry boundary.
+ * This costs at most one bit per forced resolution, which is rare for reasonable limits.
+ *
+ * The resulting bitstream is *not* compatible with ISO/IEC 14496-10 / ITU-T Rec. H.264 and must
+ * be decoded by a bounded_decoder using the same limit. Of the interface of the encoder class, encode(),
+ * encode_bypass(), encode_bypass_bits() and encode_terminal() are supported, which is enough for the
+ * binarizations of integer.h and array.h. Saving and restoring the state, static contexts, runs, raw
+ * bytes and counting the output (bytes(), tell_bits()) are not.
+ *
+ * In addition, the encoder measures the latency of its output: max_latency() returns the maximum number
+ * of bins coded between a bit becoming known to the encoder and the byte containing it being written.
+ */
+template< typename I, class O = null_observer >
+class bounded_encoder : public impl::encoder_base<> {
+
+  I _data;
+  O _observer;
+
+  unsigned int _low;
+  unsigned int _range;
+  unsigned int _bits_outstanding;
+  unsigned int _byte;
+  int _shift;
+
+  const unsigned int _max_outstanding;
+  uint64_t _bins;
+  uint64_t _outstanding_since;
+  uint64_t _byte_since;
+  uint64_t _max_latency;
+  uint64_t _forced;
+
+  // prohibit duplication of object
+  bounded_encoder( const bounded_encoder &other );
+  bounded_encoder& operator=( const bounded_encoder &other );
+
+  /**
+   * WriteBits according to ISO/IEC 14496-10 / ITU-T Rec. H.264.
+   *
+   * @param b the bit
+   * @param since the number of coded bins at which the bit became known
+   */
+  void write_bit( const bool b, const uint64_t since ) {
+    if ( _shift >= 7 || since < _byte_since )
+      _byte_since = since;
+    _byte |= ( b << _shift );
+    --_shift;
+    if ( _shift < 0 ) {
+      *_data++ = _byte;
+      _observer.byte();
+      if ( _bins - _byte_since > _max_latency )
+        _max_latency = _bins - _byte_since;
+      _byte = 0;
+      _shift = 7;
+    }
+  }
+
+  /**
+   * PutBit according to ISO/IEC 14496-10 / ITU-T Rec. H.264.
+   */
+  void put_bit( const bool b ) {
+    const uint64_t since = _bits_outstanding ? _outstanding_since : _bins;
+    write_bit( b, since );
+    if ( _bits_outstanding )
+      _observer.outstanding( _bits_outstanding );
+    while ( _bits_outstanding ) {
+      write_bit( !b, since );
+      --_bits_outstanding;
+    }
+  }
+
+  /**
+   * Defer the next bit, or resolve it if the maximum number of outstanding bits is reached.
+   *
+   * @param boundary the carry boundary of the current interval
+   * @return true if the bit was deferred
+   */
+  bool defer( const unsigned int boundary ) {
+    if ( _bits_outstanding < _max_outstanding ) {
+      if ( !_bits_outstanding )
+        _outstanding_since = _bins;
+      ++_bits_outstanding;
+      return true;
+    }
+    ++_forced;
+    const unsigned int lower = boundary - _low;
+    if ( _low + _range > boundary + lower ) {
+      _range = _low + _range - boundary;
+      _low = 0;
+      put_bit( 1 );
+    } else {
+      if ( _range > lower )
+        _range = lower;
+      put_bit( 0 );
+    }
+    return false;
+  }
+
+  /**
+   * RenormE according to ISO/IEC 14496-10 / ITU-T Rec. H.264, with bounded outstanding bits.
+   */
+  void renorm() {
+    unsigned int shifts = 0;
+    while ( _range < 0x100 ) {
+      if ( _low < 0x100 ) {
+        put_bit( 0 );
+      } else {
+        if ( _low >= 0x200 ) {
+          _low -= 0x200;
+          put_bit( 1 );
+        } else if ( defer( 0x200 ) ) {
+          _low -= 0x100;
+        }
+      }
+      _range <<= 1;
+      _low <<= 1;
+      ++shifts;
+    }
+    _observer.renorm( shifts );
+  }
+
+  /**
+   * EncodeFlush according to ISO/IEC 14496-10 / ITU-T Rec. H.264.
+   */
+  void flush() {
+    _range = 2;
+    renorm();
+    put_bit( ( _low >> 9 ) & 1 );
+    write_bit( ( _low >> 8 ) & 1, _bins );
+    write_bit( 1, _bins );
+  }
+
+  public:
+
+  typedef I iterator_type;
+  typedef O observer_type;
+
+  /**
+   * Constructor.
+   *
+   * @param output an STL-compatible output iterator on a container of uint8_t, used to write the bitstream
+   * @param states the initial state vector
+   * @param max_outstanding the maximum number of outstanding bits
+   * @param observer the observer object
+   */
+  bounded_encoder( const I &output, const state_vector &states, const unsigned int max_outstanding = 16,
+      const O &observer = O() ) :
+    impl::encoder_base<>( states ),
+    _data( output ),
+    _observer( observer ),
+    _low( 0 ),
+    _range( 0x1fe ),
+    _bits_outstanding( 0 ),
+    _byte( 0 ),
+    _shift( 8 ),
+    _max_outstanding( max_outstanding ),
+    _bins( 0 ),
+    _outstanding_since( 0 ),
+    _byte_since( 0 ),
+    _max_latency( 0 ),
+    _forced( 0 ) {
+  }
+
+  /**
+   * Destructor.
+   *
+   * @see encoder::~encoder
+   */
+  ~bounded_encoder() {
+    flush();
+    *_data++ = _byte;
+    _observer.byte();
+  }
+
+  /**
+   * Get observer object.
+   */
+  inline O& observer() {
+    return _observer;
+  }
+
+  /**
+   * Get the maximum number of bits held back by the encoder.
+   *
+   * This is the worst case over any input: outstanding bits, bits of an incomplete byte, and
+   * the bits of the interval register.
+   *
+   * @return the maximum delay in bits
+   */
+  inline unsigned int max_delay_bits() const {
+    return _max_outstanding + 1 + 7 + 10;
+  }
+
+  /**
+   * Get the maximum observed output latency.
+   *
+   * @return the maximum number of bins coded between a bit becoming known and it being written
+   */
+  inline uint64_t max_latency() const {
+    return _max_latency;
+  }
+
+  /**
+   * Get number of forced carry resolutions.
+   */
+  inline uint64_t forced_resolutions() const {
+    return _forced;
+  }
+
+  /**
+   * Encode a binary decision.
+   *
+   * @see encoder::encode
+   */
+  void encode( const state_vector::size_type idx, const bool bin_val ) {
+    assert( 0 <= idx );
+    assert( idx < _states.size() );
+    const unsigned int state = _states[ idx ];
+    _observer.decision( idx, state, _range, _low, bin_val );
+    const unsigned int range_lps = range_tab_lps[ state >> 1 ][ ( _range >> 6 ) & 3 ];
+    const bool lps = ( state ^ bin_val ) & 1;
+    _range -= range_lps;
+    if ( lps ) {
+      _low += _range;
+      _range = range_lps;
+    }
+    _states[ idx ] = next_state_tab[ state ][ lps ];
+    ++_bins;
+    renorm();
+  }
+
+  /**
+   * Encode a binary decision using the bypass engine.
+   *
+   * @see encoder::encode_bypass
+   */
+  void encode_bypass( const bool bin_val ) {
+    _observer.bypass( _range, _low, bin_val );
+    ++_bins;
+    _low <<= 1;
+    if ( bin_val )
+      _low += _range;
+    if ( _low >= 0x400 ) {
+      put_bit( 1 );
+      _low -= 0x400;
+    } else {
+      if ( _low < 0x200 ) {
+        put_bit( 0 );
+      } else if ( defer( 0x400 ) ) {
+        _low -= 0x200;
+      } else {
+        renorm();
+      }
+    }
+  }
+
+  /**
+   * Encode several binary decisions using the bypass engine.
+   *
+   * Equivalent to n calls to encode_bypass(), to which each forced resolution applies.
+   *
+   * @param value the values of the bins, the first in the most significant bit
+   * @param n the number of bins, at most 16
+   */
+  void encode_bypass_bits( const unsigned int value, unsigned int n ) {
+    assert( n <= 16 );
+    while ( n-- )
+      encode_bypass( ( value >> n ) & 1 );
+  }
+
+  /**
+   * Encode a terminal bit.
+   *
+   * @see encoder::encode_terminal
+   */
+  void encode_terminal( const bool bin_val ) {
+    _observer.terminal( _range, _low, bin_val );
+    ++_bins;
+    _range -= 2;
+    if ( bin_val ) {
+      _low += _range;
+    } else {
+      renorm();
+    }
+  }
+
+};
+
+/**
+ * CABAC %decoder for bitstreams written by bounded_encoder.
+ *
+ * In addition to the decoder state, this class keeps track of the lower interval bound and the number
+ * of outstanding bits of the encoder, in order to apply the same forced carry resolutions.
+ */
+template< typename I, class O = null_observer >
+class bounded_decoder : public impl::decoder_base<> {
+
+  I _data;
+  O _observer;
+
+  unsigned int _range;
+  unsigned int _offset;
+  unsigned int _mask;
+  unsigned int _low;
+  unsigned int _bits_outstanding;
+
+  const unsigned int _max_outstanding;
+
+  // prohibit duplication of object
+  bounded_decoder( const bounded_decoder &other );
+  bounded_decoder& operator=( const bounded_decoder &other );
+
+  bool read_bit() {
+    const bool b = *_data & _mask;
+    _mask >>= 1;
+    if ( !_mask ) {
+      _data++;
+      _mask = 128;
+      _observer.byte();
+    }
+    return b;
+  }
+
+  /**
+   * Mirror of bounded_encoder::defer.
+   */
+  bool defer( const unsigned int boundary ) {
+    if ( _bits_outstanding < _max_outstanding ) {
+      ++_bits_outstanding;
+      return true;
+    }
+    _bits_outstanding = 0;
+    const unsigned int lower = boundary - _low;
+    if ( _low + _range > boundary + lower ) {
+      _range = _low + _range - boundary;
+      _offset -= lower;
+      _low = 0;
+    } else {
+      if ( _range > lower )
+        _range = lower;
+    }
+    return false;
+  }
+
+  void renorm() {
+    unsigned int shifts = 0;
+    while ( _range < 0x100 ) {
+      if ( _low < 0x100 ) {
+        _bits_outstanding = 0;
+      } else {
+        if ( _low >= 0x200 ) {
+          _low -= 0x200;
+          _bits_outstanding = 0;
+        } else if ( defer( 0x200 ) ) {
+          _low -= 0x100;
+        }
+      }
+      _range <<= 1;
+      _low <<= 1;
+      _offset = ( _offset << 1 ) | read_bit();
+      ++shifts;
+    }
+    _observer.renorm( shifts );
+  }
+
+  public:
+
+  typedef I iterator_type;
+  typedef O observer_type;
+
+  /**
+   * Constructor.
+   *
+   * @param input an STL-compatible input iterator on a container of uint8_t, used to read the bitstream
+   * @param states the initial state vector
+   * @param max_outstanding the maximum number of outstanding bits used by the encoder
+   * @param observer the observer object
+   */
+  bounded_decoder( const I &input, const state_vector &states, const unsigned int max_outstanding = 16,
+      const O &observer = O() ) :
+    impl::decoder_base<>( states ),
+    _data( input ),
+    _observer( observer ),
+    _range( 0x1fe ),
+    _offset( 0 ),
+    _mask( 128 ),
+    _low( 0 ),
+    _bits_outstanding( 0 ),
+    _max_outstanding( max_outstanding ) {
+    for ( unsigned int i = 0; i < 9; ++i )
+      _offset = ( _offset << 1 ) | read_bit();
+  }
+
+  /**
+   * Get observer object.
+   */
+  inline O& observer() {
+    return _observer;
+  }
+
+  /**
+   * Decode a binary decision.
+   *
+   * @see decoder::decode
+   */
+  bool decode( const state_vector::size_type idx ) {
+    assert( 0 <= idx );
+    assert( idx < _states.size() );
+    const unsigned int state = _states[ idx ];
+    const unsigned int range = _range;
+    const unsigned int offset = _offset;
+    const unsigned int range_lps = range_tab_lps[ state >> 1 ][ ( _range >> 6 ) & 3 ];
+    _range -= range_lps;
+    const bool lps = _offset >= _range;
+    if ( lps ) {
+      _offset -= _range;
+      _low += _range;
+      _range = range_lps;
+    }
+    _states[ idx ] = next_state_tab[ state ][ lps ];
+    renorm();
+    const bool bin_val = ( state ^ lps ) & 1;
+    _observer.decision( idx, state, range, offset, bin_val );
+    return bin_val;
+  }
+
+  /**
+   * Decode a binary decision using the bypass engine.
+   *
+   * @see decoder::decode_bypass
+   */
+  bool decode_bypass() {
+    const unsigned int offset = _offset;
+    _offset = ( _offset << 1 ) | read_bit();
+    _low <<= 1;
+    const bool bin_val = ( _offset >= _range );
+    if ( bin_val ) {
+      _offset -= _range;
+      _low += _range;
+    }
+    _observer.bypass( _range, offset, bin_val );
+    if ( _low >= 0x400 ) {
+      _low -= 0x400;
+      _bits_outstanding = 0;
+    } else {
+      if ( _low < 0x200 ) {
+        _bits_outstanding = 0;
+      } else if ( defer( 0x400 ) ) {
+        _low -= 0x200;
+      } else {
+        renorm();
+      }
+    }
+    return bin_val;
+  }
+
+  /**
+   * Decode several binary decisions using the bypass engine.
+   *
+   * @see bounded_encoder::encode_bypass_bits
+   *
+   * @param n the number of bins, at most 16
+   * @return the values of the bins, the first in the most significant bit
+   */
+  unsigned int decode_bypass_bits( unsigned int n ) {
+    assert( n <= 16 );
+    unsigned int value = 0;
+    while ( n-- )
+      value = ( value << 1 ) | decode_bypass();
+    return value;
+  }
+
+  /**
+   * Decode a terminal bit.
+   *
+   * @see decoder::decode_terminal
+   */
+  bool decode_terminal() {
+    _observer.terminal( _range, _offset, _offset >= _range - 2 );
+    _range -= 2;
+    if ( _offset >= _range ) {
+      _low += _range;
+      return 1;
+    }
+    renorm();
+    return 0;
+  }
+
+};
+
+}
+
+#endif
@@ -27,14 +27,18 @@ namespace impl {
 
 /**
  * @internal CABAC state engine base class.
+ *
+ * The template parameter is the container of the context states, which must provide operator[] and size()
+ * like state_vector (see sparse_states).
  */
+template< class S = state_vector >
 class base {
 
   protected:
 
-  state_vector _states;
+  S _states;
 
-  base( const state_vector &states ) :
+  base( const S &states ) :
     _states( states ) {
   }
 
@@ -49,12 +53,14 @@ class base {
 
   public:
 
+  typedef S states_type;
+
   /**
    * Get current state vector.
    *
    * @return a reference to a state_vector containing the current states of the CABAC engine.
    */
-  inline const state_vector& states() const {
+  inline const S& states() const {
     return _states;
   }
 
@@ -63,7 +69,8 @@ class base {
 /**
  * @internal CABAC decoder base class.
  */
-typedef base decoder_base;
+template< class S = state_vector >
+using decoder_base = base< S >;
 
 }
 }
@@ -22,17 +22,8 @@
 
 #include <stdint.h>
 #include <vector>
-#ifdef CABAC_DEBUG_OUTPUT
-# include <iostream>
-# include <sstream>
-# include <iomanip>
-# include <bitset>
-#endif
 #include <cassert>
-
-#if defined( _OHTU7AY3EI_CABAC_CPP ) || !defined( NDEBUG )
-# include <cmath>
-#endif
+#include <cabac/tables.h>
 
 /**
  * CABAC library.
@@ -48,16 +39,12 @@
  * The current implementation should be very portable. However, it is not yet fully optimized.
  * It is based almost literally on the standard. In the ffmpeg and x264 projects, optimized
  * implementations exist, which could be used to replace the implementation of this library in future versions.
+ *
+ * The engines and the binarizations are header-only: all tables are compile-time constants (see tables.h).
+ * Only the precompiled kernels, tracing and metrics require linking with the library.
  */
 namespace cabac {
 
-// tables in cabac.cpp
-extern const uint8_t range_tab_lps[ 64 ][ 4 ];
-extern const uint8_t trans_idx_lps[ 64 ];
-extern const uint8_t trans_idx_mps[ 64 ];
-extern const float expect_tab[ 128 ];
-extern const uint16_t bits_tab[ 128 ];
-
 /**
  * CABAC state vector.
  *
@@ -69,19 +56,50 @@ extern const uint16_t bits_tab[ 128 ];
  */
 typedef ::std::vector< uint8_t > state_vector;
 
-#if defined( _OHTU7AY3EI_CABAC_CPP ) || !defined( NDEBUG )
-inline unsigned int FIX8( const double f ) {
-  return static_cast< unsigned int >( ( f * ( 1 << 8 ) + .5 ) );
+class null_observer;
+
+template< typename I, class O = null_observer, class S = state_vector >
+class encoder;
+
+template< typename I, class O = null_observer, class S = state_vector >
+class decoder;
+
+namespace impl {
+
+/**
+ * @internal Count leading zero bits of a nonzero 32 bit value.
+ *
+ * Compiles to a single bsr or lzcnt instruction on GCC-compatible compilers, depending
+ * on the instruction set the calling function is compiled for.
+ */
+inline unsigned int clz( const uint32_t x ) {
+  assert( x );
+#if defined( __GNUC__ )
+  return __builtin_clz( x );
+#else
+  unsigned int n = 0;
+  while ( !( x & ( 0x80000000u >> n ) ) )
+    ++n;
+  return n;
+#endif
 }
 
-inline double PLPS( unsigned int state_idx ) {
-  return state_idx ? PLPS( state_idx - 1 ) * pow( 0.01875 / 0.5, 1.0 / 63.0 ) : 0.5;
+/**
+ * @internal Count trailing zero bits of a nonzero 32 bit value.
+ */
+inline unsigned int ctz( const uint32_t x ) {
+  assert( x );
+#if defined( __GNUC__ )
+  return __builtin_ctz( x );
+#else
+  unsigned int n = 0;
+  while ( !( x & ( 1u << n ) ) )
+    ++n;
+  return n;
+#endif
 }
 
-inline double BITS( double p ) {
-  return -log2( p );
 }
-#endif
 
 }
 
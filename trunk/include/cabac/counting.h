@@ -20,7 +20,10 @@
 #ifndef _OHTU7AY3EI_CABAC_COUNTING_H
 #define _OHTU7AY3EI_CABAC_COUNTING_H 1
 
-#include <cabac/common.h>
+#include <cabac/encoder.h>
+#include <cabac/decoder.h>
+#include <cabac/observer.h>
+#include <cmath>
 
 namespace cabac {
 
@@ -58,6 +61,13 @@ class counting {
       _frequencies[ idx ].first++;
   }
 
+  inline void count( const frequency_vector::size_type idx, const bool bin_val, const uint64_t n ) {
+    if ( bin_val )
+      _frequencies[ idx ].second += static_cast< unsigned int >( n );
+    else
+      _frequencies[ idx ].first += static_cast< unsigned int >( n );
+  }
+
   public:
 
   /**
@@ -73,17 +83,14 @@ class counting {
 
 }
 
-template< typename I >
-class encoder;
-
 /**
  * CABAC %encoder which counts relative frequencies.
  *
  * This class behaves in the same way as the encoder class, only that it counts the number of zeroes and ones
  * encoded using each context. These frequencies can be acquired through frequencies().
  */
-template< typename I >
-class counting_encoder : public encoder< I >, public impl::counting {
+template< typename I, class O = null_observer >
+class counting_encoder : public encoder< I, O >, public impl::counting {
 
   public:
 
@@ -92,17 +99,30 @@ class counting_encoder : public encoder< I >, public impl::counting {
    *
    * @param output an STL-compatible output iterator on a container of uint8_t, used to write the bitstream
    * @param states the initial state vector
+   * @param observer the observer object
    */
-  counting_encoder( const I &output, const state_vector &states ) :
-    encoder< I >( output, states ),
+  counting_encoder( const I &output, const state_vector &states, const O &observer = O() ) :
+    encoder< I, O >( output, states, observer ),
     counting( states.size() ) {
   }
 
   void encode( const state_vector::size_type idx, const bool bin_val ) {
-    encoder< I >::encode( idx, bin_val );
+    encoder< I, O >::encode( idx, bin_val );
+    counting::count( idx, bin_val );
+  }
+
+  void encode_unpredictable( const state_vector::size_type idx, const bool bin_val ) {
+    encoder< I, O >::encode_unpredictable( idx, bin_val );
     counting::count( idx, bin_val );
   }
 
+  void encode_run( const state_vector::size_type idx, const uint64_t n_mps, const bool then_lps ) {
+    const bool val_mps = this->states()[ idx ] & 1;
+    encoder< I, O >::encode_run( idx, n_mps, then_lps );
+    counting::count( idx, val_mps, n_mps );
+    counting::count( idx, !val_mps, then_lps );
+  }
+
 };
 
 /**
@@ -134,10 +154,19 @@ class counting_encoder< void > : public encoder< void >, public impl::counting {
     counting::count( idx, bin_val );
   }
 
-};
+  void encode_unpredictable( const state_vector::size_type idx, const bool bin_val ) {
+    encoder< void >::encode( idx, bin_val );
+    counting::count( idx, bin_val );
+  }
+
+  void encode_run( const state_vector::size_type idx, const uint64_t n_mps, const bool then_lps ) {
+    const bool val_mps = states()[ idx ] & 1;
+    encoder< void >::encode_run( idx, n_mps, then_lps );
+    counting::count( idx, val_mps, n_mps );
+    counting::count( idx, !val_mps, then_lps );
+  }
 
-template< typename I >
-class decoder;
+};
 
 /**
  * CABAC %decoder which counts relative frequencies.
@@ -145,8 +174,8 @@ class decoder;
  * This class behaves in the same way as the decoder class, only that it counts the number of zeroes and ones
  * decoded using each context. These frequencies can be acquired through frequencies().
  */
-template< typename I >
-class counting_decoder : public decoder< I >, public impl::counting {
+template< typename I, class O = null_observer >
+class counting_decoder : public decoder< I, O >, public impl::counting {
 
   public:
 
@@ -155,18 +184,33 @@ class counting_decoder : public decoder< I >, public impl::counting {
    *
    * @param input an STL-compatible input iterator on a container of uint8_t, used to read the bitstream
    * @param states the initial state vector
+   * @param observer the observer object
    */
-  counting_decoder( const I &input, const state_vector &states ) :
-    decoder< I >( input, states ),
+  counting_decoder( const I &input, const state_vector &states, const O &observer = O() ) :
+    decoder< I, O >( input, states, observer ),
     counting( states.size() ) {
   }
 
   bool decode( const state_vector::size_type idx ) {
-    const bool bin_val = decoder< I >::decode( idx );
+    const bool bin_val = decoder< I, O >::decode( idx );
     counting::count( idx, bin_val );
     return bin_val;
   }
 
+  bool decode_unpredictable( const state_vector::size_type idx ) {
+    const bool bin_val = decoder< I, O >::decode_unpredictable( idx );
+    counting::count( idx, bin_val );
+    return bin_val;
+  }
+
+  uint64_t decode_mps_run( const state_vector::size_type idx, const uint64_t max_n ) {
+    const bool val_mps = this->states()[ idx ] & 1;
+    const uint64_t n = decoder< I, O >::decode_mps_run( idx, max_n );
+    counting::count( idx, val_mps, n );
+    counting::count( idx, !val_mps, n < max_n );
+    return n;
+  }
+
 };
 
 /**
@@ -175,7 +219,7 @@ class counting_decoder : public decoder< I >, public impl::counting {
  * @param f the measured frequency vector
  * @return a state_vector which approximates the measured frequencies
  */
-state_vector initialization_vector( const frequency_vector& f ) {
+inline state_vector initialization_vector( const frequency_vector& f ) {
   const frequency_vector::size_type size = f.size();
   state_vector s;
   s.reserve( size );
@@ -206,7 +250,7 @@ state_vector initialization_vector( const frequency_vector& f ) {
  * @param lhs the output vector
  * @param rhs the vector to accumulate
  */
-void operator+=( frequency_vector& lhs, const frequency_vector& rhs ) {
+inline void operator+=( frequency_vector& lhs, const frequency_vector& rhs ) {
   const frequency_vector::size_type size = lhs.size();
   assert( size == rhs.size() );
   for ( frequency_vector::size_type i = 0; i < size; ++i ) {
@@ -21,9 +21,28 @@
 #define _OHTU7AY3EI_CABAC_DECODER_H 1
 
 #include <cabac/common-base.h>
+#include <cabac/observer.h>
+#include <cstddef>
+#include <iterator>
 
 namespace cabac {
 
+/**
+ * Point in a bitstream at which decoding can start.
+ *
+ * @see seek_index
+ */
+struct resync_point {
+  /** context states */
+  state_vector states;
+  /** position of the decoding window in bits from the start of the bitstream */
+  uint64_t bit;
+  /** interval range */
+  unsigned int range;
+  /** lower 9 bits of the lower interval bound of the encoder */
+  unsigned int low;
+};
+
 /**
  * CABAC %decoder.
  *
@@ -54,11 +73,19 @@ namespace cabac {
  *
  * dec.decode( ... ); // decode from here
  * @endcode
+ *
+ * The optional second template parameter specifies an observer class, which is notified about each
+ * decoded bin and each consumed byte (see null_observer). The optional third template parameter specifies
+ * the container of the context states (see sparse_states).
  */
-template< typename I >
-class decoder : public impl::decoder_base {
+template< typename I, class O, class S >
+class decoder : public impl::decoder_base< S > {
+
+  typedef impl::decoder_base< S > base_type;
+  using base_type::_states;
 
   I _data;
+  O _observer;
 
   unsigned int _range;
   unsigned int _offset;
@@ -77,38 +104,102 @@ class decoder : public impl::decoder_base {
     if ( !_mask ) {
       _data++;
       _mask = 128;
+      _observer.byte();
     }
-#ifdef CABAC_DEBUG_OUTPUT
-    ::std::cout << "READING BIT " << b << ::std::endl;
-#endif
     return b;
   }
 
+  /**
+   * Read n bits at once, most significant bit first.
+   *
+   * Equivalent to n calls to read_bit(), but consumes up to a whole byte per iteration.
+   */
+  unsigned int read_bits( unsigned int n ) {
+    unsigned int value = 0;
+    while ( n ) {
+      const unsigned int avail = impl::ctz( _mask ) + 1;
+      const unsigned int take = n < avail ? n : avail;
+      value = ( value << take ) | ( ( *_data >> ( avail - take ) ) & ( ( 1u << take ) - 1 ) );
+      n -= take;
+      if ( take == avail ) {
+        _data++;
+        _mask = 128;
+        _observer.byte();
+      } else {
+        _mask >>= take;
+      }
+    }
+    return value;
+  }
+
   /**
    * RenormD according to ISO/IEC 14496-10 / ITU-T Rec. H.264.
+   *
+   * Instead of shifting bit by bit, the number of shifts is determined from the leading
+   * zeroes of the range, and all required bits are read at once.
    */
   void renorm() {
-    while ( _range < 0x100 ) {
-      _range <<= 1;
-      _offset <<= 1;
-      _offset |= read_bit();
+    if ( _range < 0x100 ) {
+      const unsigned int shift = impl::clz( _range ) - 23;
+      _range <<= shift;
+      _offset = ( _offset << shift ) | read_bits( shift );
+      _observer.renorm( shift );
+    } else {
+      _observer.renorm( 0 );
     }
   }
 
   public:
 
+  typedef I iterator_type;
+  typedef O observer_type;
+
   /**
    * Constructor.
    *
    * @param input an STL-compatible input iterator on a container of uint8_t, used to read the bitstream
    * @param states the initial state vector
+   * @param observer the observer object
    */
-  decoder( const I &input, const state_vector &states ) :
-    impl::decoder_base( states ),
+  decoder( const I &input, const S &states, const O &observer = O() ) :
+    base_type( states ),
     _data( input ),
+    _observer( observer ),
     _range( 0x1fe ),
     _offset( ( *_data++ << 1 ) | ( ( *_data & 128 ) >> 7 ) ),
     _mask( 64 ) {
+    _observer.byte();
+  }
+
+  /**
+   * Construct at a resync point.
+   *
+   * Continues decoding with the bin following the resync point, as if all bins before it had been decoded.
+   * With a random access iterator (e.g. a pointer into a memory-mapped file), this takes constant time.
+   *
+   * @param input an STL-compatible input iterator on the start of the bitstream
+   * @param point the resync point
+   * @param observer the observer object
+   */
+  decoder( const I &input, const resync_point &point, const O &observer = O() ) :
+    base_type( point.states ),
+    _data( input ),
+    _observer( observer ),
+    _range( point.range ),
+    _offset( 0 ),
+    _mask( 128 >> ( point.bit & 7 ) ) {
+    ::std::advance( _data, point.bit >> 3 );
+    // the offset is the difference of the bitstream and the lower bound in the decoding window
+    _offset = ( read_bits( 9 ) - point.low ) & 0x1ff;
+  }
+
+  /**
+   * Get observer object.
+   *
+   * @return a reference to the observer object
+   */
+  inline O& observer() {
+    return _observer;
   }
 
   /**
@@ -124,18 +215,12 @@ class decoder : public impl::decoder_base {
   bool decode( const state_vector::size_type idx ) {
     assert( 0 <= idx );
     assert( idx < _states.size() );
-    const unsigned int state_idx = _states[ idx ] >> 1;
-    bool val_mps = _states[ idx ] & 1;
-#ifdef CABAC_DEBUG_OUTPUT
-    ::std::ostringstream s;
-    s << ::std::setfill( '0' ) << ::std::right
-      <<  "CTX " << ::std::setw( 3 ) << idx
-      << " RNG " << ::std::bitset< 16 >( _range ).to_string()
-      << " OFS " << ::std::bitset< 16 >( _offset ).to_string()
-      << " MPS " << val_mps
-      << " IDX " << ::std::setw( 2 ) << state_idx
-      << " DEC ";
-#endif
+    uint8_t &context = _states[ idx ];
+    const unsigned int state = context;
+    const unsigned int state_idx = state >> 1;
+    bool val_mps = state & 1;
+    const unsigned int range = _range;
+    const unsigned int offset = _offset;
     const unsigned int range_idx = ( _range >> 6 ) & 3;
     const unsigned int range_lps = range_tab_lps[ state_idx ][ range_idx ];
     _range -= range_lps;
@@ -146,18 +231,123 @@ class decoder : public impl::decoder_base {
       _range = range_lps;
       if ( state_idx == 0 )
         val_mps = !val_mps;
-      _states[ idx ] = ( trans_idx_lps[ state_idx ] << 1 ) | val_mps;
+      context = ( trans_idx_lps[ state_idx ] << 1 ) | val_mps;
     } else {
       bin_val = val_mps;
-      _states[ idx ] = ( trans_idx_mps[ state_idx ] << 1 ) | val_mps;
+      context = ( trans_idx_mps[ state_idx ] << 1 ) | val_mps;
     }
     renorm();
-#ifdef CABAC_DEBUG_OUTPUT
-    ::std::cout << s.str() << bin_val << ::std::endl;
-#endif
+    _observer.decision( idx, state, range, offset, bin_val );
+    return bin_val;
+  }
+
+  /**
+   * Decode a hard-to-predict binary decision.
+   *
+   * Yields exactly the same result as decode(), but determines the LPS / MPS outcome and
+   * performs the corresponding interval and state update using masks instead of a conditional
+   * branch. This is faster for contexts whose expectation value is close to 0.5, where the
+   * branch in decode() is mispredicted about every second time, and slower for skewed contexts.
+   *
+   * @param idx the index of the CABAC context
+   * @return the value of the decoded bin
+   */
+  bool decode_unpredictable( const state_vector::size_type idx ) {
+    assert( 0 <= idx );
+    assert( idx < _states.size() );
+    uint8_t &context = _states[ idx ];
+    const unsigned int state = context;
+    const unsigned int range = _range;
+    const unsigned int offset = _offset;
+    const unsigned int range_lps = range_tab_lps[ state >> 1 ][ ( _range >> 6 ) & 3 ];
+    _range -= range_lps;
+    const unsigned int lps = _offset >= _range;
+    const unsigned int mask = -lps;
+    _offset -= _range & mask;
+    _range ^= ( _range ^ range_lps ) & mask;
+    context = next_state_tab[ state ][ lps ];
+    renorm();
+    const bool bin_val = ( state ^ lps ) & 1;
+    _observer.decision( idx, state, range, offset, bin_val );
     return bin_val;
   }
 
+  /**
+   * Decode a binary decision with a fixed state.
+   *
+   * @see encoder::encode_static
+   *
+   * @param state the state, as in a state_vector
+   * @return the value of the decoded bin
+   */
+  bool decode_static( const unsigned int state ) {
+    assert( state < 128 );
+    const unsigned int range = _range;
+    const unsigned int offset = _offset;
+    const unsigned int range_lps = range_tab_lps[ state >> 1 ][ ( _range >> 6 ) & 3 ];
+    _range -= range_lps;
+    bool bin_val = state & 1;
+    if ( _offset >= _range ) {
+      bin_val = !bin_val;
+      _offset -= _range;
+      _range = range_lps;
+    }
+    renorm();
+    _observer.decision( static_context, state, range, offset, bin_val );
+    return bin_val;
+  }
+
+  /**
+   * Decode a run of MPS with the same context.
+   *
+   * @see encoder::encode_run
+   *
+   * Decodes bins until an LPS is decoded or max_n MPS are decoded, and yields exactly the same result
+   * as the corresponding calls to decode(). In the most skewed state, a run is decoded up to each
+   * renormalization in a single step, provided that the offset shows that no LPS occurs before it.
+   * As with encode_run(), the shortcuts are only taken with null_observer.
+   *
+   * @param idx the index of the CABAC context
+   * @param max_n the maximum number of MPS
+   * @return the number of decoded MPS; if less than max_n, an LPS was decoded after them
+   */
+  uint64_t decode_mps_run( const state_vector::size_type idx, const uint64_t max_n ) {
+    assert( 0 <= idx );
+    assert( idx < _states.size() );
+    uint8_t &context = _states[ idx ];
+    const unsigned int val_mps = context & 1;
+    uint64_t n = 0;
+    if ( !impl::is_null_observer< O >::value ) {
+      while ( n < max_n && decode( idx ) == val_mps )
+        ++n;
+      return n;
+    }
+    unsigned int state_idx = context >> 1;
+    while ( n < max_n ) {
+      if ( state_idx == 62 ) {
+        const uint8_t *run = mps_run_tab[ _range - 256 ];
+        if ( run[ 0 ] <= max_n - n && _offset < run[ 1 ] ) {
+          n += run[ 0 ];
+          _range = run[ 1 ];
+          renorm();
+          continue;
+        }
+      }
+      const unsigned int range = _range - range_tab_lps[ state_idx ][ ( _range >> 6 ) & 3 ];
+      if ( _offset >= range )
+        break;
+      _range = range;
+      state_idx = trans_idx_mps[ state_idx ];
+      ++n;
+      renorm();
+    }
+    context = ( state_idx << 1 ) | val_mps;
+    // the LPS ending the run
+    if ( n < max_n )
+      decode( idx );
+    return n;
+  }
+
   /**
    * Decode a binary decision using the bypass engine.
    *
@@ -168,27 +358,43 @@ class decoder : public impl::decoder_base {
    * @return the value of the decoded bin
    */
   bool decode_bypass() {
-#ifdef CABAC_DEBUG_OUTPUT
-    ::std::ostringstream s;
-    s << ::std::setfill( '0' ) << ::std::right
-      <<  "BYPASS "
-      << " RNG " << ::std::bitset< 16 >( _range ).to_string()
-      << " OFS " << ::std::bitset< 16 >( _offset ).to_string()
-      << " MPS -"
-      << " IDX --"
-      << " DEC ";
-#endif
+    const unsigned int offset = _offset;
     _offset <<= 1;
     _offset |= read_bit();
     const bool bin_val = ( _offset >= _range );
     if ( bin_val )
       _offset -= _range;
-#ifdef CABAC_DEBUG_OUTPUT
-    ::std::cout << s.str() << bin_val << ::std::endl;
-#endif
+    _observer.bypass( _range, offset, bin_val );
     return bin_val;
   }
 
+  /**
+   * Decode several binary decisions using the bypass engine.
+   *
+   * @see encoder::encode_bypass_bits
+   *
+   * Equivalent to n calls to decode_bypass(), but reads all bits at once and determines the bins by
+   * comparing the offset with the range, scaled to the position of each bin.
+   *
+   * @param n the number of bins, at most 16
+   * @return the values of the bins, the first in the most significant bit
+   */
+  unsigned int decode_bypass_bits( unsigned int n ) {
+    assert( n <= 16 );
+    unsigned int offset = ( _offset << n ) | read_bits( n );
+    unsigned int value = 0;
+    while ( n-- ) {
+      const unsigned int scaled_range = _range << n;
+      const bool bin_val = offset >= scaled_range;
+      _observer.bypass( _range, offset >> ( n + 1 ), bin_val );
+      if ( bin_val )
+        offset -= scaled_range;
+      value = ( value << 1 ) | bin_val;
+    }
+    _offset = offset;
+    return value;
+  }
+
   /**
    * Decode a terminal bit.
    *
@@ -199,30 +405,46 @@ class decoder : public impl::decoder_base {
    * @return the value of the decoded bin
    */
   bool decode_terminal() {
-#ifdef CABAC_DEBUG_OUTPUT
-    ::std::ostringstream s;
-    s << ::std::setfill( '0' ) << ::std::right
-      <<  "TERM   "
-      << " RNG " << ::std::bitset< 16 >( _range ).to_string()
-      << " OFS " << ::std::bitset< 16 >( _offset ).to_string()
-      << " MPS -"
-      << " IDX --"
-      << " DEC ";
-#endif
+    _observer.terminal( _range, _offset, _offset >= _range - 2 );
     _range -= 2;
-    if ( _offset >= _range ) {
-#ifdef CABAC_DEBUG_OUTPUT
-      ::std::cout << s.str() << '1' << ::std::endl;
-#endif
+    if ( _offset >= _range )
       return 1;
-    }
     renorm();
-#ifdef CABAC_DEBUG_OUTPUT
-    ::std::cout << s.str() << '0' << ::std::endl;
-#endif
     return 0;
   }
 
+  /**
+   * Skip raw bytes inserted by encoder::encode_raw().
+   *
+   * Decodes the terminal bit, which must be 1, skips the padding up to the next byte boundary, and
+   * restarts arithmetic decoding with the current states after the raw bytes. The raw bytes are not copied.
+   *
+   * The iterator type must be a forward iterator (e.g. a pointer), so that the returned iterator stays
+   * valid while decoding continues.
+   *
+   * @param n the number of raw bytes
+   * @return an iterator on the first raw byte
+   */
+  I decode_raw( const ::std::size_t n ) {
+    const bool terminal = decode_terminal();
+    assert( terminal );
+    ( void ) terminal;
+    // the last bit read is the last bit written by the flush of the encoder
+    if ( _mask != 128 ) {
+      _data++;
+      _mask = 128;
+      _observer.byte();
+    }
+    const I raw = _data;
+    for ( ::std::size_t i = 0; i < n; ++i ) {
+      _data++;
+      _observer.byte();
+    }
+    _range = 0x1fe;
+    _offset = read_bits( 9 );
+    return raw;
+  }
+
 };
 
 }
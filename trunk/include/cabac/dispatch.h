@@ -0,0 +1,193 @@
+//
+// This file is part of libcabac.
+//
+// Copyright 2008 Johannes Ballé <balle@ient.rwth-aachen.de>
+//
+// libcabac is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libcabac is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libcabac.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef _OHTU7AY3EI_CABAC_DISPATCH_H
+#define _OHTU7AY3EI_CABAC_DISPATCH_H 1
+
+#include <cabac/encoder.h>
+#include <cabac/decoder.h>
+#include <iterator>
+#include <cstddef>
+
+namespace cabac {
+
+/**
+ * Bitstream container used by the precompiled kernels.
+ */
+typedef ::std::vector< uint8_t > kernel_bitstream;
+
+/**
+ * CABAC %encoder type used by the precompiled kernels.
+ */
+typedef encoder< ::std::back_insert_iterator< kernel_bitstream > > kernel_encoder;
+
+/**
+ * CABAC %decoder type used by the precompiled kernels.
+ */
+typedef decoder< const uint8_t* > kernel_decoder;
+
+/**
+ * Context index selecting the bypass engine in kernel_table::encode_decisions and
+ * kernel_table::decode_decisions.
+ */
+const uint32_t kernel_bypass = ~static_cast< uint32_t >( 0 );
+
+/**
+ * Message to be encoded by kernel_table::encode_batch.
+ */
+struct batch_encode_message {
+  /** num context indexes, kernel_bypass selects the bypass engine */
+  const uint32_t *idx;
+  /** num bin values */
+  const uint8_t *bins;
+  /** number of decisions */
+  ::std::size_t num;
+};
+
+/**
+ * Message to be decoded by kernel_table::decode_batch.
+ */
+struct batch_decode_message {
+  /** the bitstream */
+  const uint8_t *data;
+  /** size of the bitstream in bytes */
+  ::std::size_t size;
+  /** num context indexes, kernel_bypass selects the bypass engine */
+  const uint32_t *idx;
+  /** receives num decoded bin values */
+  uint8_t *bins;
+  /** number of decisions */
+  ::std::size_t num;
+};
+
+/**
+ * Table of precompiled engine kernels.
+ *
+ * The template API in encoder.h and decoder.h is compiled with whatever instruction set the
+ * including translation unit targets. For binaries distributed to heterogeneous machines, the
+ * library additionally contains the hot loops of the engines compiled for several instruction
+ * set extensions (currently LZCNT and BMI2 on x86), one table per variant. kernels() selects the
+ * fastest variant supported by the executing CPU once, on first use.
+ *
+ * The kernels operate on kernel_encoder and kernel_decoder objects, which may be freely mixed with
+ * calls to their inline methods.
+ *
+ * The batch kernels code many small, independent messages at once. The SIMD variants ("avx2" and
+ * "avx512") run one message per vector lane; the other variants code one message after the other.
+ * All variants produce exactly the same bitstreams as a kernel_encoder.
+ */
+struct kernel_table {
+
+  /**
+   * Name of the instruction set variant ("generic", "lzcnt", "bmi2", "avx2" or "avx512").
+   */
+  const char *name;
+
+  /**
+   * Number of messages coded in parallel by the batch kernels.
+   */
+  unsigned int batch_lanes;
+
+  /**
+   * Encode a sequence of binary decisions.
+   *
+   * @param e the encoder object to be used
+   * @param idx num context indexes, kernel_bypass selects the bypass engine
+   * @param bins num bin values
+   * @param num number of decisions
+   */
+  void ( *encode_decisions )( kernel_encoder &e, const uint32_t *idx, const uint8_t *bins, ::std::size_t num );
+
+  /**
+   * Decode a sequence of binary decisions.
+   *
+   * @param d the decoder object to be used
+   * @param idx num context indexes, kernel_bypass selects the bypass engine
+   * @param bins receives num decoded bin values
+   * @param num number of decisions
+   */
+  void ( *decode_decisions )( kernel_decoder &d, const uint32_t *idx, uint8_t *bins, ::std::size_t num );
+
+  /**
+   * Decode a sequence of unsigned integers.
+   *
+   * @see decode_ueg
+   */
+  void ( *decode_ueg )( kernel_decoder &d, unsigned int k, state_vector::size_type idx, unsigned int num_ctx,
+    unsigned int *values, ::std::size_t num );
+
+  /**
+   * Decode a sequence of signed integers.
+   *
+   * @see decode_seg
+   */
+  void ( *decode_seg )( kernel_decoder &d, unsigned int k, state_vector::size_type idx, unsigned int num_ctx,
+    signed int *values, ::std::size_t num );
+
+  /**
+   * Encode a batch of independent messages.
+   *
+   * Each message is encoded starting from the given states, and its bitstream is appended to the
+   * corresponding bitstream container, exactly as a kernel_encoder would write it if the message was
+   * encoded and the encoder was destroyed afterwards.
+   *
+   * @param states the initial state vector of each message
+   * @param messages num messages
+   * @param num number of messages
+   * @param bitstreams num bitstream containers
+   */
+  void ( *encode_batch )( const state_vector &states, const batch_encode_message *messages, ::std::size_t num,
+    kernel_bitstream *bitstreams );
+
+  /**
+   * Decode a batch of independent messages.
+   *
+   * @see encode_batch
+   *
+   * @param states the initial state vector of each message
+   * @param messages num messages
+   * @param num number of messages
+   */
+  void ( *decode_batch )( const state_vector &states, const batch_decode_message *messages, ::std::size_t num );
+
+};
+
+/**
+ * Get the kernel table for the executing CPU.
+ *
+ * The variant is determined on the first call using cpuid. For testing purposes, the environment
+ * variable CABAC_KERNELS may name a variant to be used instead; if that variant is not available,
+ * the automatic choice is used.
+ *
+ * @return a reference to the selected kernel table
+ */
+const kernel_table& kernels();
+
+/**
+ * Get a specific kernel table.
+ *
+ * @param name the name of the instruction set variant
+ * @return a pointer to the kernel table, or 0 if the variant was not built or is not supported
+ * by the executing CPU
+ */
+const kernel_table* find_kernels( const char *name );
+
+}
+
+#endif
@@ -28,20 +28,23 @@ namespace impl {
 /**
  * @internal CABAC encoder base class.
  */
-class encoder_base : public base {
+template< class S = state_vector >
+class encoder_base : public base< S > {
 
   protected:
 
-  encoder_base( const state_vector &states ) :
-    base( states ) {
+  using base< S >::_states;
+
+  encoder_base( const S &states ) :
+    base< S >( states ) {
   }
 
   encoder_base( const encoder_base &other ) :
-    base( other ) {
+    base< S >( other ) {
   }
 
   encoder_base& operator=( const encoder_base &other ) {
-    base::operator=( other );
+    base< S >::operator=( other );
     return *this;
   }
 
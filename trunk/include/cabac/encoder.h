@@ -21,9 +21,55 @@
 #define _OHTU7AY3EI_CABAC_ENCODER_H 1
 
 #include <cabac/encoder-base.h>
+#include <cabac/observer.h>
+#include <cstddef>
 
 namespace cabac {
 
+/**
+ * Get the maximum size of a bitstream.
+ *
+ * This is a guaranteed upper bound on the number of bytes written by an encoder object for any bin
+ * values and context states, including the termination by the destructor. A decision costs at most
+ * 7 bits (an LPS in state 126 or 127, whose LPS range is 2), a bypass bin exactly 1 bit and a terminal
+ * bit of 0 at most 1 bit.
+ * For each call to encoder::encode_raw(), add n + 2 bytes.
+ *
+ * The bound allows to encode into preallocated memory through a raw pointer, see encoder.
+ *
+ * @param decisions the number of binary decisions
+ * @param bypass_bins the number of bins coded using the bypass engine
+ * @param terminals the number of terminal bits
+ * @return the maximum size in bytes
+ */
+inline uint64_t max_encoded_bytes( const uint64_t decisions, const uint64_t bypass_bins = 0,
+    const uint64_t terminals = 0 ) {
+  // the flush puts 10 bits, the first bit of the bitstream is skipped, the last byte is always written
+  return ( 7 * decisions + bypass_bins + terminals + 10 - 1 ) / 8 + 1;
+}
+
+/**
+ * Complete state of an encoder object, excluding its output iterator.
+ *
+ * @see encoder::save, encoder::restore
+ */
+struct encoder_state {
+  /** context states */
+  state_vector states;
+  /** lower interval bound */
+  unsigned int low;
+  /** interval range */
+  unsigned int range;
+  /** number of outstanding bits */
+  unsigned int bits_outstanding;
+  /** incomplete output byte */
+  unsigned int byte;
+  /** position of the next bit in the incomplete output byte */
+  int shift;
+  /** number of bytes written */
+  uint64_t bytes;
+};
+
 /**
  * CABAC %encoder.
  *
@@ -44,6 +90,23 @@ namespace cabac {
  *
  * This uses an STL vector of uint8_t to hold the bitstream. The call to reserve() ensures
  * that -- if the estimation is correct -- the vector does not have to reallocate memory too often.
+ * encoder< void >::predicted_bytes() gives a good estimation. While encoding, tell_bits() gives the number of bits
+ * produced so far, e.g. for rate control.
+ *
+ * If the number of bins is known in advance, the bitstream can be written to preallocated memory
+ * through a raw pointer instead, which avoids any reallocation and capacity check while encoding:
+ *
+ * @code
+ * bitstream bs( cabac::max_encoded_bytes( num_decisions, num_bypass_bins, 1 ) );
+ * uint64_t size;
+ * {
+ *   cabac::encoder< uint8_t* > enc( &bs[ 0 ], initial_states );
+ *   enc.encode( ... ); // encode from here
+ *   enc.encode_terminal( 1 );
+ *   size = enc.terminated_size();
+ * }
+ * bs.resize( size );
+ * @endcode
  *
  * Note that you can use *any* STL-compatible output iterator to write the bitstream to and that a pointer
  * to uint8_t is an iterator, too! (Hence, raw memory access is possible though not recommended.)
@@ -58,17 +121,26 @@ namespace cabac {
  *
  * enc.encode( ... ); // encode from here
  * @endcode
+ *
+ * The optional second template parameter specifies an observer class, which is notified about each
+ * coded bin and each written byte (see null_observer). The optional third template parameter specifies
+ * the container of the context states (see sparse_states).
  */
-template< typename I >
-class encoder : public impl::encoder_base {
+template< typename I, class O, class S >
+class encoder : public impl::encoder_base< S > {
+
+  typedef impl::encoder_base< S > base_type;
+  using base_type::_states;
 
   I _data;
+  O _observer;
 
   unsigned int _low;
   unsigned int _range;
   unsigned int _bits_outstanding;
   unsigned int _byte;
   int _shift;
+  uint64_t _bytes;
 
   // prohibit duplication of object
   encoder( const encoder &other );
@@ -78,13 +150,12 @@ class encoder : public impl::encoder_base {
    * WriteBits according to ISO/IEC 14496-10 / ITU-T Rec. H.264.
    */
   void write_bit( const bool b ) {
-#ifdef CABAC_DEBUG_OUTPUT
-    ::std::cout << "WRITING BIT " << b << ::std::endl;
-#endif
     _byte |= ( b << _shift );
     --_shift;
     if ( _shift < 0 ) {
       *_data++ = _byte;
+      _observer.byte();
+      ++_bytes;
       _byte = 0;
       _shift = 7;
     }
@@ -95,6 +166,8 @@ class encoder : public impl::encoder_base {
    */
   void put_bit( const bool b ) {
     write_bit( b );
+    if ( _bits_outstanding )
+      _observer.outstanding( _bits_outstanding );
     while ( _bits_outstanding ) {
       write_bit( !b );
       --_bits_outstanding;
@@ -105,6 +178,7 @@ class encoder : public impl::encoder_base {
    * RenormE according to ISO/IEC 14496-10 / ITU-T Rec. H.264.
    */
   void renorm() {
+    unsigned int shifts = 0;
     while ( _range < 0x100 ) {
       if ( _low < 0x100 ) {
         put_bit( 0 );
@@ -119,7 +193,9 @@ class encoder : public impl::encoder_base {
       }
       _range <<= 1;
       _low <<= 1;
+      ++shifts;
     }
+    _observer.renorm( shifts );
   }
 
   /**
@@ -136,21 +212,46 @@ class encoder : public impl::encoder_base {
   public:
 
   typedef I iterator_type;
+  typedef O observer_type;
 
   /**
    * Constructor.
    *
    * @param output an STL-compatible output iterator on a container of uint8_t, used to write the bitstream
    * @param states the initial state vector
+   * @param observer the observer object
    */
-  encoder( const I &output, const state_vector &states ) :
-    encoder_base( states ),
+  encoder( const I &output, const S &states, const O &observer = O() ) :
+    base_type( states ),
     _data( output ),
+    _observer( observer ),
     _low( 0 ),
     _range( 0x1fe ),
     _bits_outstanding( 0 ),
     _byte( 0 ),
-    _shift( 8 ) {
+    _shift( 8 ),
+    _bytes( 0 ) {
+  }
+
+  /**
+   * Construct from saved state.
+   *
+   * Continues coding exactly where the encoder the state was saved from stopped.
+   *
+   * @param output an STL-compatible output iterator, positioned after the bytes written up to the save
+   * @param state the saved encoder state
+   * @param observer the observer object
+   */
+  encoder( const I &output, const encoder_state &state, const O &observer = O() ) :
+    base_type( state.states ),
+    _data( output ),
+    _observer( observer ),
+    _low( state.low ),
+    _range( state.range ),
+    _bits_outstanding( state.bits_outstanding ),
+    _byte( state.byte ),
+    _shift( state.shift ),
+    _bytes( state.bytes ) {
   }
 
   /**
@@ -162,6 +263,100 @@ class encoder : public impl::encoder_base {
   ~encoder() {
     flush();
     *_data++ = _byte;
+    _observer.byte();
+    ++_bytes;
+  }
+
+  /**
+   * Get observer object.
+   *
+   * @return a reference to the observer object
+   */
+  inline O& observer() {
+    return _observer;
+  }
+
+  /**
+   * Get number of bytes written so far.
+   *
+   * Bits which are held back by the encoder are not counted.
+   */
+  inline uint64_t bytes() const {
+    return _bytes;
+  }
+
+  /**
+   * Get size of the bitstream if it was terminated now.
+   *
+   * This is the exact number of bytes the bitstream would have after calling encode_terminal( 1 )
+   * and destroying the encoder object.
+   */
+  inline uint64_t terminated_size() const {
+    // flushing puts 10 more bits, the last incomplete byte is always written
+    return _bytes + ( 7 - _shift + _bits_outstanding + 10 ) / 8 + 1;
+  }
+
+  /**
+   * Get number of bits produced so far.
+   *
+   * The integer part counts all bits which are determined, including the bits held back by the encoder,
+   * i.e. the incomplete byte and the outstanding bits. The pending state of the arithmetic coder adds
+   * 2 - log2( range / 256 ) bits, so that the difference between two calls approximates the self
+   * information of the bins coded in between, just like encoder< void >::bits(). Takes constant time.
+   *
+   * After encode_terminal( 1 ), the flushed bits are counted instead, including the stop bit, but not
+   * the zero bits padding the bitstream to a byte boundary.
+   *
+   * @return the number of bits in bits * 256
+   */
+  inline uint64_t tell_bits() const {
+    // 7 - _shift is -1 until the first bit, which is skipped, has been put
+    const uint64_t committed = _bytes * 8 + 7 - _shift + _bits_outstanding;
+    if ( _range < 0x100 ) {
+      // terminated, flushing puts 10 more bits
+      assert( _range == 2 );
+      return ( committed + 10 ) << 8;
+    }
+    assert( _range < 0x200 );
+    return ( ( committed + 2 ) << 8 ) - range_bits_tab[ _range - 0x100 ];
+  }
+
+  /**
+   * Save the complete encoder state.
+   *
+   * Together with restore(), this allows to undo coding decisions, e.g. in order to try alternatives.
+   * Note that the whole state vector is copied.
+   *
+   * @param state receives the state
+   */
+  void save( encoder_state &state ) const {
+    state.states = _states;
+    state.low = _low;
+    state.range = _range;
+    state.bits_outstanding = _bits_outstanding;
+    state.byte = _byte;
+    state.shift = _shift;
+    state.bytes = _bytes;
+  }
+
+  /**
+   * Restore a saved encoder state.
+   *
+   * The bytes written after the state was saved must be discarded by the caller, and the output
+   * iterator must be positioned accordingly, i.e. state.bytes bytes after the start of the bitstream.
+   *
+   * @param state the state to restore
+   * @param output the repositioned output iterator
+   */
+  void restore( const encoder_state &state, const I &output ) {
+    _data = output;
+    _states = state.states;
+    _low = state.low;
+    _range = state.range;
+    _bits_outstanding = state.bits_outstanding;
+    _byte = state.byte;
+    _shift = state.shift;
+    _bytes = state.bytes;
   }
 
   /**
@@ -180,17 +375,10 @@ class encoder : public impl::encoder_base {
   void encode( const state_vector::size_type idx, const bool bin_val ) {
     assert( 0 <= idx );
     assert( idx < _states.size() );
-    const unsigned int state_idx = _states[ idx ] >> 1;
-    bool val_mps = _states[ idx ] & 1;
-#ifdef CABAC_DEBUG_OUTPUT
-    ::std::cout << ::std::setfill( '0' ) << ::std::right
-      <<  "CTX " << ::std::setw( 3 ) << idx
-      << " RNG " << ::std::bitset< 16 >( _range ).to_string()
-      << " LOW " << ::std::bitset< 16 >( _low ).to_string()
-      << " MPS " << val_mps
-      << " IDX " << ::std::setw( 2 ) << state_idx
-      << " DEC " << bin_val << ::std::endl;
-#endif
+    uint8_t &state = _states[ idx ];
+    const unsigned int state_idx = state >> 1;
+    bool val_mps = state & 1;
+    _observer.decision( idx, state, _range, _low, bin_val );
     const unsigned int range_idx = ( _range >> 6 ) & 3;
     const unsigned int range_lps = range_tab_lps[ state_idx ][ range_idx ];
     _range -= range_lps;
@@ -199,13 +387,108 @@ class encoder : public impl::encoder_base {
       _range = range_lps;
       if ( state_idx == 0 )
         val_mps = !val_mps;
-      _states[ idx ] = ( trans_idx_lps[ state_idx ] << 1 ) | val_mps;
+      state = ( trans_idx_lps[ state_idx ] << 1 ) | val_mps;
     } else {
-      _states[ idx ] = ( trans_idx_mps[ state_idx ] << 1 ) | val_mps;
+      state = ( trans_idx_mps[ state_idx ] << 1 ) | val_mps;
+    }
+    renorm();
+  }
+
+  /**
+   * Encode a hard-to-predict binary decision.
+   *
+   * Produces exactly the same bitstream as encode(), but performs the interval and state update
+   * using masks instead of a conditional branch on the LPS / MPS outcome. Use this for contexts
+   * whose expectation value is close to 0.5, and encode() for skewed contexts.
+   *
+   * @param idx the index of the CABAC context
+   * @param bin_val the value of the bin
+   */
+  void encode_unpredictable( const state_vector::size_type idx, const bool bin_val ) {
+    assert( 0 <= idx );
+    assert( idx < _states.size() );
+    uint8_t &context = _states[ idx ];
+    const unsigned int state = context;
+    _observer.decision( idx, state, _range, _low, bin_val );
+    const unsigned int range_lps = range_tab_lps[ state >> 1 ][ ( _range >> 6 ) & 3 ];
+    const unsigned int lps = ( state ^ bin_val ) & 1;
+    const unsigned int mask = -lps;
+    _range -= range_lps;
+    _low += _range & mask;
+    _range ^= ( _range ^ range_lps ) & mask;
+    context = next_state_tab[ state ][ lps ];
+    renorm();
+  }
+
+  /**
+   * Encode a binary decision with a fixed state.
+   *
+   * Codes the bin like encode() with a context in the given state, but without a context and without
+   * any state update. Use this for contexts whose statistics are known to be stationary, see compile_model().
+   * The observer is notified of the bin as a decision with the index static_context.
+   *
+   * @param state the state, as in a state_vector
+   * @param bin_val the value of the bin
+   */
+  void encode_static( const unsigned int state, const bool bin_val ) {
+    assert( state < 128 );
+    _observer.decision( static_context, state, _range, _low, bin_val );
+    const unsigned int range_lps = range_tab_lps[ state >> 1 ][ ( _range >> 6 ) & 3 ];
+    _range -= range_lps;
+    if ( ( state ^ bin_val ) & 1 ) {
+      _low += _range;
+      _range = range_lps;
     }
     renorm();
   }
 
+  /**
+   * Encode a run of MPS, optionally followed by an LPS, with the same context.
+   *
+   * Produces exactly the same bitstream as n_mps calls to encode() with the MPS of the context, followed
+   * by one call with the LPS if then_lps is set. The MPS are coded in a tight loop, and once the context
+   * reaches the most skewed state (pStateIdx 62), which the MPS does not change, up to each renormalization
+   * in a single step using mps_run_tab. Use this for contexts which are almost always the MPS, e.g. flags
+   * which are nearly always zero.
+   *
+   * The shortcut is only taken with null_observer, otherwise the observer is notified of each bin.
+   *
+   * @param idx the index of the CABAC context
+   * @param n_mps the number of MPS
+   * @param then_lps whether an LPS follows the run
+   */
+  void encode_run( const state_vector::size_type idx, uint64_t n_mps, const bool then_lps ) {
+    assert( 0 <= idx );
+    assert( idx < _states.size() );
+    uint8_t &context = _states[ idx ];
+    const unsigned int val_mps = context & 1;
+    if ( impl::is_null_observer< O >::value ) {
+      // the state is kept in a register, as the MPS never changes val_mps
+      unsigned int state_idx = context >> 1;
+      while ( n_mps ) {
+        if ( state_idx == 62 ) {
+          const uint8_t *run = mps_run_tab[ _range - 256 ];
+          if ( run[ 0 ] <= n_mps ) {
+            n_mps -= run[ 0 ];
+            _range = run[ 1 ];
+            renorm();
+            continue;
+          }
+        }
+        _range -= range_tab_lps[ state_idx ][ ( _range >> 6 ) & 3 ];
+        state_idx = trans_idx_mps[ state_idx ];
+        --n_mps;
+        renorm();
+      }
+      context = ( state_idx << 1 ) | val_mps;
+    } else {
+      for ( ; n_mps; --n_mps )
+        encode( idx, val_mps );
+    }
+    if ( then_lps )
+      encode( idx, !val_mps );
+  }
+
   /**
    * Encode a binary decision using the bypass engine.
    *
@@ -219,15 +502,7 @@ class encoder : public impl::encoder_base {
    * @param bin_val the value of the bin
    */
   void encode_bypass( const bool bin_val ) {
-#ifdef CABAC_DEBUG_OUTPUT
-    ::std::cout << ::std::setfill( '0' ) << ::std::right
-      <<  "BYPASS "
-      << " RNG " << ::std::bitset< 16 >( _range ).to_string()
-      << " LOW " << ::std::bitset< 16 >( _low ).to_string()
-      << " MPS -"
-      << " IDX --"
-      << " DEC " << bin_val << ::std::endl;
-#endif
+    _observer.bypass( _range, _low, bin_val );
     _low <<= 1;
     if ( bin_val )
       _low += _range;
@@ -244,6 +519,45 @@ class encoder : public impl::encoder_base {
     }
   }
 
+  /**
+   * Encode several binary decisions using the bypass engine.
+   *
+   * Produces the same bitstream as n calls to encode_bypass(), most significant bit first, but updates
+   * the lower interval bound once for all bins. The n bits shifted out of the lower bound are appended
+   * to the outstanding bits: all bits up to the last zero are written, the trailing ones remain outstanding.
+   * Runs of outstanding bits within the bins are written directly, so an observer is notified of fewer
+   * resolved runs than with encode_bypass().
+   *
+   * @param value the values of the bins
+   * @param n the number of bins, at most 16
+   */
+  void encode_bypass_bits( const unsigned int value, const unsigned int n ) {
+    assert( n <= 16 );
+    assert( !( value >> n ) );
+    // the lower bound before each bin is congruent to the partial sum, and less than 0x200
+    for ( unsigned int j = 0; j < n; ++j )
+      _observer.bypass( _range, ( ( _low << j ) + ( value >> ( n - j ) ) * _range ) & 0x1ff, ( value >> ( n - 1 - j ) ) & 1 );
+    const unsigned int x = ( _low << n ) + value * _range;
+    const unsigned int bits = ( x >> 9 ) & ( ( 1u << n ) - 1 );
+    const bool carry = x >> ( 9 + n );
+    const unsigned int ones = impl::ctz( ~bits );
+    _low = x & 0x1ff;
+    if ( ones >= n ) {
+      if ( carry ) {
+        // the carry turns the outstanding bits into zeros, the last of which precedes the new ones
+        assert( _bits_outstanding );
+        --_bits_outstanding;
+        put_bit( 1 );
+      }
+      _bits_outstanding += n;
+      return;
+    }
+    put_bit( carry );
+    for ( unsigned int j = n - 1; j > ones; --j )
+      write_bit( ( bits >> j ) & 1 );
+    _bits_outstanding = ones;
+  }
+
   /**
    * Encode a terminal bit.
    *
@@ -263,23 +577,51 @@ class encoder : public impl::encoder_base {
    * @param bin_val indicates 1 for termination of the bitstream, 0 for continuation.
    */
   void encode_terminal( const bool bin_val ) {
-#ifdef CABAC_DEBUG_OUTPUT
-    ::std::cout << ::std::setfill( '0' ) << ::std::right
-      <<  "TERM   "
-      << " RNG " << ::std::bitset< 16 >( _range ).to_string()
-      << " LOW " << ::std::bitset< 16 >( _low ).to_string()
-      << " MPS -"
-      << " IDX --"
-      << " DEC " << bin_val << ::std::endl;
-#endif
+    _observer.terminal( _range, _low, bin_val );
     _range -= 2;
     if ( bin_val ) {
       _low += _range;
+      // the interval is final, flush() only needs the range it sets itself
+      _range = 2;
     } else {
       renorm();
     }
   }
 
+  /**
+   * Insert raw bytes into the bitstream.
+   *
+   * Terminates arithmetic coding with a terminal bit of 1, flushes the encoder, pads the bitstream
+   * with zero bits up to the next byte boundary, and copies the given bytes to the output unchanged.
+   * Arithmetic coding then restarts with the current states, as after pcm_sample_luma and
+   * pcm_sample_chroma in ISO/IEC 14496-10 / ITU-T Rec. H.264.
+   *
+   * Use this for incompressible data, which is copied at memory bandwidth instead of being
+   * coded bin by bin. The decoder must call decoder::decode_raw() at the same point.
+   *
+   * @param first an input iterator on the bytes to be inserted
+   * @param n the number of bytes
+   */
+  template< typename R >
+  void encode_raw( R first, const ::std::size_t n ) {
+    encode_terminal( 1 );
+    flush();
+    if ( _shift < 7 ) {
+      *_data++ = _byte;
+      _observer.byte();
+      ++_bytes;
+    }
+    for ( ::std::size_t i = 0; i < n; ++i ) {
+      *_data++ = *first++;
+      _observer.byte();
+    }
+    _bytes += n;
+    _low = 0;
+    _range = 0x1fe;
+    _byte = 0;
+    _shift = 8;
+  }
+
 };
 
 
@@ -296,8 +638,11 @@ class encoder : public impl::encoder_base {
  *
  * This can be used to simulate encoding for rate-distortion decisions.
  */
-template<>
-class encoder< void > : public impl::encoder_base {
+template< class S >
+class encoder< void, null_observer, S > : public impl::encoder_base< S > {
+
+  typedef impl::encoder_base< S > base_type;
+  using base_type::_states;
 
   unsigned int _bits;
 
@@ -308,8 +653,8 @@ class encoder< void > : public impl::encoder_base {
    *
    * @param states initial states.
    */
-  encoder( const state_vector &states ) :
-    encoder_base( states ),
+  encoder( const S &states ) :
+    base_type( states ),
     _bits( 0 ) {
   }
 
@@ -319,8 +664,8 @@ class encoder< void > : public impl::encoder_base {
    * Useful in order to branch a simulation. The bit count and state vector of the other
    * object is copied.
    */
-  encoder( const encoder< void > &other ) :
-    encoder_base( other ),
+  encoder( const encoder &other ) :
+    base_type( other ),
     _bits( other._bits ) {
   }
 
@@ -329,8 +674,8 @@ class encoder< void > : public impl::encoder_base {
    *
    * The bit count starts with zero, the state vector of the encoder object is copied.
    */
-  encoder( const encoder_base &other ) :
-    encoder_base( other ),
+  encoder( const base_type &other ) :
+    base_type( other ),
     _bits( 0 ) {
   }
 
@@ -339,8 +684,8 @@ class encoder< void > : public impl::encoder_base {
    *
    * Has the same semantics as its constructor counterpart.
    */
-  encoder< void >& operator=( const encoder< void > &other ) {
-    encoder_base::operator=( other );
+  encoder& operator=( const encoder &other ) {
+    base_type::operator=( other );
     _bits = other._bits;
     return *this;
   }
@@ -350,8 +695,8 @@ class encoder< void > : public impl::encoder_base {
    *
    * Has the same semantics as its constructor counterpart.
    */
-  encoder< void >& operator=( const encoder_base &other ) {
-    encoder_base::operator=( other );
+  encoder& operator=( const base_type &other ) {
+    base_type::operator=( other );
     _bits = 0;
     return *this;
   }
@@ -368,21 +713,67 @@ class encoder< void > : public impl::encoder_base {
   void encode( const state_vector::size_type idx, const bool bin_val ) {
     assert( 0 <= idx );
     assert( idx < _states.size() );
-    const unsigned int bits = bits_tab[ _states[ idx ] ^ bin_val ];
-    const unsigned int state_idx = _states[ idx ] >> 1;
-    bool val_mps = _states[ idx ] & 1;
+    uint8_t &state = _states[ idx ];
+    const unsigned int bits = bits_tab[ state ^ bin_val ];
+    const unsigned int state_idx = state >> 1;
+    bool val_mps = state & 1;
     _bits += bits;
     if ( bin_val != val_mps ) {
       assert( bits == FIX8( BITS( PLPS( state_idx ) ) ) );
       if ( state_idx == 0 )
         val_mps = !val_mps;
-      _states[ idx ] = ( trans_idx_lps[ state_idx ] << 1 ) | val_mps;
+      state = ( trans_idx_lps[ state_idx ] << 1 ) | val_mps;
     } else {
       assert( bits == FIX8( BITS( 1 - PLPS( state_idx ) ) ) );
-      _states[ idx ] = ( trans_idx_mps[ state_idx ] << 1 ) | val_mps;
+      state = ( trans_idx_mps[ state_idx ] << 1 ) | val_mps;
     }
   }
 
+  /**
+   * Simulate a hard-to-predict binary decision.
+   *
+   * Same as encode(), provided for interface compatibility with encoder::encode_unpredictable().
+   *
+   * @param idx the index of the CABAC context
+   * @param bin_val the value of the bin
+   */
+  inline void encode_unpredictable( const state_vector::size_type idx, const bool bin_val ) {
+    encode( idx, bin_val );
+  }
+
+  /**
+   * Simulate a binary decision with a fixed state.
+   *
+   * @see encoder::encode_static
+   *
+   * @param state the state, as in a state_vector
+   * @param bin_val the value of the bin
+   */
+  inline void encode_static( const unsigned int state, const bool bin_val ) {
+    assert( state < 128 );
+    _bits += bits_tab[ state ^ bin_val ];
+  }
+
+  /**
+   * Simulate a run of MPS, optionally followed by an LPS, with the same context.
+   *
+   * @see encoder::encode_run
+   *
+   * @param idx the index of the CABAC context
+   * @param n_mps the number of MPS
+   * @param then_lps whether an LPS follows the run
+   */
+  void encode_run( const state_vector::size_type idx, uint64_t n_mps, const bool then_lps ) {
+    assert( 0 <= idx );
+    assert( idx < _states.size() );
+    for ( ; n_mps && ( _states[ idx ] >> 1 ) != 62; --n_mps )
+      encode( idx, _states[ idx ] & 1 );
+    // the MPS does not change the most skewed state
+    _bits += static_cast< unsigned int >( n_mps ) * bits_tab[ _states[ idx ] & ~1u ];
+    if ( then_lps )
+      encode( idx, !( _states[ idx ] & 1 ) );
+  }
+
   /**
    * Simulate a binary decision using the bypass engine.
    *
@@ -394,6 +785,19 @@ class encoder< void > : public impl::encoder_base {
     _bits += 1 << 8;
   }
 
+  /**
+   * Simulate several binary decisions using the bypass engine.
+   *
+   * This method just adds n to the bit count.
+   *
+   * @param value the values of the bins
+   * @param n the number of bins, at most 16
+   */
+  inline void encode_bypass_bits( const unsigned int value, const unsigned int n ) {
+    assert( n <= 16 );
+    _bits += n << 8;
+  }
+
   /**
    * Get self information bit count.
    *
@@ -403,6 +807,20 @@ class encoder< void > : public impl::encoder_base {
     return _bits;
   }
 
+  /**
+   * Predict the size of the bitstream.
+   *
+   * Returns the size a bitstream would have which contains the simulated decisions and is terminated
+   * by encoding a terminal bit of 1 and destroying the encoder. The actual size deviates from the self
+   * information by a few bits only, but may be larger or smaller. Use max_encoded_bytes() for a guaranteed
+   * bound.
+   *
+   * @return the predicted size in bytes
+   */
+  inline uint64_t predicted_bytes() const {
+    return ( ( ( _bits + 255 ) >> 8 ) + 10 - 1 ) / 8 + 1;
+  }
+
   /**
    * Reset self information bit count to zero.
    */
@@ -91,6 +91,81 @@ inline void encode_sf( E &e, signed int value, unsigned int k ) {
     e.encode_bypass( ( value >> k ) & 1 );
 }
 
+/**
+  * Encode an unsigned integer with a limited Exp-Golomb prefix.
+  *
+  * Like encode_ueg, but the unary prefix of the Exp-Golomb(k) part is limited to max_prefix
+  * ones, similar to coeff_abs_level_remaining in HEVC with extended precision processing.
+  * Values requiring a longer prefix are coded as max_prefix ones followed by an escape, i.e.
+  * the difference to the first escaped value in escape_bits bypass bins. Values with a prefix
+  * shorter than max_prefix produce the same bins as with encode_ueg. The number of bins per
+  * value is bounded by ueg_limited_max_bins.
+  *
+  * @param e the encoder object to be used
+  * @param value the integer value to be encoded.
+  * @param k parameterization value of the Exp-Golomb encoding
+  * @param max_prefix maximum length of the unary prefix, 1 <= max_prefix and k + max_prefix <= 32
+  * @param escape_bits number of bins of the escape, 1 <= escape_bits <= 32
+  * @param idx first context index to be used
+  * @param num_ctx number of context indexes to be used
+  */
+template< class E >
+inline void encode_ueg_limited( E &e, unsigned int value, unsigned int k, const unsigned int max_prefix,
+    const unsigned int escape_bits, state_vector::size_type idx = ~0, const unsigned int num_ctx = 0 ) {
+  assert( max_prefix && k + max_prefix <= 32 );
+  assert( escape_bits && escape_bits <= 32 );
+  const state_vector::size_type max_idx = idx + num_ctx;
+  while ( idx < max_idx ) {
+    const bool zero = ( value == 0 );
+    e.encode( idx++, zero );
+    if ( zero )
+      return;
+    value--;
+  }
+  for ( unsigned int prefix = 0; value >= ( static_cast< unsigned int >( 1 ) << k ); ) {
+    e.encode_bypass( 1 );
+    value -= 1u << k++;
+    if ( ++prefix == max_prefix ) {
+      assert( escape_bits == 32 || value < ( static_cast< unsigned int >( 1 ) << escape_bits ) );
+      encode_uf( e, value, escape_bits );
+      return;
+    }
+  }
+  e.encode_bypass( 0 );
+  while ( k-- )
+    e.encode_bypass( ( value >> k ) & 1 );
+}
+
+/**
+  * Encode a signed integer with a limited Exp-Golomb prefix.
+  *
+  * @see encode_seg
+  * @see encode_ueg_limited
+  */
+template< class E >
+inline void encode_seg_limited( E &e, const signed int value, const unsigned int k, const unsigned int max_prefix,
+    const unsigned int escape_bits, state_vector::size_type idx = ~0, const unsigned int num_ctx = 0 ) {
+  const unsigned int abs_value = ::std::abs( value );
+  encode_ueg_limited( e, abs_value * 2 - ( value < 0 ), k, max_prefix, escape_bits, idx, num_ctx );
+}
+
+/**
+  * Maximum number of bins of a value coded with encode_ueg_limited or encode_seg_limited.
+  *
+  * @param k parameterization value of the Exp-Golomb encoding
+  * @param max_prefix maximum length of the unary prefix
+  * @param escape_bits number of bins of the escape
+  * @param num_ctx number of context indexes used
+  * @return the number of context-coded and bypass bins in the worst case
+  */
+inline unsigned int ueg_limited_max_bins( const unsigned int k, const unsigned int max_prefix,
+    const unsigned int escape_bits, const unsigned int num_ctx = 0 ) {
+  // longest regular code: max_prefix - 1 ones, terminating zero and k + max_prefix - 1 suffix bins
+  const unsigned int regular = 2 * max_prefix - 1 + k;
+  const unsigned int escape = max_prefix + escape_bits;
+  return num_ctx + ( regular > escape ? regular : escape );
+}
+
 /**
   * Decode an unsigned integer.
   *
@@ -159,6 +234,59 @@ inline signed int decode_sf( D &d, unsigned int k ) {
   return value;
 }
 
+/**
+  * Decode an unsigned integer with a limited Exp-Golomb prefix.
+  *
+  * Reads at most ueg_limited_max_bins bins, regardless of the input.
+  *
+  * @see encode_ueg_limited
+  *
+  * @param d the decoder object to be used
+  * @param k parameterization value of the Exp-Golomb encoding
+  * @param max_prefix maximum length of the unary prefix
+  * @param escape_bits number of bins of the escape
+  * @param idx first context index to be used
+  * @param num_ctx number of context indexes to be used
+  * @return the decoded value
+  */
+template< class D >
+inline unsigned int decode_ueg_limited( D &d, unsigned int k, const unsigned int max_prefix,
+    const unsigned int escape_bits, state_vector::size_type idx = ~0, const unsigned int num_ctx = 0 ) {
+  assert( max_prefix && k + max_prefix <= 32 );
+  assert( escape_bits && escape_bits <= 32 );
+  unsigned int value = 0;
+  const state_vector::size_type max_idx = idx + num_ctx;
+  while ( idx < max_idx ) {
+    if ( d.decode( idx++ ) )
+      return value;
+    value++;
+  }
+  for ( unsigned int prefix = 0; d.decode_bypass(); ) {
+    value += 1u << k++;
+    if ( ++prefix == max_prefix )
+      return value + decode_uf( d, escape_bits );
+  }
+  while ( k-- )
+    if ( d.decode_bypass() )
+      value += 1u << k;
+  return value;
+}
+
+/**
+  * Decode a signed integer with a limited Exp-Golomb prefix.
+  *
+  * @see encode_seg_limited
+  */
+template< class D >
+inline signed int decode_seg_limited( D &d, const unsigned int k, const unsigned int max_prefix,
+    const unsigned int escape_bits, const state_vector::size_type idx = ~0, const unsigned int num_ctx = 0 ) {
+  const unsigned int dec_value = decode_ueg_limited( d, k, max_prefix, escape_bits, idx, num_ctx );
+  signed int value = ( dec_value + 1 ) / 2;
+  if ( dec_value & 1 )
+    value *= -1;
+  return value;
+}
+
 }
 
 #endif
@@ -0,0 +1,199 @@
+//
+// This file is part of libcabac.
+//
+// Copyright 2008 Johannes Ballé <balle@ient.rwth-aachen.de>
+//
+// libcabac is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libcabac is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libcabac.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef _OHTU7AY3EI_CABAC_METRICS_H
+#define _OHTU7AY3EI_CABAC_METRICS_H 1
+
+#include <cabac/observer.h>
+#include <atomic>
+#include <chrono>
+
+namespace cabac {
+
+/**
+ * Snapshot of engine counters.
+ */
+struct engine_metrics {
+  /** number of bins coded using a context */
+  uint64_t decisions;
+  /** number of bins coded using the bypass engine */
+  uint64_t bypass_bins;
+  /** number of terminal bits */
+  uint64_t terminal_bins;
+  /** number of renormalizations which shifted at least one bit */
+  uint64_t renorms;
+  /** total number of renormalization iterations */
+  uint64_t renorm_shifts;
+  /** number of bytes written or read */
+  uint64_t bytes;
+  /** number of resolved runs of outstanding bits (encoder only) */
+  uint64_t outstanding_runs;
+  /** longest run of outstanding bits (encoder only) */
+  uint64_t max_outstanding;
+  /** number of completed timing periods */
+  uint64_t periods;
+  /** total time spent in completed timing periods, in nanoseconds */
+  uint64_t period_ns;
+  /** longest completed timing period, in nanoseconds */
+  uint64_t max_period_ns;
+};
+
+/**
+ * Thread-safe publication point for engine_metrics.
+ *
+ * A metrics_observer periodically stores its counters here, from where a monitoring thread
+ * may read them at any time without locking.
+ */
+class metrics_sink {
+
+  static const unsigned int num_counters = sizeof( engine_metrics ) / sizeof( uint64_t );
+
+  ::std::atomic< uint64_t > _counters[ num_counters ];
+
+  // prohibit duplication of object
+  metrics_sink( const metrics_sink &other );
+  metrics_sink& operator=( const metrics_sink &other );
+
+  public:
+
+  metrics_sink();
+
+  /**
+   * Store a snapshot.
+   */
+  void publish( const engine_metrics &m );
+
+  /**
+   * Get the most recently published snapshot.
+   *
+   * The counters are read individually, so they may stem from consecutive publications.
+   */
+  engine_metrics snapshot() const;
+
+};
+
+/**
+ * Engine observer which collects engine_metrics.
+ *
+ * Every period bins, the observer measures the elapsed time and publishes its counters to the
+ * metrics_sink given on construction (if any), and once more on destruction. The counters of the
+ * observer itself can be read at any time from the coding thread using metrics().
+ *
+ * @code
+ * cabac::metrics_sink sink; // scraped by the monitoring thread
+ * cabac::encoder< iter_type, cabac::metrics_observer > enc( iter_type( bs ), initial_states, cabac::metrics_observer( &sink ) );
+ * @endcode
+ */
+class metrics_observer : public null_observer {
+
+  typedef ::std::chrono::steady_clock clock;
+
+  engine_metrics _metrics;
+  metrics_sink *_sink;
+  unsigned int _period;
+  unsigned int _bins;
+  clock::time_point _start;
+
+  inline void bin() {
+    if ( ++_bins == _period )
+      end_period();
+  }
+
+  void end_period() {
+    const clock::time_point now = clock::now();
+    const uint64_t ns = ::std::chrono::duration_cast< ::std::chrono::nanoseconds >( now - _start ).count();
+    _metrics.periods++;
+    _metrics.period_ns += ns;
+    if ( ns > _metrics.max_period_ns )
+      _metrics.max_period_ns = ns;
+    _bins = 0;
+    _start = now;
+    if ( _sink )
+      _sink->publish( _metrics );
+  }
+
+  public:
+
+  /**
+   * Constructor.
+   *
+   * @param sink the sink to publish counters to, or 0
+   * @param period the number of bins per timing period
+   */
+  metrics_observer( metrics_sink *sink = 0, const unsigned int period = 4096 ) :
+    _metrics(),
+    _sink( sink ),
+    _period( period ),
+    _bins( 0 ),
+    _start( clock::now() ) {
+  }
+
+  /**
+   * Destructor.
+   *
+   * Publishes the final counters, including those of the bitstream termination.
+   */
+  ~metrics_observer() {
+    if ( _sink )
+      _sink->publish( _metrics );
+  }
+
+  /**
+   * Get current counters.
+   */
+  inline const engine_metrics& metrics() const {
+    return _metrics;
+  }
+
+  inline void decision( const state_vector::size_type idx, const unsigned int state,
+      const unsigned int range, const unsigned int low, const bool bin_val ) {
+    _metrics.decisions++;
+    bin();
+  }
+
+  inline void bypass( const unsigned int range, const unsigned int low, const bool bin_val ) {
+    _metrics.bypass_bins++;
+    bin();
+  }
+
+  inline void terminal( const unsigned int range, const unsigned int low, const bool bin_val ) {
+    _metrics.terminal_bins++;
+    bin();
+  }
+
+  inline void byte() {
+    _metrics.bytes++;
+  }
+
+  inline void renorm( const unsigned int shifts ) {
+    _metrics.renorms += shifts != 0;
+    _metrics.renorm_shifts += shifts;
+  }
+
+  inline void outstanding( const unsigned int bits ) {
+    _metrics.outstanding_runs++;
+    if ( bits > _metrics.max_outstanding )
+      _metrics.max_outstanding = bits;
+  }
+
+};
+
+}
+
+#endif
@@ -0,0 +1,247 @@
+//
+// This file is part of libcabac.
+//
+// Copyright 2008 Johannes Ballé <balle@ient.rwth-aachen.de>
+//
+// libcabac is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libcabac is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libcabac.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef _OHTU7AY3EI_CABAC_MODEL_H
+#define _OHTU7AY3EI_CABAC_MODEL_H 1
+
+#include <cabac/counting.h>
+#include <iosfwd>
+#include <string>
+#include <algorithm>
+
+namespace cabac {
+
+/**
+ * Coding strategy of a context.
+ */
+enum coding_strategy {
+  /** code with the adaptive state of the context */
+  strategy_adaptive,
+  /** code using the bypass engine */
+  strategy_bypass,
+  /** code with a fixed state, see encoder::encode_static */
+  strategy_static
+};
+
+/**
+ * Strategy and state of a context, as chosen by compile_model().
+ */
+struct context_plan {
+  /** the coding strategy */
+  coding_strategy strategy;
+  /** the initial state for strategy_adaptive, the fixed state for strategy_static */
+  uint8_t state;
+};
+
+/**
+ * Strategies of all contexts of a model, indexed by context index.
+ */
+typedef ::std::vector< context_plan > model_plan;
+
+/**
+ * Choose the cheapest coding strategy for each context from measured frequencies.
+ *
+ * A context becomes
+ * - strategy_bypass, if its bins are so close to equiprobable that adaptive coding would save less than
+ *   bypass_gain bits per bin,
+ * - strategy_static, if the probability of its less frequent value is at most static_threshold, so that
+ *   the context would stay in the most skewed states anyway,
+ * - strategy_adaptive otherwise, or if it was used for fewer than min_count bins.
+ *
+ * The state of each context is the one initialization_vector() would choose.
+ *
+ * @param f the frequency vector measured with a counting_encoder
+ * @param bypass_gain the minimum gain of adaptive coding over bypass coding in bits per bin
+ * @param static_threshold the maximum probability of the less frequent value for static coding
+ * @param min_count the minimum number of bins for a strategy other than strategy_adaptive
+ * @return the strategies
+ */
+inline model_plan compile_model( const frequency_vector &f, const double bypass_gain = 0.02,
+    const double static_threshold = 0.02, const unsigned int min_count = 64 ) {
+  const state_vector states = initialization_vector( f );
+  model_plan plan( f.size() );
+  for ( frequency_vector::size_type i = 0; i < f.size(); ++i ) {
+    const unsigned int sum = f[ i ].first + f[ i ].second;
+    plan[ i ].state = states[ i ];
+    plan[ i ].strategy = strategy_adaptive;
+    if ( sum < min_count )
+      continue;
+    const double p = static_cast< double >( ::std::min( f[ i ].first, f[ i ].second ) ) / sum;
+    const double entropy = p > 0 ? p * BITS( p ) + ( 1 - p ) * BITS( 1 - p ) : 0;
+    if ( 1 - entropy < bypass_gain )
+      plan[ i ].strategy = strategy_bypass;
+    else if ( p <= static_threshold )
+      plan[ i ].strategy = strategy_static;
+  }
+  return plan;
+}
+
+/**
+ * Write a model plan as a C++ header.
+ *
+ * The header defines a struct of the given name, whose member template context< idx > holds the strategy
+ * and state of context idx at compile time. Pass the struct to encode_context() and decode_context():
+ *
+ * @code
+ * // generated with write_model_header( os, compile_model( frequencies ), "my_model" )
+ * #include "my_model.h"
+ *
+ * cabac::encode_context< my_model, 17 >( enc, bin ); // compiles to enc.encode_bypass( bin ), for instance
+ * @endcode
+ *
+ * The cabac-model tool writes this header from a file saved with write_frequencies().
+ *
+ * @param os the output stream
+ * @param plan the strategies of the contexts
+ * @param name the name of the struct, a valid C++ identifier
+ */
+void write_model_header( ::std::ostream &os, const model_plan &plan, const ::std::string &name );
+
+/**
+ * Compile-time strategy and state of a context, base class of the contexts in a generated model header.
+ */
+template< coding_strategy S, unsigned int State >
+struct context_model {
+  static const coding_strategy strategy = S;
+  static const unsigned int state = State;
+};
+
+namespace impl {
+
+/**
+ * @internal Coding of a bin with a given strategy.
+ */
+template< coding_strategy S >
+struct strategy_coder;
+
+template<>
+struct strategy_coder< strategy_adaptive > {
+  template< class E >
+  static inline void encode( E &e, const state_vector::size_type idx, const unsigned int, const bool bin_val ) {
+    e.encode( idx, bin_val );
+  }
+  template< class D >
+  static inline bool decode( D &d, const state_vector::size_type idx, const unsigned int ) {
+    return d.decode( idx );
+  }
+};
+
+template<>
+struct strategy_coder< strategy_bypass > {
+  template< class E >
+  static inline void encode( E &e, const state_vector::size_type, const unsigned int, const bool bin_val ) {
+    e.encode_bypass( bin_val );
+  }
+  template< class D >
+  static inline bool decode( D &d, const state_vector::size_type, const unsigned int ) {
+    return d.decode_bypass();
+  }
+};
+
+template<>
+struct strategy_coder< strategy_static > {
+  template< class E >
+  static inline void encode( E &e, const state_vector::size_type, const unsigned int state, const bool bin_val ) {
+    e.encode_static( state, bin_val );
+  }
+  template< class D >
+  static inline bool decode( D &d, const state_vector::size_type, const unsigned int state ) {
+    return d.decode_static( state );
+  }
+};
+
+}
+
+/**
+ * Encode a bin with the strategy of a context in a compiled model.
+ *
+ * @param e the encoder
+ * @param bin_val the value of the bin
+ */
+template< class M, unsigned int idx, class E >
+inline void encode_context( E &e, const bool bin_val ) {
+  typedef typename M::template context< idx > context_type;
+  impl::strategy_coder< context_type::strategy >::encode( e, idx, context_type::state, bin_val );
+}
+
+/**
+ * Decode a bin with the strategy of a context in a compiled model.
+ *
+ * @param d the decoder
+ * @return the value of the decoded bin
+ */
+template< class M, unsigned int idx, class D >
+inline bool decode_context( D &d ) {
+  typedef typename M::template context< idx > context_type;
+  return impl::strategy_coder< context_type::strategy >::decode( d, idx, context_type::state );
+}
+
+/**
+ * Encode a bin with the strategy of a context in a model plan.
+ *
+ * The same as encode_context(), but chooses the strategy at run time, e.g. for context indexes which
+ * are not known at compile time.
+ *
+ * @param e the encoder
+ * @param plan the strategies of the contexts
+ * @param idx the index of the CABAC context
+ * @param bin_val the value of the bin
+ */
+template< class E >
+inline void encode_planned( E &e, const model_plan &plan, const state_vector::size_type idx, const bool bin_val ) {
+  assert( idx < plan.size() );
+  switch ( plan[ idx ].strategy ) {
+    case strategy_bypass:
+      e.encode_bypass( bin_val );
+      break;
+    case strategy_static:
+      e.encode_static( plan[ idx ].state, bin_val );
+      break;
+    default:
+      e.encode( idx, bin_val );
+  }
+}
+
+/**
+ * Decode a bin with the strategy of a context in a model plan.
+ *
+ * @see encode_planned
+ *
+ * @param d the decoder
+ * @param plan the strategies of the contexts
+ * @param idx the index of the CABAC context
+ * @return the value of the decoded bin
+ */
+template< class D >
+inline bool decode_planned( D &d, const model_plan &plan, const state_vector::size_type idx ) {
+  assert( idx < plan.size() );
+  switch ( plan[ idx ].strategy ) {
+    case strategy_bypass:
+      return d.decode_bypass();
+    case strategy_static:
+      return d.decode_static( plan[ idx ].state );
+    default:
+      return d.decode( idx );
+  }
+}
+
+}
+
+#endif
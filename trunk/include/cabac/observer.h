@@ -0,0 +1,179 @@
+//
+// This file is part of libcabac.
+//
+// Copyright 2008 Johannes Ballé <balle@ient.rwth-aachen.de>
+//
+// libcabac is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libcabac is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libcabac.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef _OHTU7AY3EI_CABAC_OBSERVER_H
+#define _OHTU7AY3EI_CABAC_OBSERVER_H 1
+
+#include <cabac/common.h>
+
+namespace cabac {
+
+/**
+ * Context index passed to the observer for bins coded with a fixed state (see encoder::encode_static),
+ * which have no context.
+ */
+const state_vector::size_type static_context = ~static_cast< state_vector::size_type >( 0 );
+
+/**
+ * Engine observer which does nothing.
+ *
+ * The encoder and decoder classes take an observer class as their second template parameter.
+ * The engines call the methods of the observer object at the points listed below, passing the
+ * engine state *before* the respective update. All methods of this class are empty inline functions,
+ * so an engine using it (which is the default) compiles to exactly the same code as an engine without
+ * any observer.
+ *
+ * To implement an observer, derive from this class and hide the methods you are interested in.
+ *
+ * In all methods, low denotes the lower interval bound in case of an encoder, and the offset in
+ * case of a decoder.
+ */
+class null_observer {
+
+  public:
+
+  /**
+   * Called for each binary decision coded using a context or a fixed state.
+   *
+   * @param idx the index of the CABAC context, or static_context for a fixed state
+   * @param state the state of the context
+   * @param range the current interval range
+   * @param low the current interval bound or offset
+   * @param bin_val the value of the bin
+   */
+  inline void decision( const state_vector::size_type idx, const unsigned int state,
+      const unsigned int range, const unsigned int low, const bool bin_val ) {
+  }
+
+  /**
+   * Called for each binary decision coded using the bypass engine.
+   *
+   * @param range the current interval range
+   * @param low the current interval bound or offset
+   * @param bin_val the value of the bin
+   */
+  inline void bypass( const unsigned int range, const unsigned int low, const bool bin_val ) {
+  }
+
+  /**
+   * Called for each terminal bit.
+   *
+   * @param range the current interval range
+   * @param low the current interval bound or offset
+   * @param bin_val the value of the bin
+   */
+  inline void terminal( const unsigned int range, const unsigned int low, const bool bin_val ) {
+  }
+
+  /**
+   * Called for each byte written to or read from the bitstream.
+   */
+  inline void byte() {
+  }
+
+  /**
+   * Called after each renormalization of the interval.
+   *
+   * @param shifts the number of renormalization iterations, i.e. bits shifted (may be zero)
+   */
+  inline void renorm( const unsigned int shifts ) {
+  }
+
+  /**
+   * Called by the encoder whenever a run of outstanding bits is resolved.
+   *
+   * @param bits the number of outstanding bits written at once
+   */
+  inline void outstanding( const unsigned int bits ) {
+  }
+
+};
+
+namespace impl {
+
+/**
+ * @internal Whether an observer ignores all notifications, which allows the engines to take shortcuts
+ * that skip notifications (see encoder::encode_run).
+ */
+template< class O >
+struct is_null_observer {
+  enum { value = 0 };
+};
+
+template<>
+struct is_null_observer< null_observer > {
+  enum { value = 1 };
+};
+
+}
+
+/**
+ * Engine observer which forwards all notifications to two other observers.
+ *
+ * Allows combining observers, e.g. a trace_recorder and a metrics_observer.
+ */
+template< class A, class B >
+class observer_pair {
+
+  public:
+
+  A first;
+  B second;
+
+  observer_pair( const A &a = A(), const B &b = B() ) :
+    first( a ),
+    second( b ) {
+  }
+
+  inline void decision( const state_vector::size_type idx, const unsigned int state,
+      const unsigned int range, const unsigned int low, const bool bin_val ) {
+    first.decision( idx, state, range, low, bin_val );
+    second.decision( idx, state, range, low, bin_val );
+  }
+
+  inline void bypass( const unsigned int range, const unsigned int low, const bool bin_val ) {
+    first.bypass( range, low, bin_val );
+    second.bypass( range, low, bin_val );
+  }
+
+  inline void terminal( const unsigned int range, const unsigned int low, const bool bin_val ) {
+    first.terminal( range, low, bin_val );
+    second.terminal( range, low, bin_val );
+  }
+
+  inline void byte() {
+    first.byte();
+    second.byte();
+  }
+
+  inline void renorm( const unsigned int shifts ) {
+    first.renorm( shifts );
+    second.renorm( shifts );
+  }
+
+  inline void outstanding( const unsigned int bits ) {
+    first.outstanding( bits );
+    second.outstanding( bits );
+  }
+
+};
+
+}
+
+#endif
@@ -0,0 +1,236 @@
+//
+// This file is part of libcabac.
+//
+// Copyright 2008 Johannes Ballé <balle@ient.rwth-aachen.de>
+//
+// libcabac is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libcabac is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libcabac.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef _OHTU7AY3EI_CABAC_PACKET_H
+#define _OHTU7AY3EI_CABAC_PACKET_H 1
+
+#include <cabac/encoder.h>
+#include <cabac/decoder.h>
+#include <iterator>
+#include <deque>
+#include <memory>
+
+namespace cabac {
+
+/**
+ * Packet container used by packet_encoder.
+ */
+typedef ::std::vector< uint8_t > packet;
+
+/**
+ * CABAC %encoder which splits its output into size-limited packets.
+ *
+ * The caller supplies the data in units (e.g. macroblocks or rows), each of which is coded by a
+ * function object. Units are never split across packets. A terminal bin follows each unit, with 1
+ * indicating the end of the packet, as with end_of_slice_flag in ISO/IEC 14496-10 / ITU-T Rec. H.264.
+ *
+ * Before coding a unit, the complete encoder state is saved. If the packet would exceed the size
+ * limit after the unit, the unit is undone, the packet is terminated and flushed, and the unit is
+ * coded again at the start of the next packet. Since the size of a terminated bitstream is known
+ * exactly at any time (see encoder::terminated_size), each packet is filled up to the limit minus
+ * less than the size of a single unit.
+ *
+ * Each packet starts with the initial states passed to the constructor, so that it can be decoded
+ * independently of all other packets (e.g. using decode_packet). Alternatively, the states may be
+ * carried over from one packet to the next, which compresses better, but requires the packets to be
+ * decoded in order.
+ *
+ * @code
+ * struct unit {
+ *   int value;
+ *   void operator()( cabac::packet_encoder::encoder_type &e ) const {
+ *     cabac::encode_seg( e, value, 0, 0, 10 );
+ *   }
+ * };
+ *
+ * cabac::packet_encoder pe( 1400, initial_states );
+ * for ( ... )
+ *   pe.encode( unit( ... ) );
+ * pe.finish();
+ * cabac::packet p;
+ * while ( pe.pop( p ) )
+ *   send( p );
+ * @endcode
+ *
+ * As a unit may be coded twice, its function object must not have side effects other than coding.
+ */
+class packet_encoder {
+
+  public:
+
+  typedef encoder< ::std::back_insert_iterator< packet > > encoder_type;
+
+  private:
+
+  const ::std::size_t _max_size;
+  const state_vector _initial;
+  const bool _carry_states;
+
+  ::std::deque< packet > _packets;
+  packet _current;
+  ::std::unique_ptr< encoder_type > _encoder;
+  state_vector _states;
+  encoder_state _checkpoint;
+  unsigned int _units;
+
+  // prohibit duplication of object
+  packet_encoder( const packet_encoder &other );
+  packet_encoder& operator=( const packet_encoder &other );
+
+  void start() {
+    _encoder.reset( new encoder_type( ::std::back_insert_iterator< packet >( _current ), _states ) );
+    _units = 0;
+  }
+
+  void end() {
+    _encoder->encode_terminal( 1 );
+    if ( _carry_states )
+      _states = _encoder->states();
+    // destroying the encoder flushes the packet
+    _encoder.reset();
+    _packets.push_back( packet() );
+    _packets.back().swap( _current );
+  }
+
+  public:
+
+  /**
+   * Constructor.
+   *
+   * @param max_size the size limit of a packet in bytes
+   * @param states the initial state vector
+   * @param carry_states true to continue each packet with the states of the previous one, false to
+   * start each packet with the initial states
+   */
+  packet_encoder( const ::std::size_t max_size, const state_vector &states, const bool carry_states = false ) :
+    _max_size( max_size ),
+    _initial( states ),
+    _carry_states( carry_states ),
+    _states( states ),
+    _units( 0 ) {
+  }
+
+  /**
+   * Code a unit.
+   *
+   * @param unit a function object, called with a reference to an encoder_type object
+   * @return true, or false if the unit alone exceeds the size limit. In the latter case, the unit
+   * is stored in its own, oversized packet.
+   */
+  template< class F >
+  bool encode( F unit ) {
+    if ( !_encoder )
+      start();
+    if ( _units ) {
+      _encoder->save( _checkpoint );
+      _encoder->encode_terminal( 0 );
+    }
+    unit( *_encoder );
+    if ( _encoder->terminated_size() <= _max_size ) {
+      ++_units;
+      return true;
+    }
+    if ( _units ) {
+      // undo the unit and code it at the start of a new packet
+      _current.resize( _checkpoint.bytes );
+      _encoder->restore( _checkpoint, ::std::back_insert_iterator< packet >( _current ) );
+      end();
+      start();
+      unit( *_encoder );
+    }
+    ++_units;
+    return _encoder->terminated_size() <= _max_size;
+  }
+
+  /**
+   * Terminate the current packet, if it contains any units.
+   *
+   * Call this after the last unit. If states are carried over, subsequent units continue with the
+   * current states.
+   */
+  void finish() {
+    if ( _encoder )
+      end();
+  }
+
+  /**
+   * Reset the states to the initial states.
+   *
+   * Terminates the current packet. Only needed if states are carried over, e.g. at the start of a
+   * new picture.
+   */
+  void reset() {
+    finish();
+    _states = _initial;
+  }
+
+  /**
+   * Get number of units in the current packet.
+   */
+  inline unsigned int units() const {
+    return _units;
+  }
+
+  /**
+   * Get number of completed packets which have not been popped yet.
+   */
+  inline ::std::size_t ready() const {
+    return _packets.size();
+  }
+
+  /**
+   * Take the oldest completed packet.
+   *
+   * @param p receives the packet
+   * @return true, or false if there is no completed packet
+   */
+  bool pop( packet &p ) {
+    if ( _packets.empty() )
+      return false;
+    p.swap( _packets.front() );
+    _packets.pop_front();
+    return true;
+  }
+
+};
+
+/**
+ * Decode a packet written by a packet_encoder.
+ *
+ * @param p the packet
+ * @param states the state vector to start with (the initial states, or the states after the
+ * previous packet if states are carried over), receives the states at the end of the packet
+ * @param unit a function object, called with a reference to a decoder< packet::const_iterator > object for each unit
+ * @return the number of units in the packet
+ */
+template< class F >
+unsigned int decode_packet( const packet &p, state_vector &states, F unit ) {
+  decoder< packet::const_iterator > d( p.begin(), states );
+  unsigned int units = 0;
+  do {
+    unit( d );
+    ++units;
+  } while ( !d.decode_terminal() );
+  states = d.states();
+  return units;
+}
+
+}
+
+#endif
@@ -0,0 +1,246 @@
+//
+// This file is part of libcabac.
+//
+// Copyright 2008 Johannes Ballé <balle@ient.rwth-aachen.de>
+//
+// libcabac is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libcabac is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libcabac.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef _OHTU7AY3EI_CABAC_RATE_H
+#define _OHTU7AY3EI_CABAC_RATE_H 1
+
+#include <cabac/common.h>
+#include <cstdlib>
+
+namespace cabac {
+
+/**
+ * Self information of a run of binary decisions coded with a single context.
+ *
+ * Returns the same value an encoder< void > would accumulate for coding n_mps times the MPS of the
+ * given state, optionally followed by one LPS, but in constant time and without touching any state.
+ *
+ * @param state the state of the context before the run
+ * @param n_mps the number of MPS
+ * @param then_lps true if the run is terminated by an LPS
+ * @return self information of the run in bits * 256
+ */
+inline unsigned int run_bits( const uint8_t state, const unsigned int n_mps, const bool then_lps = false ) {
+  const unsigned int first = state >> 1;
+  // after the MPS, the state index increases up to 62
+  const unsigned int last = first >= 62 ? first : n_mps < 62 - first ? first + n_mps : 62;
+  unsigned int bits = mps_bits_sum_tab[ last ] - mps_bits_sum_tab[ first ] + ( n_mps - ( last - first ) ) * bits_tab[ last << 1 ];
+  if ( then_lps )
+    bits += bits_tab[ ( last << 1 ) | 1 ];
+  return bits;
+}
+
+/**
+ * Number of bypass bins in the Exp-Golomb part of encode_ueg.
+ *
+ * @param value the value coded with the Exp-Golomb code, i.e. excluding the context-coded part
+ * @param k parameterization value of the Exp-Golomb encoding
+ * @return the number of bins
+ */
+inline unsigned int eg_length( const unsigned int value, const unsigned int k ) {
+  const uint64_t x = value + ( static_cast< uint64_t >( 1 ) << k );
+  const unsigned int log2_x = x >> 32 ? 63 - impl::clz( x >> 32 ) : 31 - impl::clz( x );
+  // prefix of ones, terminating zero and suffix
+  return 2 * ( log2_x - k ) + k + 1;
+}
+
+/**
+ * Number of bypass bins in the Exp-Golomb part of encode_ueg_limited.
+ *
+ * @param value the value coded with the Exp-Golomb code, i.e. excluding the context-coded part
+ * @param k parameterization value of the Exp-Golomb encoding
+ * @param max_prefix maximum length of the unary prefix
+ * @param escape_bits number of bins of the escape
+ * @return the number of bins
+ */
+inline unsigned int eg_length( const unsigned int value, const unsigned int k, const unsigned int max_prefix,
+    const unsigned int escape_bits ) {
+  // the first escaped value is 2^k * ( 2^max_prefix - 1 )
+  const uint64_t escape = ( ( static_cast< uint64_t >( 1 ) << max_prefix ) - 1 ) << k;
+  return value >= escape ? max_prefix + escape_bits : eg_length( value, k );
+}
+
+/**
+ * Self information of an unsigned integer coded with encode_ueg.
+ *
+ * Takes time linear in min( value, num_ctx ). To compare many candidate values coded with the same
+ * states, use ueg_rate.
+ *
+ * @param states the current state vector
+ * @param value the integer value
+ * @param k parameterization value of the Exp-Golomb encoding
+ * @param idx first context index to be used
+ * @param num_ctx number of context indexes to be used
+ * @return self information in bits * 256
+ */
+inline unsigned int ueg_bits( const state_vector &states, unsigned int value, const unsigned int k,
+    state_vector::size_type idx = ~0, const unsigned int num_ctx = 0 ) {
+  unsigned int bits = 0;
+  const state_vector::size_type max_idx = idx + num_ctx;
+  while ( idx < max_idx ) {
+    assert( idx < states.size() );
+    if ( value == 0 )
+      return bits + bits_tab[ states[ idx ] ^ 1 ];
+    bits += bits_tab[ states[ idx++ ] ];
+    value--;
+  }
+  return bits + ( eg_length( value, k ) << 8 );
+}
+
+/**
+ * Self information of a signed integer coded with encode_seg.
+ *
+ * @see ueg_bits
+ */
+inline unsigned int seg_bits( const state_vector &states, const signed int value, const unsigned int k,
+    const state_vector::size_type idx = ~0, const unsigned int num_ctx = 0 ) {
+  const unsigned int abs_value = ::std::abs( value );
+  return ueg_bits( states, abs_value * 2 - ( value < 0 ), k, idx, num_ctx );
+}
+
+/**
+ * Self information of an unsigned integer coded with encode_ueg_limited.
+ *
+ * @see ueg_bits
+ */
+inline unsigned int ueg_limited_bits( const state_vector &states, unsigned int value, const unsigned int k,
+    const unsigned int max_prefix, const unsigned int escape_bits, state_vector::size_type idx = ~0,
+    const unsigned int num_ctx = 0 ) {
+  unsigned int bits = 0;
+  const state_vector::size_type max_idx = idx + num_ctx;
+  while ( idx < max_idx ) {
+    assert( idx < states.size() );
+    if ( value == 0 )
+      return bits + bits_tab[ states[ idx ] ^ 1 ];
+    bits += bits_tab[ states[ idx++ ] ];
+    value--;
+  }
+  return bits + ( eg_length( value, k, max_prefix, escape_bits ) << 8 );
+}
+
+/**
+ * Self information of a signed integer coded with encode_seg_limited.
+ *
+ * @see ueg_bits
+ */
+inline unsigned int seg_limited_bits( const state_vector &states, const signed int value, const unsigned int k,
+    const unsigned int max_prefix, const unsigned int escape_bits, const state_vector::size_type idx = ~0,
+    const unsigned int num_ctx = 0 ) {
+  const unsigned int abs_value = ::std::abs( value );
+  return ueg_limited_bits( states, abs_value * 2 - ( value < 0 ), k, max_prefix, escape_bits, idx, num_ctx );
+}
+
+/**
+ * Rate estimator for integers coded with encode_ueg or encode_seg.
+ *
+ * If constructed with max_prefix > 0, estimates integers coded with encode_ueg_limited or
+ * encode_seg_limited instead.
+ *
+ * Since encode_ueg uses each context at most once per value, the self information of the context-coded
+ * part of all values up to num_ctx can be tabulated from the current states by update(). Afterwards,
+ * the estimate for any value takes constant time. Estimates are identical to the bit count of an
+ * encoder< void >.
+ *
+ * @code
+ * cabac::ueg_rate rate( 0, ctx_idx, 14 );
+ * for ( ... ) { // each coefficient
+ *   rate.update( e.states() );
+ *   for ( ... ) // each candidate level
+ *     cost = distortion + lambda * rate( level );
+ * }
+ * @endcode
+ */
+class ueg_rate {
+
+  const unsigned int _k;
+  const state_vector::size_type _idx;
+  const unsigned int _num_ctx;
+  const unsigned int _max_prefix;
+  const unsigned int _escape_bits;
+  ::std::vector< unsigned int > _unary;
+
+  public:
+
+  /**
+   * Constructor.
+   *
+   * update() must be called before the first estimate.
+   *
+   * @param k parameterization value of the Exp-Golomb encoding
+   * @param idx first context index to be used
+   * @param num_ctx number of context indexes to be used
+   * @param max_prefix maximum length of the unary prefix, or zero if unlimited
+   * @param escape_bits number of bins of the escape if max_prefix is nonzero
+   */
+  ueg_rate( const unsigned int k, const state_vector::size_type idx = ~0, const unsigned int num_ctx = 0,
+      const unsigned int max_prefix = 0, const unsigned int escape_bits = 32 ) :
+    _k( k ),
+    _idx( idx ),
+    _num_ctx( num_ctx ),
+    _max_prefix( max_prefix ),
+    _escape_bits( escape_bits ),
+    _unary( num_ctx + 1 ) {
+  }
+
+  /**
+   * Tabulate the context-coded part from the given states.
+   *
+   * @param states the current state vector
+   */
+  void update( const state_vector &states ) {
+    assert( !_num_ctx || _idx + _num_ctx <= states.size() );
+    unsigned int bits = 0;
+    for ( unsigned int i = 0; i < _num_ctx; ++i ) {
+      const unsigned int state = states[ _idx + i ];
+      _unary[ i ] = bits + bits_tab[ state ^ 1 ];
+      bits += bits_tab[ state ];
+    }
+    _unary[ _num_ctx ] = bits;
+  }
+
+  /**
+   * Estimate an unsigned integer.
+   *
+   * @param value the integer value
+   * @return self information in bits * 256
+   */
+  inline unsigned int operator()( const unsigned int value ) const {
+    if ( value < _num_ctx )
+      return _unary[ value ];
+    if ( _max_prefix )
+      return _unary[ _num_ctx ] + ( eg_length( value - _num_ctx, _k, _max_prefix, _escape_bits ) << 8 );
+    return _unary[ _num_ctx ] + ( eg_length( value - _num_ctx, _k ) << 8 );
+  }
+
+  /**
+   * Estimate a signed integer.
+   *
+   * @param value the integer value
+   * @return self information in bits * 256
+   */
+  inline unsigned int seg( const signed int value ) const {
+    const unsigned int abs_value = ::std::abs( value );
+    return ( *this )( abs_value * 2 - ( value < 0 ) );
+  }
+
+};
+
+}
+
+#endif
@@ -0,0 +1,208 @@
+//
+// This file is part of libcabac.
+//
+// Copyright 2008 Johannes Ballé <balle@ient.rwth-aachen.de>
+//
+// libcabac is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libcabac is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libcabac.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef _OHTU7AY3EI_CABAC_RESIDUAL_H
+#define _OHTU7AY3EI_CABAC_RESIDUAL_H 1
+
+#include <cabac/integer.h>
+#include <algorithm>
+#include <cstdlib>
+#if defined( __SSE2__ )
+# include <emmintrin.h>
+#endif
+
+namespace cabac {
+
+/**
+ * Contexts of a block of transform coefficients.
+ *
+ * @see encode_block
+ */
+struct block_contexts {
+  /** first context of significant_coeff_flag */
+  state_vector::size_type sig;
+  /** first context of last_significant_coeff_flag */
+  state_vector::size_type last;
+  /** first of the 10 contexts of coeff_abs_level_minus1 */
+  state_vector::size_type level;
+  /** context increment of significant_coeff_flag for each scanning position, or 0 for the position itself */
+  const uint8_t *sig_map;
+  /** context increment of last_significant_coeff_flag for each scanning position, or 0 for the position itself */
+  const uint8_t *last_map;
+  /** maximum context increment of the bins after the first of coeff_abs_level_minus1, minus 5 (4, or 3 for chroma DC) */
+  unsigned int max_gt1;
+};
+
+namespace impl {
+
+/**
+ * @internal Tables of the residual block coder.
+ */
+template< class T = void >
+struct residual_tables {
+  static constexpr uint8_t identity[ 64 ] = {
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+    16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31,
+    32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47,
+    48, 49, 50, 51, 52, 53, 54, 55, 56, 57, 58, 59, 60, 61, 62, 63
+  };
+};
+
+template< class T > constexpr uint8_t residual_tables< T >::identity[ 64 ];
+
+/**
+ * @internal Bit mask of the nonzero coefficients of a block of up to 64 coefficients.
+ */
+inline uint64_t nonzero_mask( const int16_t *coeffs, const unsigned int num ) {
+  assert( num <= 64 );
+  uint64_t mask = 0;
+  unsigned int i = 0;
+#if defined( __SSE2__ )
+  const __m128i zero = _mm_setzero_si128();
+  for ( ; i + 16 <= num; i += 16 ) {
+    const __m128i a = _mm_loadu_si128( reinterpret_cast< const __m128i* >( coeffs + i ) );
+    const __m128i b = _mm_loadu_si128( reinterpret_cast< const __m128i* >( coeffs + i + 8 ) );
+    const __m128i z = _mm_packs_epi16( _mm_cmpeq_epi16( a, zero ), _mm_cmpeq_epi16( b, zero ) );
+    mask |= static_cast< uint64_t >( ~_mm_movemask_epi8( z ) & 0xffff ) << i;
+  }
+#endif
+  for ( ; i < num; ++i )
+    mask |= static_cast< uint64_t >( coeffs[ i ] != 0 ) << i;
+  return mask;
+}
+
+/**
+ * @internal Index of the most significant bit of a nonzero 64 bit value.
+ */
+inline unsigned int msb( const uint64_t x ) {
+  return x >> 32 ? 63 - clz( x >> 32 ) : 31 - clz( static_cast< uint32_t >( x ) );
+}
+
+}
+
+/**
+ * Encode a block of transform coefficients.
+ *
+ * Codes the significance map and the levels in the same way as residual_block_cabac according to
+ * ISO/IEC 14496-10 / ITU-T Rec. H.264: for each scanning position up to the last nonzero coefficient,
+ * a significant_coeff_flag followed by a last_significant_coeff_flag for nonzero coefficients, then
+ * the nonzero coefficients in reverse scanning order as coeff_abs_level_minus1 (truncated unary prefix
+ * of up to 14 bins, Exp-Golomb suffix of order 0) and a sign bin. coded_block_flag is not coded.
+ *
+ * The positions of the nonzero coefficients are determined for the whole block at once (using SSE2
+ * if available), so that the coding loops only run over the coded bins.
+ *
+ * @param e the encoder object to be used
+ * @param coeffs the coefficients in scanning order, at least one of which must be nonzero
+ * @param num the number of coefficients of the block, at most 64
+ * @param ctx the contexts of the block
+ */
+template< class E >
+inline void encode_block( E &e, const int16_t *coeffs, const unsigned int num, const block_contexts &ctx ) {
+  assert( 0 < num && num <= 64 );
+  const uint64_t mask = impl::nonzero_mask( coeffs, num );
+  assert( mask );
+  const unsigned int last = impl::msb( mask );
+  const uint8_t *sig_map = ctx.sig_map ? ctx.sig_map : impl::residual_tables<>::identity;
+  const uint8_t *last_map = ctx.last_map ? ctx.last_map : impl::residual_tables<>::identity;
+  for ( unsigned int i = 0; i < last; ++i ) {
+    const bool sig = ( mask >> i ) & 1;
+    e.encode( ctx.sig + sig_map[ i ], sig );
+    if ( sig )
+      e.encode( ctx.last + last_map[ i ], 0 );
+  }
+  if ( last < num - 1 ) {
+    e.encode( ctx.sig + sig_map[ last ], 1 );
+    e.encode( ctx.last + last_map[ last ], 1 );
+  }
+  unsigned int eq1 = 0, gt1 = 0;
+  for ( uint64_t m = mask; m; ) {
+    const unsigned int i = impl::msb( m );
+    m ^= static_cast< uint64_t >( 1 ) << i;
+    const unsigned int abs_minus1 = ::std::abs( static_cast< int >( coeffs[ i ] ) ) - 1;
+    e.encode( ctx.level + ( gt1 ? 0 : ::std::min( 4u, 1 + eq1 ) ), abs_minus1 != 0 );
+    if ( abs_minus1 ) {
+      const state_vector::size_type idx = ctx.level + 5 + ::std::min( ctx.max_gt1, gt1 );
+      const unsigned int prefix = ::std::min( abs_minus1, 14u );
+      for ( unsigned int j = 1; j < prefix; ++j )
+        e.encode( idx, 1 );
+      if ( prefix < 14 )
+        e.encode( idx, 0 );
+      else
+        encode_ueg( e, abs_minus1 - 14, 0 );
+      gt1++;
+    } else {
+      eq1++;
+    }
+    e.encode_bypass( coeffs[ i ] < 0 );
+  }
+}
+
+/**
+ * Decode a block of transform coefficients.
+ *
+ * @see encode_block
+ *
+ * @param d the decoder object to be used
+ * @param coeffs receives the coefficients in scanning order, including the zeros
+ * @param num the number of coefficients of the block, at most 64
+ * @param ctx the contexts of the block
+ * @return the number of nonzero coefficients
+ */
+template< class D >
+inline unsigned int decode_block( D &d, int16_t *coeffs, const unsigned int num, const block_contexts &ctx ) {
+  assert( 0 < num && num <= 64 );
+  const uint8_t *sig_map = ctx.sig_map ? ctx.sig_map : impl::residual_tables<>::identity;
+  const uint8_t *last_map = ctx.last_map ? ctx.last_map : impl::residual_tables<>::identity;
+  uint64_t mask = 0;
+  unsigned int i = 0;
+  for ( ; i < num - 1; ++i )
+    if ( d.decode( ctx.sig + sig_map[ i ] ) ) {
+      mask |= static_cast< uint64_t >( 1 ) << i;
+      if ( d.decode( ctx.last + last_map[ i ] ) )
+        break;
+    }
+  // the coefficient at the last position is significant if no last_significant_coeff_flag was set
+  if ( i == num - 1 )
+    mask |= static_cast< uint64_t >( 1 ) << i;
+  ::std::fill( coeffs, coeffs + num, 0 );
+  unsigned int eq1 = 0, gt1 = 0;
+  for ( uint64_t m = mask; m; ) {
+    const unsigned int pos = impl::msb( m );
+    m ^= static_cast< uint64_t >( 1 ) << pos;
+    unsigned int abs_minus1 = d.decode( ctx.level + ( gt1 ? 0 : ::std::min( 4u, 1 + eq1 ) ) );
+    if ( abs_minus1 ) {
+      const state_vector::size_type idx = ctx.level + 5 + ::std::min( ctx.max_gt1, gt1 );
+      while ( abs_minus1 < 14 && d.decode( idx ) )
+        abs_minus1++;
+      if ( abs_minus1 == 14 )
+        abs_minus1 += decode_ueg( d, 0 );
+      gt1++;
+    } else {
+      eq1++;
+    }
+    const int level = static_cast< int >( abs_minus1 + 1 );
+    coeffs[ pos ] = static_cast< int16_t >( d.decode_bypass() ? -level : level );
+  }
+  return eq1 + gt1;
+}
+
+}
+
+#endif
@@ -0,0 +1,279 @@
+//
+// This file is part of libcabac.
+//
+// Copyright 2008 Johannes Ballé <balle@ient.rwth-aachen.de>
+//
+// libcabac is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libcabac is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libcabac.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef _OHTU7AY3EI_CABAC_SEEK_H
+#define _OHTU7AY3EI_CABAC_SEEK_H 1
+
+#include <cabac/encoder.h>
+#include <cabac/decoder.h>
+#include <iosfwd>
+#include <cstddef>
+#include <algorithm>
+
+namespace cabac {
+
+/**
+ * Index of resync points for random access into a bitstream.
+ *
+ * The index is built alongside encoding by calling add() or add_if_due() at points where decoding
+ * may later start, e.g. at record boundaries. Each entry is labelled with a position chosen by the
+ * caller (e.g. the number of the next bin or record), by which it can be found later. A decoder
+ * constructed from the resync point of an entry continues with the first bin after the entry:
+ *
+ * @code
+ * cabac::seek_index index( 4096 );
+ * {
+ *   cabac::encoder< iter_type > enc( iter_type( bs ), initial_states );
+ *   for ( std::size_t r = 0; r < records.size(); ++r ) {
+ *     index.add_if_due( enc, r );
+ *     code_record( enc, records[ r ] );
+ *   }
+ * }
+ *
+ * // later, on a memory-mapped copy of bs
+ * const std::size_t i = index.find( r );
+ * cabac::resync_point point;
+ * index.get( i, point );
+ * cabac::decoder< const uint8_t* > dec( mapped, point );
+ * // decode records index.position( i ) to r
+ * @endcode
+ *
+ * The context states are stored as differences to the previous entry, except for every key_interval-th
+ * entry, which holds all states. Hence, getting a resync point costs at most key_interval - 1 updates
+ * besides copying the states.
+ */
+class seek_index {
+
+  public:
+
+  /**
+   * Entry of the index.
+   */
+  struct entry {
+    /** position chosen by the caller, non-decreasing */
+    uint64_t position;
+    /** position of the decoding window in bits */
+    uint64_t bit;
+    /** interval range */
+    uint16_t range;
+    /** lower 9 bits of the lower interval bound */
+    uint16_t low;
+    /** number of contexts stored with the entry */
+    uint32_t changes;
+    /** offset of the stored contexts */
+    uint64_t offset;
+  };
+
+  private:
+
+  uint64_t _interval;
+  unsigned int _key_interval;
+  ::std::vector< entry > _entries;
+  // key entries: one byte per state, other entries: changed contexts as index increment (LEB128) and state
+  ::std::vector< uint8_t > _data;
+  state_vector _last;
+  encoder_state _scratch;
+
+  public:
+
+  /**
+   * Constructor.
+   *
+   * @param interval the minimum distance in bytes of entries added by add_if_due()
+   * @param key_interval every key_interval-th entry holds all states
+   */
+  explicit seek_index( const uint64_t interval = 0, const unsigned int key_interval = 16 ) :
+    _interval( interval ),
+    _key_interval( key_interval ) {
+    assert( key_interval > 0 );
+  }
+
+  /**
+   * Add an entry from a saved encoder state.
+   *
+   * @param state the encoder state, as saved by encoder::save()
+   * @param position the position label of the entry
+   */
+  void add( const encoder_state &state, const uint64_t position ) {
+    assert( _entries.empty() || ( position >= _entries.back().position && state.states.size() == _last.size() ) );
+    entry e;
+    e.position = position;
+    // the decoder has read 9 bits more than the encoder has shifted out, including the first bit
+    e.bit = state.bytes * 8 + 8 - state.shift + state.bits_outstanding;
+    e.range = state.range;
+    e.low = state.low & 0x1ff;
+    e.offset = _data.size();
+    if ( _entries.size() % _key_interval == 0 ) {
+      e.changes = state.states.size();
+      _data.insert( _data.end(), state.states.begin(), state.states.end() );
+    } else {
+      e.changes = 0;
+      state_vector::size_type last = 0;
+      for ( state_vector::size_type i = 0; i < _last.size(); ++i ) {
+        if ( state.states[ i ] == _last[ i ] )
+          continue;
+        for ( uint64_t d = i - last; ; d >>= 7 ) {
+          _data.push_back( ( d & 0x7f ) | ( d >= 0x80 ? 0x80 : 0 ) );
+          if ( d < 0x80 )
+            break;
+        }
+        _data.push_back( state.states[ i ] );
+        last = i;
+        e.changes++;
+      }
+    }
+    _last = state.states;
+    _entries.push_back( e );
+  }
+
+  /**
+   * Add an entry at the current state of an encoder.
+   *
+   * @param enc the encoder
+   * @param position the position label of the entry
+   */
+  template< typename I, class O >
+  void add( const encoder< I, O > &enc, const uint64_t position ) {
+    enc.save( _scratch );
+    add( _scratch, position );
+  }
+
+  /**
+   * Add an entry if the encoder has written at least interval bytes since the last entry.
+   *
+   * The first entry is always added.
+   *
+   * @param enc the encoder
+   * @param position the position label of the entry
+   * @return true if an entry was added
+   */
+  template< typename I, class O >
+  bool add_if_due( const encoder< I, O > &enc, const uint64_t position ) {
+    if ( !_entries.empty() && enc.bytes() < ( _entries.back().bit >> 3 ) + _interval )
+      return false;
+    add( enc, position );
+    return true;
+  }
+
+  /**
+   * Get number of entries.
+   */
+  inline ::std::size_t size() const {
+    return _entries.size();
+  }
+
+  /**
+   * Get an entry.
+   */
+  inline const entry& operator[]( const ::std::size_t i ) const {
+    return _entries[ i ];
+  }
+
+  /**
+   * Get position label of an entry.
+   */
+  inline uint64_t position( const ::std::size_t i ) const {
+    return _entries[ i ].position;
+  }
+
+  /**
+   * Find the last entry at or before a position.
+   *
+   * @param position the position label
+   * @return the index of the entry, or size() if there is none
+   */
+  ::std::size_t find( const uint64_t position ) const {
+    ::std::size_t first = 0, count = _entries.size();
+    while ( count ) {
+      const ::std::size_t step = count / 2;
+      if ( _entries[ first + step ].position <= position ) {
+        first += step + 1;
+        count -= step + 1;
+      } else {
+        count = step;
+      }
+    }
+    return first ? first - 1 : _entries.size();
+  }
+
+  /**
+   * Get the resync point of an entry.
+   *
+   * @param i the index of the entry
+   * @param point receives the resync point
+   */
+  void get( const ::std::size_t i, resync_point &point ) const {
+    assert( i < _entries.size() );
+    const ::std::size_t key = i - i % _key_interval;
+    const entry &k = _entries[ key ];
+    point.states.assign( _data.begin() + k.offset, _data.begin() + k.offset + k.changes );
+    for ( ::std::size_t j = key + 1; j <= i; ++j ) {
+      const uint8_t *p = &_data[ 0 ] + _entries[ j ].offset;
+      state_vector::size_type idx = 0;
+      for ( uint32_t c = 0; c < _entries[ j ].changes; ++c ) {
+        uint64_t d = 0;
+        for ( unsigned int s = 0; ; s += 7 ) {
+          d |= static_cast< uint64_t >( *p & 0x7f ) << s;
+          if ( !( *p++ & 0x80 ) )
+            break;
+        }
+        idx += d;
+        point.states[ idx ] = *p++;
+      }
+    }
+    point.bit = _entries[ i ].bit;
+    point.range = _entries[ i ].range;
+    point.low = _entries[ i ].low;
+  }
+
+  /**
+   * Get the memory used by the stored states in bytes.
+   */
+  inline ::std::size_t data_size() const {
+    return _data.size();
+  }
+
+  friend void write_seek_index( ::std::ostream &os, const seek_index &index );
+  friend bool read_seek_index( ::std::istream &is, seek_index &index );
+
+};
+
+/**
+ * Write a seek index to a binary file.
+ *
+ * @param os the output stream, opened in binary mode
+ * @param index the index
+ */
+void write_seek_index( ::std::ostream &os, const seek_index &index );
+
+/**
+ * Read a seek index from a binary file.
+ *
+ * Entries can be added to the index read, if the bitstream is continued from the state it was terminated with
+ * (see append.h).
+ *
+ * @param is the input stream, opened in binary mode
+ * @param index receives the index
+ * @return true on success, false if the stream does not contain a valid index
+ */
+bool read_seek_index( ::std::istream &is, seek_index &index );
+
+}
+
+#endif
@@ -0,0 +1,257 @@
+//
+// This file is part of libcabac.
+//
+// Copyright 2008 Johannes Ballé <balle@ient.rwth-aachen.de>
+//
+// libcabac is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libcabac is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libcabac.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef _OHTU7AY3EI_CABAC_SPARSE_H
+#define _OHTU7AY3EI_CABAC_SPARSE_H 1
+
+#include <cabac/common.h>
+#include <cstddef>
+#include <algorithm>
+
+namespace cabac {
+
+/**
+ * Sparse storage of context states.
+ *
+ * A replacement for state_vector for very large context index ranges (e.g. context indexes obtained by
+ * hashing coding histories), of which only a small fraction is ever used. It can be passed as the third
+ * template parameter of encoder, decoder and encoder< void >:
+ *
+ * @code
+ * typedef cabac::encoder< iter_type, cabac::null_observer, cabac::sparse_states > encoder_type;
+ * encoder_type enc( iter_type( bs ), cabac::sparse_states( 16 << 20 ) );
+ *
+ * enc.encode( hash( history ), bin ); // any index below 2^32 - 1
+ * @endcode
+ *
+ * The states are kept in a hash table of cache line sized buckets, each holding the indexes and states
+ * of up to 12 contexts. A context is inserted with the initial state on first use, so the memory grows
+ * with the number of contexts used: the table starts small and doubles whenever a bucket overflows,
+ * until it reaches the memory budget. From then on, a context is inserted by replacing the context of
+ * the bucket whose state carries the least information, i.e. the lowest pStateIdx.
+ *
+ * Replacement is deterministic, so that encoder and decoder stay in sync as long as both use the same
+ * memory budget and initial state. Reading a state through a const reference does not insert the context.
+ */
+class sparse_states {
+
+  public:
+
+  typedef state_vector::size_type size_type;
+  typedef uint8_t value_type;
+
+  private:
+
+  enum { ways = 12, line_size = 64, min_buckets = 64 };
+
+  struct bucket {
+    uint32_t idx[ ways ];
+    uint8_t states[ ways ];
+    uint32_t used;
+  };
+
+  ::std::vector< uint8_t > _memory;
+  bucket *_table;
+  unsigned int _bits;
+  unsigned int _max_bits;
+  uint8_t _initial;
+  size_type _touched;
+  size_type _evictions;
+
+  // multiplicative hash, the upper bits select the bucket
+  inline bucket* find_bucket( const uint32_t idx ) const {
+    return _table + ( ( idx * 0x9e3779b1u ) >> ( 32 - _bits ) );
+  }
+
+  // buckets are aligned to cache lines
+  void allocate( const unsigned int bits ) {
+    _bits = bits;
+    _memory.assign( ( static_cast< ::std::size_t >( 1 ) << bits ) * sizeof( bucket ) + line_size - 1, 0 );
+    const ::std::size_t address = reinterpret_cast< ::std::size_t >( &_memory[ 0 ] );
+    _table = reinterpret_cast< bucket* >( &_memory[ 0 ] + ( -address & ( line_size - 1 ) ) );
+  }
+
+  // doubling the table splits each bucket into two, so reinsertion never overflows
+  void grow() {
+    ::std::vector< uint8_t > memory;
+    memory.swap( _memory );
+    const bucket *table = _table;
+    const ::std::size_t num = static_cast< ::std::size_t >( 1 ) << _bits;
+    allocate( _bits + 1 );
+    for ( ::std::size_t i = 0; i < num; ++i )
+      for ( unsigned int j = 0; j < table[ i ].used; ++j ) {
+        bucket *b = find_bucket( table[ i ].idx[ j ] );
+        b->idx[ b->used ] = table[ i ].idx[ j ];
+        b->states[ b->used++ ] = table[ i ].states[ j ];
+      }
+  }
+
+  uint8_t& insert( const uint32_t idx ) {
+    bucket *b = find_bucket( idx );
+    while ( b->used == ways && _bits < _max_bits ) {
+      grow();
+      b = find_bucket( idx );
+    }
+    unsigned int slot = b->used;
+    if ( slot < ways ) {
+      b->used++;
+      _touched++;
+    } else {
+      slot = 0;
+      for ( unsigned int i = 1; i < ways; ++i )
+        if ( ( b->states[ i ] >> 1 ) < ( b->states[ slot ] >> 1 ) )
+          slot = i;
+      _evictions++;
+    }
+    b->idx[ slot ] = idx;
+    b->states[ slot ] = _initial;
+    return b->states[ slot ];
+  }
+
+  public:
+
+  /**
+   * Constructor.
+   *
+   * @param max_bytes the memory budget of the hash table in bytes, at least 4096
+   * @param initial the initial state of all contexts
+   */
+  explicit sparse_states( const ::std::size_t max_bytes = 1 << 24, const uint8_t initial = 0 ) :
+    _max_bits( 0 ),
+    _initial( initial ),
+    _touched( 0 ),
+    _evictions( 0 ) {
+    assert( max_bytes >= min_buckets * sizeof( bucket ) );
+    assert( initial < 128 );
+    while ( _max_bits < 31 && ( static_cast< ::std::size_t >( 2 ) << _max_bits ) * sizeof( bucket ) <= max_bytes )
+      _max_bits++;
+    allocate( impl::ctz( min_buckets ) );
+  }
+
+  sparse_states( const sparse_states &other ) :
+    _max_bits( other._max_bits ),
+    _initial( other._initial ),
+    _touched( other._touched ),
+    _evictions( other._evictions ) {
+    allocate( other._bits );
+    ::std::copy( other._table, other._table + ( static_cast< ::std::size_t >( 1 ) << _bits ), _table );
+  }
+
+  sparse_states& operator=( const sparse_states &other ) {
+    if ( this != &other ) {
+      _max_bits = other._max_bits;
+      _initial = other._initial;
+      _touched = other._touched;
+      _evictions = other._evictions;
+      allocate( other._bits );
+      ::std::copy( other._table, other._table + ( static_cast< ::std::size_t >( 1 ) << _bits ), _table );
+    }
+    return *this;
+  }
+
+  /**
+   * Access the state of a context, inserting it with the initial state on first use.
+   *
+   * The returned reference is valid until the next insertion.
+   *
+   * @param idx the index of the CABAC context
+   */
+  inline uint8_t& operator[]( const size_type idx ) {
+    assert( idx < size() );
+    bucket *b = find_bucket( static_cast< uint32_t >( idx ) );
+    for ( unsigned int i = 0; i < b->used; ++i )
+      if ( b->idx[ i ] == idx )
+        return b->states[ i ];
+    return insert( static_cast< uint32_t >( idx ) );
+  }
+
+  /**
+   * Get the state of a context without inserting it.
+   *
+   * @param idx the index of the CABAC context
+   * @return the state, or the initial state if the context is not stored
+   */
+  inline uint8_t operator[]( const size_type idx ) const {
+    assert( idx < size() );
+    const bucket *b = find_bucket( static_cast< uint32_t >( idx ) );
+    for ( unsigned int i = 0; i < b->used; ++i )
+      if ( b->idx[ i ] == idx )
+        return b->states[ i ];
+    return _initial;
+  }
+
+  /**
+   * Prefetch the bucket of a context.
+   *
+   * Call this as soon as the index of the next context is known, so that the cache miss overlaps with
+   * coding the current bin.
+   *
+   * @param idx the index of the CABAC context
+   */
+  inline void prefetch( const size_type idx ) const {
+  #if defined( __GNUC__ )
+    __builtin_prefetch( find_bucket( static_cast< uint32_t >( idx ) ), 1 );
+  #else
+    ( void ) idx;
+  #endif
+  }
+
+  /**
+   * Get the range of valid context indexes.
+   */
+  inline size_type size() const {
+    return 0xffffffffu;
+  }
+
+  /**
+   * Get the number of stored contexts.
+   */
+  inline size_type touched() const {
+    return _touched;
+  }
+
+  /**
+   * Get the number of contexts which were replaced after the memory budget was reached.
+   */
+  inline size_type evictions() const {
+    return _evictions;
+  }
+
+  /**
+   * Get the memory currently used by the hash table in bytes.
+   */
+  inline ::std::size_t memory() const {
+    return _memory.size();
+  }
+
+  /**
+   * Remove all contexts and release the memory.
+   */
+  void clear() {
+    ::std::vector< uint8_t >().swap( _memory );
+    allocate( impl::ctz( min_buckets ) );
+    _touched = 0;
+    _evictions = 0;
+  }
+
+};
+
+}
+
+#endif
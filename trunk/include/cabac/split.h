@@ -0,0 +1,363 @@
+//
+// This file is part of libcabac.
+//
+// Copyright 2008 Johannes Ballé <balle@ient.rwth-aachen.de>
+//
+// libcabac is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libcabac is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libcabac.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef _OHTU7AY3EI_CABAC_SPLIT_H
+#define _OHTU7AY3EI_CABAC_SPLIT_H 1
+
+#include <cabac/encoder.h>
+#include <cabac/decoder.h>
+#include <iterator>
+#include <memory>
+#include <algorithm>
+
+namespace cabac {
+
+/**
+ * CABAC %encoder which writes bypass bins to a separate raw bit stream.
+ *
+ * Bypass bins carry exactly one bit each, so coding them with the arithmetic engine is wasted effort.
+ * This encoder codes binary decisions and terminal bits with an encoder as usual, but appends bypass bins
+ * to a raw bit buffer, most significant bit first. On destruction, it writes a block consisting of
+ * - the size of the arithmetic part in bytes, and the size of the raw part in bytes, each as LEB128,
+ * - the arithmetic part,
+ * - the raw part, padded with zero bits to a whole byte.
+ *
+ * Blocks may be concatenated, see split_decoder::end(). The interface is the same as that of the encoder
+ * class, so all binarizations (e.g. encode_ueg, encode_uf or the array codecs) can be used. The bitstream
+ * is *not* compatible with ISO/IEC 14496-10 / ITU-T Rec. H.264 and must be decoded by a split_decoder.
+ *
+ * The observer is notified about the binary decisions and terminal bits only.
+ */
+template< typename I, class O = null_observer >
+class split_encoder {
+
+  public:
+
+  typedef encoder< ::std::back_insert_iterator< ::std::vector< uint8_t > >, O > engine_type;
+
+  private:
+
+  I _data;
+  ::std::vector< uint8_t > _arithmetic;
+  ::std::vector< uint8_t > _raw;
+  ::std::unique_ptr< engine_type > _engine;
+  uint64_t _bits;
+  unsigned int _count;
+
+  // prohibit duplication of object
+  split_encoder( const split_encoder &other );
+  split_encoder& operator=( const split_encoder &other );
+
+  void put_bits( const uint32_t value, const unsigned int n ) {
+    _bits = ( _bits << n ) | value;
+    _count += n;
+    while ( _count >= 8 ) {
+      _count -= 8;
+      _raw.push_back( static_cast< uint8_t >( _bits >> _count ) );
+    }
+  }
+
+  void put_size( uint64_t size ) {
+    while ( size >= 0x80 ) {
+      *_data++ = static_cast< uint8_t >( size | 0x80 );
+      size >>= 7;
+    }
+    *_data++ = static_cast< uint8_t >( size );
+  }
+
+  public:
+
+  typedef I iterator_type;
+  typedef O observer_type;
+
+  /**
+   * Constructor.
+   *
+   * @param output an STL-compatible output iterator on a container of uint8_t, used to write the block
+   * @param states the initial state vector
+   * @param observer the observer object
+   */
+  split_encoder( const I &output, const state_vector &states, const O &observer = O() ) :
+    _data( output ),
+    _engine( new engine_type( ::std::back_insert_iterator< ::std::vector< uint8_t > >( _arithmetic ), states,
+      observer ) ),
+    _bits( 0 ),
+    _count( 0 ) {
+  }
+
+  /**
+   * Destructor.
+   *
+   * Terminates the arithmetic part and writes the block.
+   */
+  ~split_encoder() {
+    _engine.reset();
+    if ( _count )
+      put_bits( 0, 8 - _count );
+    put_size( _arithmetic.size() );
+    put_size( _raw.size() );
+    _data = ::std::copy( _arithmetic.begin(), _arithmetic.end(), _data );
+    _data = ::std::copy( _raw.begin(), _raw.end(), _data );
+  }
+
+  /**
+   * Get observer object.
+   */
+  inline O& observer() {
+    return _engine->observer();
+  }
+
+  /**
+   * Get the current states.
+   */
+  inline const state_vector& states() const {
+    return _engine->states();
+  }
+
+  /**
+   * @see encoder_base::encode_test
+   */
+  inline unsigned int encode_test( const state_vector::size_type idx, const bool bin_val ) const {
+    return _engine->encode_test( idx, bin_val );
+  }
+
+  /**
+   * Encode a binary decision.
+   *
+   * @see encoder::encode
+   */
+  inline void encode( const state_vector::size_type idx, const bool bin_val ) {
+    _engine->encode( idx, bin_val );
+  }
+
+  /**
+   * Encode a hard-to-predict binary decision.
+   *
+   * @see encoder::encode_unpredictable
+   */
+  inline void encode_unpredictable( const state_vector::size_type idx, const bool bin_val ) {
+    _engine->encode_unpredictable( idx, bin_val );
+  }
+
+  /**
+   * Encode a run of MPS, optionally followed by an LPS.
+   *
+   * @see encoder::encode_run
+   */
+  inline void encode_run( const state_vector::size_type idx, const uint64_t n_mps, const bool then_lps ) {
+    _engine->encode_run( idx, n_mps, then_lps );
+  }
+
+  /**
+   * Append a bin to the raw bit stream.
+   *
+   * @see encoder::encode_bypass
+   */
+  inline void encode_bypass( const bool bin_val ) {
+    put_bits( bin_val, 1 );
+  }
+
+  /**
+   * Append several bins to the raw bit stream.
+   *
+   * @see encoder::encode_bypass_bits
+   *
+   * @param value the values of the bins, the first in the most significant bit
+   * @param n the number of bins, at most 32
+   */
+  inline void encode_bypass_bits( const uint32_t value, const unsigned int n ) {
+    assert( n <= 32 );
+    assert( n == 32 || value >> n == 0 );
+    put_bits( value, n );
+  }
+
+  /**
+   * Encode a terminal bit.
+   *
+   * @see encoder::encode_terminal
+   */
+  inline void encode_terminal( const bool bin_val ) {
+    _engine->encode_terminal( bin_val );
+  }
+
+};
+
+/**
+ * CABAC %decoder for blocks written by split_encoder.
+ *
+ * The block is read from memory. Bypass bins are read from the raw part with a plain bit reader, which
+ * refills a 64 bit register with 32 bits at a time.
+ */
+template< class O = null_observer >
+class split_decoder {
+
+  public:
+
+  typedef decoder< const uint8_t*, O > engine_type;
+
+  private:
+
+  const uint8_t *_pos;
+  const uint64_t _arithmetic_size;
+  const uint64_t _raw_size;
+  const uint8_t *_raw;
+  const uint8_t *const _raw_end;
+  engine_type _engine;
+  uint64_t _cache;
+  unsigned int _avail;
+
+  // prohibit duplication of object
+  split_decoder( const split_decoder &other );
+  split_decoder& operator=( const split_decoder &other );
+
+  static uint64_t get_size( const uint8_t *&p ) {
+    uint64_t size = 0;
+    for ( unsigned int shift = 0; ; shift += 7 ) {
+      size |= static_cast< uint64_t >( *p & 0x7f ) << shift;
+      if ( !( *p++ & 0x80 ) )
+        return size;
+    }
+  }
+
+  // bits beyond the end of the raw part are read as zero
+  void refill() {
+    if ( _avail <= 32 && _raw_end - _raw >= 4 ) {
+      _cache = ( _cache << 32 ) | ( static_cast< uint32_t >( _raw[ 0 ] ) << 24 ) | ( _raw[ 1 ] << 16 ) |
+        ( _raw[ 2 ] << 8 ) | _raw[ 3 ];
+      _raw += 4;
+      _avail += 32;
+    } else {
+      for ( ; _avail <= 56; _avail += 8 )
+        _cache = ( _cache << 8 ) | ( _raw < _raw_end ? *_raw++ : 0 );
+    }
+  }
+
+  public:
+
+  typedef O observer_type;
+
+  /**
+   * Constructor.
+   *
+   * @param input a pointer to the start of the block
+   * @param states the initial state vector
+   * @param observer the observer object
+   */
+  split_decoder( const uint8_t *input, const state_vector &states, const O &observer = O() ) :
+    _pos( input ),
+    _arithmetic_size( get_size( _pos ) ),
+    _raw_size( get_size( _pos ) ),
+    _raw( _pos + _arithmetic_size ),
+    _raw_end( _raw + _raw_size ),
+    _engine( _pos, states, observer ),
+    _cache( 0 ),
+    _avail( 0 ) {
+  }
+
+  /**
+   * Get a pointer past the end of the block, i.e. to the start of the next block.
+   */
+  inline const uint8_t* end() const {
+    return _raw_end;
+  }
+
+  /**
+   * Get observer object.
+   */
+  inline O& observer() {
+    return _engine.observer();
+  }
+
+  /**
+   * Get the current states.
+   */
+  inline const state_vector& states() const {
+    return _engine.states();
+  }
+
+  /**
+   * Decode a binary decision.
+   *
+   * @see decoder::decode
+   */
+  inline bool decode( const state_vector::size_type idx ) {
+    return _engine.decode( idx );
+  }
+
+  /**
+   * Decode a hard-to-predict binary decision.
+   *
+   * @see decoder::decode_unpredictable
+   */
+  inline bool decode_unpredictable( const state_vector::size_type idx ) {
+    return _engine.decode_unpredictable( idx );
+  }
+
+  /**
+   * Decode a run of MPS.
+   *
+   * @see decoder::decode_mps_run
+   */
+  inline uint64_t decode_mps_run( const state_vector::size_type idx, const uint64_t max_n ) {
+    return _engine.decode_mps_run( idx, max_n );
+  }
+
+  /**
+   * Read a bin from the raw bit stream.
+   *
+   * @see split_encoder::encode_bypass
+   */
+  inline bool decode_bypass() {
+    if ( !_avail )
+      refill();
+    --_avail;
+    return ( _cache >> _avail ) & 1;
+  }
+
+  /**
+   * Read several bins from the raw bit stream.
+   *
+   * @see split_encoder::encode_bypass_bits
+   *
+   * @param n the number of bins, at most 32
+   * @return the values of the bins, the first in the most significant bit
+   */
+  inline uint32_t decode_bypass_bits( const unsigned int n ) {
+    assert( n <= 32 );
+    if ( _avail < n )
+      refill();
+    _avail -= n;
+    return static_cast< uint32_t >( ( _cache >> _avail ) & ( ( static_cast< uint64_t >( 1 ) << n ) - 1 ) );
+  }
+
+  /**
+   * Decode a terminal bit.
+   *
+   * @see decoder::decode_terminal
+   */
+  inline bool decode_terminal() {
+    return _engine.decode_terminal();
+  }
+
+};
+
+}
+
+#endif
@@ -0,0 +1,545 @@
+//
+// This file is part of libcabac.
+//
+// Copyright 2008 Johannes Ballé <balle@ient.rwth-aachen.de>
+//
+// libcabac is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libcabac is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libcabac.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef _OHTU7AY3EI_CABAC_TABLES_H
+#define _OHTU7AY3EI_CABAC_TABLES_H 1
+
+#include <stdint.h>
+
+namespace cabac {
+
+/**
+ * Convert to fixed point with 8 fractional bits.
+ */
+constexpr unsigned int FIX8( const double f ) {
+  return static_cast< unsigned int >( ( f * ( 1 << 8 ) + .5 ) );
+}
+
+/**
+ * Convert to fixed point with 16 fractional bits.
+ */
+constexpr unsigned int FIX16( const double f ) {
+  return static_cast< unsigned int >( ( f * ( 1 << 16 ) + .5 ) );
+}
+
+/**
+ * Probability of the LPS in state state_idx.
+ *
+ * Note that 0.94921714877105312 is pow( 0.01875 / 0.5, 1.0 / 63.0 ), rounded to double precision.
+ */
+constexpr double PLPS( const unsigned int state_idx ) {
+  return state_idx ? PLPS( state_idx - 1 ) * 0.94921714877105312 : 0.5;
+}
+
+namespace impl {
+
+/**
+ * @internal Natural logarithm of x in [1, 2) as 2 * atanh( z ), z = ( x - 1 ) / ( x + 1 ), evaluated
+ * by its power series up to double precision.
+ */
+constexpr double log_series( const double z, const double z2, const double term, const unsigned int n ) {
+  return term / n < 1e-18 ? 0 : term / n + log_series( z, z2, term * z2, n + 2 );
+}
+
+/**
+ * @internal Binary logarithm of x in [1, 2).
+ */
+constexpr double log2_mantissa( const double x ) {
+  return 2 * log_series( ( x - 1 ) / ( x + 1 ), ( ( x - 1 ) / ( x + 1 ) ) * ( ( x - 1 ) / ( x + 1 ) ),
+    ( x - 1 ) / ( x + 1 ), 1 ) / 0.69314718055994531;
+}
+
+/**
+ * @internal Binary logarithm of a positive value, usable in constant expressions.
+ */
+constexpr double log2( const double x ) {
+  return x < 1 ? log2( x * 2 ) - 1 : x >= 2 ? log2( x / 2 ) + 1 : log2_mantissa( x );
+}
+
+}
+
+/**
+ * Self information of an event with probability p in bits.
+ */
+constexpr double BITS( const double p ) {
+  return -impl::log2( p );
+}
+
+namespace impl {
+
+/**
+ * @internal Self information of the MPS in all states below state_idx in bits * 256.
+ */
+constexpr unsigned int mps_bits_sum( const unsigned int state_idx ) {
+  return state_idx ? mps_bits_sum( state_idx - 1 ) + FIX8( BITS( 1 - PLPS( state_idx - 1 ) ) ) : 0;
+}
+
+/**
+ * @internal Number of MPS in a state with the given row of range_tab_lps until the range drops below 256.
+ */
+constexpr unsigned int mps_run_count( const uint8_t ( &lps )[ 4 ], const unsigned int range ) {
+  return range < 256 ? 0 : 1 + mps_run_count( lps, range - lps[ ( range >> 6 ) & 3 ] );
+}
+
+/**
+ * @internal Range after the MPS counted by mps_run_count, before the renormalization.
+ */
+constexpr unsigned int mps_run_range( const uint8_t ( &lps )[ 4 ], const unsigned int range ) {
+  return range < 256 ? range : mps_run_range( lps, range - lps[ ( range >> 6 ) & 3 ] );
+}
+
+/**
+ * @internal Binary logarithm of range / 256 for a range in [256, 512), in bits * 256.
+ */
+constexpr unsigned int range_bits( const unsigned int range ) {
+  return FIX8( log2( range / 256. ) );
+}
+
+}
+
+namespace impl {
+
+/**
+ * @internal Engine tables.
+ *
+ * The tables are static members of a class template, so that they are defined in the header with
+ * external linkage, without requiring a translation unit of their own. They are initialized with
+ * constant expressions, so no code runs at startup, and lookups with constant indexes can be folded
+ * by the compiler.
+ */
+template< class T = void >
+struct tables {
+
+  static constexpr uint8_t range_tab_lps[ 64 ][ 4 ] = {
+    { 128, 176, 208, 240 }, { 128, 167, 197, 227 },
+    { 128, 158, 187, 216 }, { 123, 150, 178, 205 },
+    { 116, 142, 169, 195 }, { 111, 135, 160, 185 },
+    { 105, 128, 152, 175 }, { 100, 122, 144, 166 },
+    {  95, 116, 137, 158 }, {  90, 110, 130, 150 },
+    {  85, 104, 123, 142 }, {  81,  99, 117, 135 },
+    {  77,  94, 111, 128 }, {  73,  89, 105, 122 },
+    {  69,  85, 100, 116 }, {  66,  80,  95, 110 },
+    {  62,  76,  90, 104 }, {  59,  72,  86,  99 },
+    {  56,  69,  81,  94 }, {  53,  65,  77,  89 },
+    {  51,  62,  73,  85 }, {  48,  59,  69,  80 },
+    {  46,  56,  66,  76 }, {  43,  53,  63,  72 },
+    {  41,  50,  59,  69 }, {  39,  48,  56,  65 },
+    {  37,  45,  54,  62 }, {  35,  43,  51,  59 },
+    {  33,  41,  48,  56 }, {  32,  39,  46,  53 },
+    {  30,  37,  43,  50 }, {  29,  35,  41,  48 },
+    {  27,  33,  39,  45 }, {  26,  31,  37,  43 },
+    {  24,  30,  35,  41 }, {  23,  28,  33,  39 },
+    {  22,  27,  32,  37 }, {  21,  26,  30,  35 },
+    {  20,  24,  29,  33 }, {  19,  23,  27,  31 },
+    {  18,  22,  26,  30 }, {  17,  21,  25,  28 },
+    {  16,  20,  23,  27 }, {  15,  19,  22,  25 },
+    {  14,  18,  21,  24 }, {  14,  17,  20,  23 },
+    {  13,  16,  19,  22 }, {  12,  15,  18,  21 },
+    {  12,  14,  17,  20 }, {  11,  14,  16,  19 },
+    {  11,  13,  15,  18 }, {  10,  12,  15,  17 },
+    {  10,  12,  14,  16 }, {   9,  11,  13,  15 },
+    {   9,  11,  12,  14 }, {   8,  10,  12,  14 },
+    {   8,   9,  11,  13 }, {   7,   9,  11,  12 },
+    {   7,   9,  10,  12 }, {   7,   8,  10,  11 },
+    {   6,   8,   9,  11 }, {   6,   7,   9,  10 },
+    {   6,   7,   8,   9 }, {   2,   2,   2,   2 },
+  };
+
+  static constexpr uint8_t trans_idx_lps[ 64 ] = {
+     0,  0,  1,  2,  2,  4,  4,  5,
+     6,  7,  8,  9,  9, 11, 11, 12,
+    13, 13, 15, 15, 16, 16, 18, 18,
+    19, 19, 21, 21, 22, 22, 23, 24,
+    24, 25, 26, 26, 27, 27, 28, 29,
+    29, 30, 30, 30, 31, 32, 32, 33,
+    33, 33, 34, 34, 35, 35, 35, 36,
+    36, 36, 37, 37, 37, 38, 38, 63,
+  };
+
+  static constexpr uint8_t trans_idx_mps[ 64 ] = {
+     1,  2,  3,  4,  5,  6,  7,  8,
+     9, 10, 11, 12, 13, 14, 15, 16,
+    17, 18, 19, 20, 21, 22, 23, 24,
+    25, 26, 27, 28, 29, 30, 31, 32,
+    33, 34, 35, 36, 37, 38, 39, 40,
+    41, 42, 43, 44, 45, 46, 47, 48,
+    49, 50, 51, 52, 53, 54, 55, 56,
+    57, 58, 59, 60, 61, 62, 62, 63,
+  };
+
+  // complete state transition, indexed by state and ( bin_val != valMPS )
+  static constexpr uint8_t next_state_tab[ 128 ][ 2 ] = {
+    {   2,   1 }, {   3,   0 }, {   4,   0 }, {   5,   1 },
+    {   6,   2 }, {   7,   3 }, {   8,   4 }, {   9,   5 },
+    {  10,   4 }, {  11,   5 }, {  12,   8 }, {  13,   9 },
+    {  14,   8 }, {  15,   9 }, {  16,  10 }, {  17,  11 },
+    {  18,  12 }, {  19,  13 }, {  20,  14 }, {  21,  15 },
+    {  22,  16 }, {  23,  17 }, {  24,  18 }, {  25,  19 },
+    {  26,  18 }, {  27,  19 }, {  28,  22 }, {  29,  23 },
+    {  30,  22 }, {  31,  23 }, {  32,  24 }, {  33,  25 },
+    {  34,  26 }, {  35,  27 }, {  36,  26 }, {  37,  27 },
+    {  38,  30 }, {  39,  31 }, {  40,  30 }, {  41,  31 },
+    {  42,  32 }, {  43,  33 }, {  44,  32 }, {  45,  33 },
+    {  46,  36 }, {  47,  37 }, {  48,  36 }, {  49,  37 },
+    {  50,  38 }, {  51,  39 }, {  52,  38 }, {  53,  39 },
+    {  54,  42 }, {  55,  43 }, {  56,  42 }, {  57,  43 },
+    {  58,  44 }, {  59,  45 }, {  60,  44 }, {  61,  45 },
+    {  62,  46 }, {  63,  47 }, {  64,  48 }, {  65,  49 },
+    {  66,  48 }, {  67,  49 }, {  68,  50 }, {  69,  51 },
+    {  70,  52 }, {  71,  53 }, {  72,  52 }, {  73,  53 },
+    {  74,  54 }, {  75,  55 }, {  76,  54 }, {  77,  55 },
+    {  78,  56 }, {  79,  57 }, {  80,  58 }, {  81,  59 },
+    {  82,  58 }, {  83,  59 }, {  84,  60 }, {  85,  61 },
+    {  86,  60 }, {  87,  61 }, {  88,  60 }, {  89,  61 },
+    {  90,  62 }, {  91,  63 }, {  92,  64 }, {  93,  65 },
+    {  94,  64 }, {  95,  65 }, {  96,  66 }, {  97,  67 },
+    {  98,  66 }, {  99,  67 }, { 100,  66 }, { 101,  67 },
+    { 102,  68 }, { 103,  69 }, { 104,  68 }, { 105,  69 },
+    { 106,  70 }, { 107,  71 }, { 108,  70 }, { 109,  71 },
+    { 110,  70 }, { 111,  71 }, { 112,  72 }, { 113,  73 },
+    { 114,  72 }, { 115,  73 }, { 116,  72 }, { 117,  73 },
+    { 118,  74 }, { 119,  75 }, { 120,  74 }, { 121,  75 },
+    { 122,  74 }, { 123,  75 }, { 124,  76 }, { 125,  77 },
+    { 124,  76 }, { 125,  77 }, { 126, 126 }, { 127, 127 },
+  };
+
+  static constexpr float expect_tab[ 128 ] = {
+    PLPS(  0 ), 1 - PLPS(  0 ),
+    PLPS(  1 ), 1 - PLPS(  1 ),
+    PLPS(  2 ), 1 - PLPS(  2 ),
+    PLPS(  3 ), 1 - PLPS(  3 ),
+    PLPS(  4 ), 1 - PLPS(  4 ),
+    PLPS(  5 ), 1 - PLPS(  5 ),
+    PLPS(  6 ), 1 - PLPS(  6 ),
+    PLPS(  7 ), 1 - PLPS(  7 ),
+    PLPS(  8 ), 1 - PLPS(  8 ),
+    PLPS(  9 ), 1 - PLPS(  9 ),
+    PLPS( 10 ), 1 - PLPS( 10 ),
+    PLPS( 11 ), 1 - PLPS( 11 ),
+    PLPS( 12 ), 1 - PLPS( 12 ),
+    PLPS( 13 ), 1 - PLPS( 13 ),
+    PLPS( 14 ), 1 - PLPS( 14 ),
+    PLPS( 15 ), 1 - PLPS( 15 ),
+    PLPS( 16 ), 1 - PLPS( 16 ),
+    PLPS( 17 ), 1 - PLPS( 17 ),
+    PLPS( 18 ), 1 - PLPS( 18 ),
+    PLPS( 19 ), 1 - PLPS( 19 ),
+    PLPS( 20 ), 1 - PLPS( 20 ),
+    PLPS( 21 ), 1 - PLPS( 21 ),
+    PLPS( 22 ), 1 - PLPS( 22 ),
+    PLPS( 23 ), 1 - PLPS( 23 ),
+    PLPS( 24 ), 1 - PLPS( 24 ),
+    PLPS( 25 ), 1 - PLPS( 25 ),
+    PLPS( 26 ), 1 - PLPS( 26 ),
+    PLPS( 27 ), 1 - PLPS( 27 ),
+    PLPS( 28 ), 1 - PLPS( 28 ),
+    PLPS( 29 ), 1 - PLPS( 29 ),
+    PLPS( 30 ), 1 - PLPS( 30 ),
+    PLPS( 31 ), 1 - PLPS( 31 ),
+    PLPS( 32 ), 1 - PLPS( 32 ),
+    PLPS( 33 ), 1 - PLPS( 33 ),
+    PLPS( 34 ), 1 - PLPS( 34 ),
+    PLPS( 35 ), 1 - PLPS( 35 ),
+    PLPS( 36 ), 1 - PLPS( 36 ),
+    PLPS( 37 ), 1 - PLPS( 37 ),
+    PLPS( 38 ), 1 - PLPS( 38 ),
+    PLPS( 39 ), 1 - PLPS( 39 ),
+    PLPS( 40 ), 1 - PLPS( 40 ),
+    PLPS( 41 ), 1 - PLPS( 41 ),
+    PLPS( 42 ), 1 - PLPS( 42 ),
+    PLPS( 43 ), 1 - PLPS( 43 ),
+    PLPS( 44 ), 1 - PLPS( 44 ),
+    PLPS( 45 ), 1 - PLPS( 45 ),
+    PLPS( 46 ), 1 - PLPS( 46 ),
+    PLPS( 47 ), 1 - PLPS( 47 ),
+    PLPS( 48 ), 1 - PLPS( 48 ),
+    PLPS( 49 ), 1 - PLPS( 49 ),
+    PLPS( 50 ), 1 - PLPS( 50 ),
+    PLPS( 51 ), 1 - PLPS( 51 ),
+    PLPS( 52 ), 1 - PLPS( 52 ),
+    PLPS( 53 ), 1 - PLPS( 53 ),
+    PLPS( 54 ), 1 - PLPS( 54 ),
+    PLPS( 55 ), 1 - PLPS( 55 ),
+    PLPS( 56 ), 1 - PLPS( 56 ),
+    PLPS( 57 ), 1 - PLPS( 57 ),
+    PLPS( 58 ), 1 - PLPS( 58 ),
+    PLPS( 59 ), 1 - PLPS( 59 ),
+    PLPS( 60 ), 1 - PLPS( 60 ),
+    PLPS( 61 ), 1 - PLPS( 61 ),
+    PLPS( 62 ), 1 - PLPS( 62 ),
+    PLPS( 63 ), 1 - PLPS( 63 ),
+  };
+
+  static constexpr uint16_t bits_tab[ 128 ] = {
+    FIX8( BITS( 1 - PLPS(  0 ) ) ), FIX8( BITS( PLPS(  0 ) ) ),
+    FIX8( BITS( 1 - PLPS(  1 ) ) ), FIX8( BITS( PLPS(  1 ) ) ),
+    FIX8( BITS( 1 - PLPS(  2 ) ) ), FIX8( BITS( PLPS(  2 ) ) ),
+    FIX8( BITS( 1 - PLPS(  3 ) ) ), FIX8( BITS( PLPS(  3 ) ) ),
+    FIX8( BITS( 1 - PLPS(  4 ) ) ), FIX8( BITS( PLPS(  4 ) ) ),
+    FIX8( BITS( 1 - PLPS(  5 ) ) ), FIX8( BITS( PLPS(  5 ) ) ),
+    FIX8( BITS( 1 - PLPS(  6 ) ) ), FIX8( BITS( PLPS(  6 ) ) ),
+    FIX8( BITS( 1 - PLPS(  7 ) ) ), FIX8( BITS( PLPS(  7 ) ) ),
+    FIX8( BITS( 1 - PLPS(  8 ) ) ), FIX8( BITS( PLPS(  8 ) ) ),
+    FIX8( BITS( 1 - PLPS(  9 ) ) ), FIX8( BITS( PLPS(  9 ) ) ),
+    FIX8( BITS( 1 - PLPS( 10 ) ) ), FIX8( BITS( PLPS( 10 ) ) ),
+    FIX8( BITS( 1 - PLPS( 11 ) ) ), FIX8( BITS( PLPS( 11 ) ) ),
+    FIX8( BITS( 1 - PLPS( 12 ) ) ), FIX8( BITS( PLPS( 12 ) ) ),
+    FIX8( BITS( 1 - PLPS( 13 ) ) ), FIX8( BITS( PLPS( 13 ) ) ),
+    FIX8( BITS( 1 - PLPS( 14 ) ) ), FIX8( BITS( PLPS( 14 ) ) ),
+    FIX8( BITS( 1 - PLPS( 15 ) ) ), FIX8( BITS( PLPS( 15 ) ) ),
+    FIX8( BITS( 1 - PLPS( 16 ) ) ), FIX8( BITS( PLPS( 16 ) ) ),
+    FIX8( BITS( 1 - PLPS( 17 ) ) ), FIX8( BITS( PLPS( 17 ) ) ),
+    FIX8( BITS( 1 - PLPS( 18 ) ) ), FIX8( BITS( PLPS( 18 ) ) ),
+    FIX8( BITS( 1 - PLPS( 19 ) ) ), FIX8( BITS( PLPS( 19 ) ) ),
+    FIX8( BITS( 1 - PLPS( 20 ) ) ), FIX8( BITS( PLPS( 20 ) ) ),
+    FIX8( BITS( 1 - PLPS( 21 ) ) ), FIX8( BITS( PLPS( 21 ) ) ),
+    FIX8( BITS( 1 - PLPS( 22 ) ) ), FIX8( BITS( PLPS( 22 ) ) ),
+    FIX8( BITS( 1 - PLPS( 23 ) ) ), FIX8( BITS( PLPS( 23 ) ) ),
+    FIX8( BITS( 1 - PLPS( 24 ) ) ), FIX8( BITS( PLPS( 24 ) ) ),
+    FIX8( BITS( 1 - PLPS( 25 ) ) ), FIX8( BITS( PLPS( 25 ) ) ),
+    FIX8( BITS( 1 - PLPS( 26 ) ) ), FIX8( BITS( PLPS( 26 ) ) ),
+    FIX8( BITS( 1 - PLPS( 27 ) ) ), FIX8( BITS( PLPS( 27 ) ) ),
+    FIX8( BITS( 1 - PLPS( 28 ) ) ), FIX8( BITS( PLPS( 28 ) ) ),
+    FIX8( BITS( 1 - PLPS( 29 ) ) ), FIX8( BITS( PLPS( 29 ) ) ),
+    FIX8( BITS( 1 - PLPS( 30 ) ) ), FIX8( BITS( PLPS( 30 ) ) ),
+    FIX8( BITS( 1 - PLPS( 31 ) ) ), FIX8( BITS( PLPS( 31 ) ) ),
+    FIX8( BITS( 1 - PLPS( 32 ) ) ), FIX8( BITS( PLPS( 32 ) ) ),
+    FIX8( BITS( 1 - PLPS( 33 ) ) ), FIX8( BITS( PLPS( 33 ) ) ),
+    FIX8( BITS( 1 - PLPS( 34 ) ) ), FIX8( BITS( PLPS( 34 ) ) ),
+    FIX8( BITS( 1 - PLPS( 35 ) ) ), FIX8( BITS( PLPS( 35 ) ) ),
+    FIX8( BITS( 1 - PLPS( 36 ) ) ), FIX8( BITS( PLPS( 36 ) ) ),
+    FIX8( BITS( 1 - PLPS( 37 ) ) ), FIX8( BITS( PLPS( 37 ) ) ),
+    FIX8( BITS( 1 - PLPS( 38 ) ) ), FIX8( BITS( PLPS( 38 ) ) ),
+    FIX8( BITS( 1 - PLPS( 39 ) ) ), FIX8( BITS( PLPS( 39 ) ) ),
+    FIX8( BITS( 1 - PLPS( 40 ) ) ), FIX8( BITS( PLPS( 40 ) ) ),
+    FIX8( BITS( 1 - PLPS( 41 ) ) ), FIX8( BITS( PLPS( 41 ) ) ),
+    FIX8( BITS( 1 - PLPS( 42 ) ) ), FIX8( BITS( PLPS( 42 ) ) ),
+    FIX8( BITS( 1 - PLPS( 43 ) ) ), FIX8( BITS( PLPS( 43 ) ) ),
+    FIX8( BITS( 1 - PLPS( 44 ) ) ), FIX8( BITS( PLPS( 44 ) ) ),
+    FIX8( BITS( 1 - PLPS( 45 ) ) ), FIX8( BITS( PLPS( 45 ) ) ),
+    FIX8( BITS( 1 - PLPS( 46 ) ) ), FIX8( BITS( PLPS( 46 ) ) ),
+    FIX8( BITS( 1 - PLPS( 47 ) ) ), FIX8( BITS( PLPS( 47 ) ) ),
+    FIX8( BITS( 1 - PLPS( 48 ) ) ), FIX8( BITS( PLPS( 48 ) ) ),
+    FIX8( BITS( 1 - PLPS( 49 ) ) ), FIX8( BITS( PLPS( 49 ) ) ),
+    FIX8( BITS( 1 - PLPS( 50 ) ) ), FIX8( BITS( PLPS( 50 ) ) ),
+    FIX8( BITS( 1 - PLPS( 51 ) ) ), FIX8( BITS( PLPS( 51 ) ) ),
+    FIX8( BITS( 1 - PLPS( 52 ) ) ), FIX8( BITS( PLPS( 52 ) ) ),
+    FIX8( BITS( 1 - PLPS( 53 ) ) ), FIX8( BITS( PLPS( 53 ) ) ),
+    FIX8( BITS( 1 - PLPS( 54 ) ) ), FIX8( BITS( PLPS( 54 ) ) ),
+    FIX8( BITS( 1 - PLPS( 55 ) ) ), FIX8( BITS( PLPS( 55 ) ) ),
+    FIX8( BITS( 1 - PLPS( 56 ) ) ), FIX8( BITS( PLPS( 56 ) ) ),
+    FIX8( BITS( 1 - PLPS( 57 ) ) ), FIX8( BITS( PLPS( 57 ) ) ),
+    FIX8( BITS( 1 - PLPS( 58 ) ) ), FIX8( BITS( PLPS( 58 ) ) ),
+    FIX8( BITS( 1 - PLPS( 59 ) ) ), FIX8( BITS( PLPS( 59 ) ) ),
+    FIX8( BITS( 1 - PLPS( 60 ) ) ), FIX8( BITS( PLPS( 60 ) ) ),
+    FIX8( BITS( 1 - PLPS( 61 ) ) ), FIX8( BITS( PLPS( 61 ) ) ),
+    FIX8( BITS( 1 - PLPS( 62 ) ) ), FIX8( BITS( PLPS( 62 ) ) ),
+    FIX8( BITS( 1 - PLPS( 63 ) ) ), FIX8( BITS( PLPS( 63 ) ) ),
+  };
+
+  // cumulative self information of the MPS, indexed by pStateIdx, see run_bits()
+  static constexpr uint32_t mps_bits_sum_tab[ 64 ] = {
+    mps_bits_sum(  0 ), mps_bits_sum(  1 ), mps_bits_sum(  2 ), mps_bits_sum(  3 ),
+    mps_bits_sum(  4 ), mps_bits_sum(  5 ), mps_bits_sum(  6 ), mps_bits_sum(  7 ),
+    mps_bits_sum(  8 ), mps_bits_sum(  9 ), mps_bits_sum( 10 ), mps_bits_sum( 11 ),
+    mps_bits_sum( 12 ), mps_bits_sum( 13 ), mps_bits_sum( 14 ), mps_bits_sum( 15 ),
+    mps_bits_sum( 16 ), mps_bits_sum( 17 ), mps_bits_sum( 18 ), mps_bits_sum( 19 ),
+    mps_bits_sum( 20 ), mps_bits_sum( 21 ), mps_bits_sum( 22 ), mps_bits_sum( 23 ),
+    mps_bits_sum( 24 ), mps_bits_sum( 25 ), mps_bits_sum( 26 ), mps_bits_sum( 27 ),
+    mps_bits_sum( 28 ), mps_bits_sum( 29 ), mps_bits_sum( 30 ), mps_bits_sum( 31 ),
+    mps_bits_sum( 32 ), mps_bits_sum( 33 ), mps_bits_sum( 34 ), mps_bits_sum( 35 ),
+    mps_bits_sum( 36 ), mps_bits_sum( 37 ), mps_bits_sum( 38 ), mps_bits_sum( 39 ),
+    mps_bits_sum( 40 ), mps_bits_sum( 41 ), mps_bits_sum( 42 ), mps_bits_sum( 43 ),
+    mps_bits_sum( 44 ), mps_bits_sum( 45 ), mps_bits_sum( 46 ), mps_bits_sum( 47 ),
+    mps_bits_sum( 48 ), mps_bits_sum( 49 ), mps_bits_sum( 50 ), mps_bits_sum( 51 ),
+    mps_bits_sum( 52 ), mps_bits_sum( 53 ), mps_bits_sum( 54 ), mps_bits_sum( 55 ),
+    mps_bits_sum( 56 ), mps_bits_sum( 57 ), mps_bits_sum( 58 ), mps_bits_sum( 59 ),
+    mps_bits_sum( 60 ), mps_bits_sum( 61 ), mps_bits_sum( 62 ), mps_bits_sum( 63 ),
+  };
+
+  // probability of the LPS with 16 fractional bits, indexed by pStateIdx, see wide_encoder
+  static constexpr uint16_t plps_tab16[ 64 ] = {
+    FIX16( PLPS(  0 ) ), FIX16( PLPS(  1 ) ), FIX16( PLPS(  2 ) ), FIX16( PLPS(  3 ) ),
+    FIX16( PLPS(  4 ) ), FIX16( PLPS(  5 ) ), FIX16( PLPS(  6 ) ), FIX16( PLPS(  7 ) ),
+    FIX16( PLPS(  8 ) ), FIX16( PLPS(  9 ) ), FIX16( PLPS( 10 ) ), FIX16( PLPS( 11 ) ),
+    FIX16( PLPS( 12 ) ), FIX16( PLPS( 13 ) ), FIX16( PLPS( 14 ) ), FIX16( PLPS( 15 ) ),
+    FIX16( PLPS( 16 ) ), FIX16( PLPS( 17 ) ), FIX16( PLPS( 18 ) ), FIX16( PLPS( 19 ) ),
+    FIX16( PLPS( 20 ) ), FIX16( PLPS( 21 ) ), FIX16( PLPS( 22 ) ), FIX16( PLPS( 23 ) ),
+    FIX16( PLPS( 24 ) ), FIX16( PLPS( 25 ) ), FIX16( PLPS( 26 ) ), FIX16( PLPS( 27 ) ),
+    FIX16( PLPS( 28 ) ), FIX16( PLPS( 29 ) ), FIX16( PLPS( 30 ) ), FIX16( PLPS( 31 ) ),
+    FIX16( PLPS( 32 ) ), FIX16( PLPS( 33 ) ), FIX16( PLPS( 34 ) ), FIX16( PLPS( 35 ) ),
+    FIX16( PLPS( 36 ) ), FIX16( PLPS( 37 ) ), FIX16( PLPS( 38 ) ), FIX16( PLPS( 39 ) ),
+    FIX16( PLPS( 40 ) ), FIX16( PLPS( 41 ) ), FIX16( PLPS( 42 ) ), FIX16( PLPS( 43 ) ),
+    FIX16( PLPS( 44 ) ), FIX16( PLPS( 45 ) ), FIX16( PLPS( 46 ) ), FIX16( PLPS( 47 ) ),
+    FIX16( PLPS( 48 ) ), FIX16( PLPS( 49 ) ), FIX16( PLPS( 50 ) ), FIX16( PLPS( 51 ) ),
+    FIX16( PLPS( 52 ) ), FIX16( PLPS( 53 ) ), FIX16( PLPS( 54 ) ), FIX16( PLPS( 55 ) ),
+    FIX16( PLPS( 56 ) ), FIX16( PLPS( 57 ) ), FIX16( PLPS( 58 ) ), FIX16( PLPS( 59 ) ),
+    FIX16( PLPS( 60 ) ), FIX16( PLPS( 61 ) ), FIX16( PLPS( 62 ) ), FIX16( PLPS( 63 ) ),
+  };
+
+  // consecutive MPS in state 62 up to the next renormalization: number and range before the
+  // renormalization, indexed by range - 256, see encoder::encode_run. The range 511 never occurs,
+  // but is covered as well.
+  static constexpr uint8_t mps_run_tab[ 256 ][ 2 ] = {
+#define MPS_RUN( r ) { mps_run_count( range_tab_lps[ 62 ], r ), mps_run_range( range_tab_lps[ 62 ], r ) }
+    MPS_RUN( 256 ), MPS_RUN( 257 ), MPS_RUN( 258 ), MPS_RUN( 259 ),
+    MPS_RUN( 260 ), MPS_RUN( 261 ), MPS_RUN( 262 ), MPS_RUN( 263 ),
+    MPS_RUN( 264 ), MPS_RUN( 265 ), MPS_RUN( 266 ), MPS_RUN( 267 ),
+    MPS_RUN( 268 ), MPS_RUN( 269 ), MPS_RUN( 270 ), MPS_RUN( 271 ),
+    MPS_RUN( 272 ), MPS_RUN( 273 ), MPS_RUN( 274 ), MPS_RUN( 275 ),
+    MPS_RUN( 276 ), MPS_RUN( 277 ), MPS_RUN( 278 ), MPS_RUN( 279 ),
+    MPS_RUN( 280 ), MPS_RUN( 281 ), MPS_RUN( 282 ), MPS_RUN( 283 ),
+    MPS_RUN( 284 ), MPS_RUN( 285 ), MPS_RUN( 286 ), MPS_RUN( 287 ),
+    MPS_RUN( 288 ), MPS_RUN( 289 ), MPS_RUN( 290 ), MPS_RUN( 291 ),
+    MPS_RUN( 292 ), MPS_RUN( 293 ), MPS_RUN( 294 ), MPS_RUN( 295 ),
+    MPS_RUN( 296 ), MPS_RUN( 297 ), MPS_RUN( 298 ), MPS_RUN( 299 ),
+    MPS_RUN( 300 ), MPS_RUN( 301 ), MPS_RUN( 302 ), MPS_RUN( 303 ),
+    MPS_RUN( 304 ), MPS_RUN( 305 ), MPS_RUN( 306 ), MPS_RUN( 307 ),
+    MPS_RUN( 308 ), MPS_RUN( 309 ), MPS_RUN( 310 ), MPS_RUN( 311 ),
+    MPS_RUN( 312 ), MPS_RUN( 313 ), MPS_RUN( 314 ), MPS_RUN( 315 ),
+    MPS_RUN( 316 ), MPS_RUN( 317 ), MPS_RUN( 318 ), MPS_RUN( 319 ),
+    MPS_RUN( 320 ), MPS_RUN( 321 ), MPS_RUN( 322 ), MPS_RUN( 323 ),
+    MPS_RUN( 324 ), MPS_RUN( 325 ), MPS_RUN( 326 ), MPS_RUN( 327 ),
+    MPS_RUN( 328 ), MPS_RUN( 329 ), MPS_RUN( 330 ), MPS_RUN( 331 ),
+    MPS_RUN( 332 ), MPS_RUN( 333 ), MPS_RUN( 334 ), MPS_RUN( 335 ),
+    MPS_RUN( 336 ), MPS_RUN( 337 ), MPS_RUN( 338 ), MPS_RUN( 339 ),
+    MPS_RUN( 340 ), MPS_RUN( 341 ), MPS_RUN( 342 ), MPS_RUN( 343 ),
+    MPS_RUN( 344 ), MPS_RUN( 345 ), MPS_RUN( 346 ), MPS_RUN( 347 ),
+    MPS_RUN( 348 ), MPS_RUN( 349 ), MPS_RUN( 350 ), MPS_RUN( 351 ),
+    MPS_RUN( 352 ), MPS_RUN( 353 ), MPS_RUN( 354 ), MPS_RUN( 355 ),
+    MPS_RUN( 356 ), MPS_RUN( 357 ), MPS_RUN( 358 ), MPS_RUN( 359 ),
+    MPS_RUN( 360 ), MPS_RUN( 361 ), MPS_RUN( 362 ), MPS_RUN( 363 ),
+    MPS_RUN( 364 ), MPS_RUN( 365 ), MPS_RUN( 366 ), MPS_RUN( 367 ),
+    MPS_RUN( 368 ), MPS_RUN( 369 ), MPS_RUN( 370 ), MPS_RUN( 371 ),
+    MPS_RUN( 372 ), MPS_RUN( 373 ), MPS_RUN( 374 ), MPS_RUN( 375 ),
+    MPS_RUN( 376 ), MPS_RUN( 377 ), MPS_RUN( 378 ), MPS_RUN( 379 ),
+    MPS_RUN( 380 ), MPS_RUN( 381 ), MPS_RUN( 382 ), MPS_RUN( 383 ),
+    MPS_RUN( 384 ), MPS_RUN( 385 ), MPS_RUN( 386 ), MPS_RUN( 387 ),
+    MPS_RUN( 388 ), MPS_RUN( 389 ), MPS_RUN( 390 ), MPS_RUN( 391 ),
+    MPS_RUN( 392 ), MPS_RUN( 393 ), MPS_RUN( 394 ), MPS_RUN( 395 ),
+    MPS_RUN( 396 ), MPS_RUN( 397 ), MPS_RUN( 398 ), MPS_RUN( 399 ),
+    MPS_RUN( 400 ), MPS_RUN( 401 ), MPS_RUN( 402 ), MPS_RUN( 403 ),
+    MPS_RUN( 404 ), MPS_RUN( 405 ), MPS_RUN( 406 ), MPS_RUN( 407 ),
+    MPS_RUN( 408 ), MPS_RUN( 409 ), MPS_RUN( 410 ), MPS_RUN( 411 ),
+    MPS_RUN( 412 ), MPS_RUN( 413 ), MPS_RUN( 414 ), MPS_RUN( 415 ),
+    MPS_RUN( 416 ), MPS_RUN( 417 ), MPS_RUN( 418 ), MPS_RUN( 419 ),
+    MPS_RUN( 420 ), MPS_RUN( 421 ), MPS_RUN( 422 ), MPS_RUN( 423 ),
+    MPS_RUN( 424 ), MPS_RUN( 425 ), MPS_RUN( 426 ), MPS_RUN( 427 ),
+    MPS_RUN( 428 ), MPS_RUN( 429 ), MPS_RUN( 430 ), MPS_RUN( 431 ),
+    MPS_RUN( 432 ), MPS_RUN( 433 ), MPS_RUN( 434 ), MPS_RUN( 435 ),
+    MPS_RUN( 436 ), MPS_RUN( 437 ), MPS_RUN( 438 ), MPS_RUN( 439 ),
+    MPS_RUN( 440 ), MPS_RUN( 441 ), MPS_RUN( 442 ), MPS_RUN( 443 ),
+    MPS_RUN( 444 ), MPS_RUN( 445 ), MPS_RUN( 446 ), MPS_RUN( 447 ),
+    MPS_RUN( 448 ), MPS_RUN( 449 ), MPS_RUN( 450 ), MPS_RUN( 451 ),
+    MPS_RUN( 452 ), MPS_RUN( 453 ), MPS_RUN( 454 ), MPS_RUN( 455 ),
+    MPS_RUN( 456 ), MPS_RUN( 457 ), MPS_RUN( 458 ), MPS_RUN( 459 ),
+    MPS_RUN( 460 ), MPS_RUN( 461 ), MPS_RUN( 462 ), MPS_RUN( 463 ),
+    MPS_RUN( 464 ), MPS_RUN( 465 ), MPS_RUN( 466 ), MPS_RUN( 467 ),
+    MPS_RUN( 468 ), MPS_RUN( 469 ), MPS_RUN( 470 ), MPS_RUN( 471 ),
+    MPS_RUN( 472 ), MPS_RUN( 473 ), MPS_RUN( 474 ), MPS_RUN( 475 ),
+    MPS_RUN( 476 ), MPS_RUN( 477 ), MPS_RUN( 478 ), MPS_RUN( 479 ),
+    MPS_RUN( 480 ), MPS_RUN( 481 ), MPS_RUN( 482 ), MPS_RUN( 483 ),
+    MPS_RUN( 484 ), MPS_RUN( 485 ), MPS_RUN( 486 ), MPS_RUN( 487 ),
+    MPS_RUN( 488 ), MPS_RUN( 489 ), MPS_RUN( 490 ), MPS_RUN( 491 ),
+    MPS_RUN( 492 ), MPS_RUN( 493 ), MPS_RUN( 494 ), MPS_RUN( 495 ),
+    MPS_RUN( 496 ), MPS_RUN( 497 ), MPS_RUN( 498 ), MPS_RUN( 499 ),
+    MPS_RUN( 500 ), MPS_RUN( 501 ), MPS_RUN( 502 ), MPS_RUN( 503 ),
+    MPS_RUN( 504 ), MPS_RUN( 505 ), MPS_RUN( 506 ), MPS_RUN( 507 ),
+    MPS_RUN( 508 ), MPS_RUN( 509 ), MPS_RUN( 510 ), MPS_RUN( 511 ),
+#undef MPS_RUN
+  };
+
+  // fractional part of the binary logarithm of the range in bits * 256, indexed by range - 256,
+  // see encoder::tell_bits
+  static constexpr uint8_t range_bits_tab[ 256 ] = {
+    range_bits( 256 ), range_bits( 257 ), range_bits( 258 ), range_bits( 259 ), range_bits( 260 ), range_bits( 261 ),
+    range_bits( 262 ), range_bits( 263 ), range_bits( 264 ), range_bits( 265 ), range_bits( 266 ), range_bits( 267 ),
+    range_bits( 268 ), range_bits( 269 ), range_bits( 270 ), range_bits( 271 ), range_bits( 272 ), range_bits( 273 ),
+    range_bits( 274 ), range_bits( 275 ), range_bits( 276 ), range_bits( 277 ), range_bits( 278 ), range_bits( 279 ),
+    range_bits( 280 ), range_bits( 281 ), range_bits( 282 ), range_bits( 283 ), range_bits( 284 ), range_bits( 285 ),
+    range_bits( 286 ), range_bits( 287 ), range_bits( 288 ), range_bits( 289 ), range_bits( 290 ), range_bits( 291 ),
+    range_bits( 292 ), range_bits( 293 ), range_bits( 294 ), range_bits( 295 ), range_bits( 296 ), range_bits( 297 ),
+    range_bits( 298 ), range_bits( 299 ), range_bits( 300 ), range_bits( 301 ), range_bits( 302 ), range_bits( 303 ),
+    range_bits( 304 ), range_bits( 305 ), range_bits( 306 ), range_bits( 307 ), range_bits( 308 ), range_bits( 309 ),
+    range_bits( 310 ), range_bits( 311 ), range_bits( 312 ), range_bits( 313 ), range_bits( 314 ), range_bits( 315 ),
+    range_bits( 316 ), range_bits( 317 ), range_bits( 318 ), range_bits( 319 ), range_bits( 320 ), range_bits( 321 ),
+    range_bits( 322 ), range_bits( 323 ), range_bits( 324 ), range_bits( 325 ), range_bits( 326 ), range_bits( 327 ),
+    range_bits( 328 ), range_bits( 329 ), range_bits( 330 ), range_bits( 331 ), range_bits( 332 ), range_bits( 333 ),
+    range_bits( 334 ), range_bits( 335 ), range_bits( 336 ), range_bits( 337 ), range_bits( 338 ), range_bits( 339 ),
+    range_bits( 340 ), range_bits( 341 ), range_bits( 342 ), range_bits( 343 ), range_bits( 344 ), range_bits( 345 ),
+    range_bits( 346 ), range_bits( 347 ), range_bits( 348 ), range_bits( 349 ), range_bits( 350 ), range_bits( 351 ),
+    range_bits( 352 ), range_bits( 353 ), range_bits( 354 ), range_bits( 355 ), range_bits( 356 ), range_bits( 357 ),
+    range_bits( 358 ), range_bits( 359 ), range_bits( 360 ), range_bits( 361 ), range_bits( 362 ), range_bits( 363 ),
+    range_bits( 364 ), range_bits( 365 ), range_bits( 366 ), range_bits( 367 ), range_bits( 368 ), range_bits( 369 ),
+    range_bits( 370 ), range_bits( 371 ), range_bits( 372 ), range_bits( 373 ), range_bits( 374 ), range_bits( 375 ),
+    range_bits( 376 ), range_bits( 377 ), range_bits( 378 ), range_bits( 379 ), range_bits( 380 ), range_bits( 381 ),
+    range_bits( 382 ), range_bits( 383 ), range_bits( 384 ), range_bits( 385 ), range_bits( 386 ), range_bits( 387 ),
+    range_bits( 388 ), range_bits( 389 ), range_bits( 390 ), range_bits( 391 ), range_bits( 392 ), range_bits( 393 ),
+    range_bits( 394 ), range_bits( 395 ), range_bits( 396 ), range_bits( 397 ), range_bits( 398 ), range_bits( 399 ),
+    range_bits( 400 ), range_bits( 401 ), range_bits( 402 ), range_bits( 403 ), range_bits( 404 ), range_bits( 405 ),
+    range_bits( 406 ), range_bits( 407 ), range_bits( 408 ), range_bits( 409 ), range_bits( 410 ), range_bits( 411 ),
+    range_bits( 412 ), range_bits( 413 ), range_bits( 414 ), range_bits( 415 ), range_bits( 416 ), range_bits( 417 ),
+    range_bits( 418 ), range_bits( 419 ), range_bits( 420 ), range_bits( 421 ), range_bits( 422 ), range_bits( 423 ),
+    range_bits( 424 ), range_bits( 425 ), range_bits( 426 ), range_bits( 427 ), range_bits( 428 ), range_bits( 429 ),
+    range_bits( 430 ), range_bits( 431 ), range_bits( 432 ), range_bits( 433 ), range_bits( 434 ), range_bits( 435 ),
+    range_bits( 436 ), range_bits( 437 ), range_bits( 438 ), range_bits( 439 ), range_bits( 440 ), range_bits( 441 ),
+    range_bits( 442 ), range_bits( 443 ), range_bits( 444 ), range_bits( 445 ), range_bits( 446 ), range_bits( 447 ),
+    range_bits( 448 ), range_bits( 449 ), range_bits( 450 ), range_bits( 451 ), range_bits( 452 ), range_bits( 453 ),
+    range_bits( 454 ), range_bits( 455 ), range_bits( 456 ), range_bits( 457 ), range_bits( 458 ), range_bits( 459 ),
+    range_bits( 460 ), range_bits( 461 ), range_bits( 462 ), range_bits( 463 ), range_bits( 464 ), range_bits( 465 ),
+    range_bits( 466 ), range_bits( 467 ), range_bits( 468 ), range_bits( 469 ), range_bits( 470 ), range_bits( 471 ),
+    range_bits( 472 ), range_bits( 473 ), range_bits( 474 ), range_bits( 475 ), range_bits( 476 ), range_bits( 477 ),
+    range_bits( 478 ), range_bits( 479 ), range_bits( 480 ), range_bits( 481 ), range_bits( 482 ), range_bits( 483 ),
+    range_bits( 484 ), range_bits( 485 ), range_bits( 486 ), range_bits( 487 ), range_bits( 488 ), range_bits( 489 ),
+    range_bits( 490 ), range_bits( 491 ), range_bits( 492 ), range_bits( 493 ), range_bits( 494 ), range_bits( 495 ),
+    range_bits( 496 ), range_bits( 497 ), range_bits( 498 ), range_bits( 499 ), range_bits( 500 ), range_bits( 501 ),
+    range_bits( 502 ), range_bits( 503 ), range_bits( 504 ), range_bits( 505 ), range_bits( 506 ), range_bits( 507 ),
+    range_bits( 508 ), range_bits( 509 ), range_bits( 510 ), range_bits( 511 ),
+  };
+
+};
+
+template< class T > constexpr uint8_t tables< T >::range_tab_lps[ 64 ][ 4 ];
+template< class T > constexpr uint8_t tables< T >::trans_idx_lps[ 64 ];
+template< class T > constexpr uint8_t tables< T >::trans_idx_mps[ 64 ];
+template< class T > constexpr uint8_t tables< T >::next_state_tab[ 128 ][ 2 ];
+template< class T > constexpr float tables< T >::expect_tab[ 128 ];
+template< class T > constexpr uint16_t tables< T >::bits_tab[ 128 ];
+template< class T > constexpr uint32_t tables< T >::mps_bits_sum_tab[ 64 ];
+template< class T > constexpr uint16_t tables< T >::plps_tab16[ 64 ];
+template< class T > constexpr uint8_t tables< T >::mps_run_tab[ 256 ][ 2 ];
+template< class T > constexpr uint8_t tables< T >::range_bits_tab[ 256 ];
+
+}
+
+// references to the engine tables, as used by the engines
+static constexpr const uint8_t ( &range_tab_lps )[ 64 ][ 4 ] = impl::tables<>::range_tab_lps;
+static constexpr const uint8_t ( &trans_idx_lps )[ 64 ] = impl::tables<>::trans_idx_lps;
+static constexpr const uint8_t ( &trans_idx_mps )[ 64 ] = impl::tables<>::trans_idx_mps;
+static constexpr const uint8_t ( &next_state_tab )[ 128 ][ 2 ] = impl::tables<>::next_state_tab;
+static constexpr const float ( &expect_tab )[ 128 ] = impl::tables<>::expect_tab;
+static constexpr const uint16_t ( &bits_tab )[ 128 ] = impl::tables<>::bits_tab;
+static constexpr const uint32_t ( &mps_bits_sum_tab )[ 64 ] = impl::tables<>::mps_bits_sum_tab;
+static constexpr const uint16_t ( &plps_tab16 )[ 64 ] = impl::tables<>::plps_tab16;
+static constexpr const uint8_t ( &mps_run_tab )[ 256 ][ 2 ] = impl::tables<>::mps_run_tab;
+static constexpr const uint8_t ( &range_bits_tab )[ 256 ] = impl::tables<>::range_bits_tab;
+
+}
+
+#endif
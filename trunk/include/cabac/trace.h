@@ -0,0 +1,250 @@
+//
+// This file is part of libcabac.
+//
+// Copyright 2008 Johannes Ballé <balle@ient.rwth-aachen.de>
+//
+// libcabac is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libcabac is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libcabac.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef _OHTU7AY3EI_CABAC_TRACE_H
+#define _OHTU7AY3EI_CABAC_TRACE_H 1
+
+#include <cabac/observer.h>
+#include <atomic>
+#include <cstring>
+#include <iosfwd>
+#include <memory>
+
+namespace cabac {
+
+/**
+ * Kind of a traced bin.
+ */
+enum trace_kind {
+  trace_decision = 0,
+  trace_bypass = 1,
+  trace_terminal = 2
+};
+
+/**
+ * Fixed-size binary trace record.
+ *
+ * Contains the engine state before coding a single bin.
+ */
+struct trace_record {
+  /** number of bytes written / read so far */
+  uint32_t position;
+  /** the index of the CABAC context (zero for bypass and terminal bins, 0xffffffff for a fixed state) */
+  uint32_t idx;
+  /** the interval range */
+  uint16_t range;
+  /** the lower interval bound (encoder) or offset (decoder) */
+  uint16_t low;
+  /** the state of the context (zero for bypass and terminal bins) */
+  uint8_t state;
+  /** the value of the bin */
+  uint8_t bin_val;
+  /** a trace_kind */
+  uint8_t kind;
+  uint8_t reserved;
+};
+
+/**
+ * Ring buffer of trace records.
+ *
+ * A trace buffer is written by a single thread (the one coding), and may be read concurrently by any
+ * other thread using snapshot(). No locks are involved: each slot is a sequence lock, i.e. the record
+ * is stored as atomic words, guarded by a counter which is odd while the writer updates the slot and
+ * identifies the record held by the slot otherwise. The reader discards records which were changed
+ * while copying them. When the buffer is full, the oldest records are overwritten.
+ *
+ * Each thread has its own buffer, accessible through local().
+ */
+class trace_buffer {
+
+  struct slot {
+    // 2 * ( sequence number + 1 ) of the record held, plus one while writing
+    ::std::atomic< uint64_t > seq;
+    ::std::atomic< uint64_t > words[ 2 ];
+  };
+
+  ::std::unique_ptr< slot[] > _slots;
+  ::std::size_t _size;
+  uint64_t _mask;
+  // sequence numbers keep counting across clear(), so that a slot never holds a stale record
+  // with the sequence number the reader expects
+  ::std::atomic< uint64_t > _head;
+  ::std::atomic< uint64_t > _first;
+
+  static_assert( sizeof( trace_record ) == sizeof( uint64_t[ 2 ] ), "trace_record must fit two words" );
+
+  // prohibit duplication of object
+  trace_buffer( const trace_buffer &other );
+  trace_buffer& operator=( const trace_buffer &other );
+
+  public:
+
+  /**
+   * Constructor.
+   *
+   * @param capacity the number of records to keep, rounded up to a power of two
+   */
+  explicit trace_buffer( ::std::size_t capacity = 1 << 16 );
+
+  /**
+   * Append a record, overwriting the oldest one if the buffer is full.
+   *
+   * Must only be called by the thread owning the buffer.
+   */
+  inline void append( const trace_record &r ) {
+    const uint64_t head = _head.load( ::std::memory_order_relaxed );
+    slot &s = _slots[ head & _mask ];
+    uint64_t words[ 2 ];
+    ::std::memcpy( words, &r, sizeof( words ) );
+    s.seq.store( 2 * head + 1, ::std::memory_order_relaxed );
+    ::std::atomic_thread_fence( ::std::memory_order_release );
+    s.words[ 0 ].store( words[ 0 ], ::std::memory_order_relaxed );
+    s.words[ 1 ].store( words[ 1 ], ::std::memory_order_relaxed );
+    s.seq.store( 2 * head + 2, ::std::memory_order_release );
+    _head.store( head + 1, ::std::memory_order_release );
+  }
+
+  /**
+   * Get number of records appended since construction or the last call to clear().
+   */
+  inline uint64_t total() const {
+    const uint64_t head = _head.load( ::std::memory_order_acquire );
+    const uint64_t first = _first.load( ::std::memory_order_acquire );
+    return head > first ? head - first : 0;
+  }
+
+  /**
+   * Get buffer capacity.
+   */
+  inline ::std::size_t capacity() const {
+    return _size;
+  }
+
+  /**
+   * Copy the records currently held by the buffer.
+   *
+   * May be called from any thread. Records which are overwritten while copying are discarded, and so
+   * are all older records, so that records is always a contiguous sequence.
+   *
+   * @param records receives the records, oldest first
+   * @return the sequence number of the first record in records, counted since the last call to clear()
+   */
+  uint64_t snapshot( ::std::vector< trace_record > &records ) const;
+
+  /**
+   * Discard all records.
+   *
+   * Must only be called by the thread owning the buffer.
+   */
+  void clear();
+
+  /**
+   * Get the trace buffer of the calling thread.
+   */
+  static trace_buffer& local();
+
+};
+
+/**
+ * Engine observer which records each bin into a trace_buffer.
+ *
+ * This replaces compiling the library with debug output. Use it as the observer of an encoder and
+ * the corresponding decoder, dump both buffers using write_trace(), and compare the dumps offline with the
+ * cabac-trace tool in order to find the first bin where encoder and decoder diverge.
+ *
+ * @code
+ * cabac::encoder< iter_type, cabac::trace_recorder > enc( iter_type( bs ), initial_states );
+ * @endcode
+ *
+ * Recording can be switched off at run time by constructing the observer with a null buffer.
+ */
+class trace_recorder : public null_observer {
+
+  trace_buffer *_buffer;
+  uint32_t _position;
+
+  inline void record( const trace_kind kind, const state_vector::size_type idx, const unsigned int state,
+      const unsigned int range, const unsigned int low, const bool bin_val ) {
+    if ( !_buffer )
+      return;
+    trace_record r;
+    r.position = _position;
+    r.idx = idx;
+    r.range = range;
+    r.low = low;
+    r.state = state;
+    r.bin_val = bin_val;
+    r.kind = kind;
+    r.reserved = 0;
+    _buffer->append( r );
+  }
+
+  public:
+
+  /**
+   * Constructor.
+   *
+   * @param buffer the buffer to record to, or 0 to disable recording
+   */
+  trace_recorder( trace_buffer *buffer = &trace_buffer::local() ) :
+    _buffer( buffer ),
+    _position( 0 ) {
+  }
+
+  inline void decision( const state_vector::size_type idx, const unsigned int state,
+      const unsigned int range, const unsigned int low, const bool bin_val ) {
+    record( trace_decision, idx, state, range, low, bin_val );
+  }
+
+  inline void bypass( const unsigned int range, const unsigned int low, const bool bin_val ) {
+    record( trace_bypass, 0, 0, range, low, bin_val );
+  }
+
+  inline void terminal( const unsigned int range, const unsigned int low, const bool bin_val ) {
+    record( trace_terminal, 0, 0, range, low, bin_val );
+  }
+
+  inline void byte() {
+    ++_position;
+  }
+
+};
+
+/**
+ * Write trace records to a binary dump.
+ *
+ * @param os the output stream, opened in binary mode
+ * @param first the sequence number of the first record, as returned by trace_buffer::snapshot()
+ * @param records the records
+ */
+void write_trace( ::std::ostream &os, uint64_t first, const ::std::vector< trace_record > &records );
+
+/**
+ * Read trace records from a binary dump.
+ *
+ * @param is the input stream, opened in binary mode
+ * @param first receives the sequence number of the first record
+ * @param records receives the records
+ * @return true on success, false if the stream does not contain a valid dump
+ */
+bool read_trace( ::std::istream &is, uint64_t &first, ::std::vector< trace_record > &records );
+
+}
+
+#endif
@@ -0,0 +1,153 @@
+//
+// This file is part of libcabac.
+//
+// Copyright 2008 Johannes Ballé <balle@ient.rwth-aachen.de>
+//
+// libcabac is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libcabac is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libcabac.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef _OHTU7AY3EI_CABAC_TRAINING_H
+#define _OHTU7AY3EI_CABAC_TRAINING_H 1
+
+#include <cabac/counting.h>
+#include <cabac/encoder.h>
+#include <functional>
+#include <iosfwd>
+#include <cstddef>
+#include <memory>
+
+namespace cabac {
+
+/**
+ * Parallel training of initial states.
+ *
+ * The training corpus is split into shards (e.g. files or pictures), each of which is coded by a
+ * caller-supplied function using a counting_encoder< void >, starting from the states passed to the
+ * constructor. The shards are distributed dynamically over a number of worker threads, each of which
+ * accumulates the frequencies of its shards in a frequency vector of its own. Finally, the vectors of
+ * the workers are merged in a tree reduction and added to the frequencies of previous training runs.
+ * The worker threads are started by the first call to train() and kept until the trainer is destroyed,
+ * so that repeated training runs do not pay for starting threads.
+ *
+ * Since the frequencies are integers, the result does not depend on the number of threads or the order
+ * in which the shards are processed.
+ *
+ * @code
+ * cabac::trainer t( states );
+ * t.train( files.size(), [&]( cabac::counting_encoder< void > &e, std::size_t shard ) {
+ *   code_file( e, files[ shard ] );
+ * } );
+ * cabac::state_vector trained = t.initialization_vector();
+ * @endcode
+ *
+ * For incremental training, save frequencies() using write_frequencies(), and later continue from the
+ * saved frequencies using add().
+ */
+class trainer {
+
+  public:
+
+  /**
+   * Function coding a shard.
+   *
+   * Called with a freshly constructed counting_encoder< void > object and the index of the shard.
+   * The function is called concurrently from several threads.
+   */
+  typedef ::std::function< void ( counting_encoder< void > &e, ::std::size_t shard ) > shard_function;
+
+  private:
+
+  struct pool;
+
+  const state_vector _states;
+  const unsigned int _threads;
+  frequency_vector _frequencies;
+  ::std::unique_ptr< pool > _pool;
+
+  // prohibit duplication of object
+  trainer( const trainer &other );
+  trainer& operator=( const trainer &other );
+
+  public:
+
+  /**
+   * Constructor.
+   *
+   * @param states the state vector each shard is coded with
+   * @param threads the number of worker threads, or 0 to use one per hardware thread
+   */
+  explicit trainer( const state_vector &states, unsigned int threads = 0 );
+
+  /**
+   * Destructor.
+   *
+   * Stops the worker threads.
+   */
+  ~trainer();
+
+  /**
+   * Code shards and accumulate their frequencies.
+   *
+   * Returns after all shards are coded. May be called several times, e.g. with different corpora.
+   *
+   * @param num the number of shards
+   * @param f the function coding a shard
+   */
+  void train( ::std::size_t num, const shard_function &f );
+
+  /**
+   * Add frequencies of a previous training run.
+   *
+   * @param f the frequencies, with the same number of contexts as the state vector
+   */
+  void add( const frequency_vector &f );
+
+  /**
+   * Get accumulated frequencies.
+   */
+  inline const frequency_vector& frequencies() const {
+    return _frequencies;
+  }
+
+  /**
+   * Compute state initialization vector from accumulated frequencies.
+   *
+   * @see cabac::initialization_vector
+   */
+  inline state_vector initialization_vector() const {
+    return ::cabac::initialization_vector( _frequencies );
+  }
+
+};
+
+/**
+ * Write a frequency vector to a binary file.
+ *
+ * @param os the output stream, opened in binary mode
+ * @param f the frequency vector
+ */
+void write_frequencies( ::std::ostream &os, const frequency_vector &f );
+
+/**
+ * Read a frequency vector from a binary file.
+ *
+ * @param is the input stream, opened in binary mode
+ * @param f receives the frequency vector
+ * @return true on success, false if the stream does not contain a valid frequency vector
+ */
+bool read_frequencies( ::std::istream &is, frequency_vector &f );
+
+}
+
+#endif
@@ -0,0 +1,469 @@
+//
+// This file is part of libcabac.
+//
+// Copyright 2008 Johannes Ballé <balle@ient.rwth-aachen.de>
+//
+// libcabac is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libcabac is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libcabac.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef _OHTU7AY3EI_CABAC_WIDE_H
+#define _OHTU7AY3EI_CABAC_WIDE_H 1
+
+#include <cabac/encoder-base.h>
+#include <cabac/observer.h>
+
+namespace cabac {
+
+/**
+ * CABAC %encoder with a 32 bit range.
+ *
+ * The standard encoder keeps the range in 9 bits, approximates the LPS range by one of four quantized
+ * values per state (range_tab_lps) and renormalizes bit by bit. This encoder keeps the range between
+ * 2^24 and 2^32 and computes the LPS range as the product of the full range with the LPS probability
+ * of the state in 16 bit precision (plps_tab16), so that no quantization of the range is involved.
+ * Renormalization works byte-wise and is required about once per eight bits of output instead of once
+ * per bit, and a carry is resolved by holding back bytes instead of bits.
+ *
+ * The context states and their transitions are the same as in the standard encoder, so models and
+ * state vectors carry over. The resulting bitstream is *not* compatible with ISO/IEC 14496-10 / ITU-T
+ * Rec. H.264 and must be decoded by a wide_decoder. The interface is the same as that of the encoder class,
+ * except that the state cannot be saved and restored, and that encode_raw() and terminated_size() are not
+ * available. Runs are coded bin by bin.
+ *
+ * The observer is notified with the lower 32 bits of the interval bound and with renormalizations in
+ * multiples of eight bits.
+ */
+template< typename I, class O = null_observer >
+class wide_encoder : public impl::encoder_base<> {
+
+  I _data;
+  O _observer;
+
+  uint64_t _low;
+  uint32_t _range;
+  uint64_t _bytes_outstanding;
+  unsigned int _cache;
+  bool _cached;
+  uint64_t _bytes;
+
+  // prohibit duplication of object
+  wide_encoder( const wide_encoder &other );
+  wide_encoder& operator=( const wide_encoder &other );
+
+  void put_byte( const unsigned int b ) {
+    *_data++ = b;
+    ++_bytes;
+    _observer.byte();
+  }
+
+  /**
+   * Output the upper byte of the lower interval bound.
+   *
+   * The byte is held back until the next one is known not to cause a carry into it. Bytes of 0xff
+   * are held back as outstanding bytes, as a carry would ripple through them.
+   */
+  void shift_low() {
+    if ( _low < 0xff000000u || _low >= 0x100000000ull ) {
+      const unsigned int carry = static_cast< unsigned int >( _low >> 32 );
+      if ( _cached )
+        put_byte( ( _cache + carry ) & 0xff );
+      if ( _bytes_outstanding )
+        _observer.outstanding( static_cast< unsigned int >( 8 * _bytes_outstanding ) );
+      for ( ; _bytes_outstanding; --_bytes_outstanding )
+        put_byte( ( 0xff + carry ) & 0xff );
+      _cache = ( _low >> 24 ) & 0xff;
+      _cached = true;
+    } else {
+      ++_bytes_outstanding;
+    }
+    _low = ( _low & 0xffffff ) << 8;
+  }
+
+  void renorm() {
+    unsigned int shifts = 0;
+    while ( _range < 0x1000000 ) {
+      _range <<= 8;
+      shift_low();
+      shifts += 8;
+    }
+    _observer.renorm( shifts );
+  }
+
+  public:
+
+  typedef I iterator_type;
+  typedef O observer_type;
+
+  /**
+   * Constructor.
+   *
+   * @param output an STL-compatible output iterator on a container of uint8_t, used to write the bitstream
+   * @param states the initial state vector
+   * @param observer the observer object
+   */
+  wide_encoder( const I &output, const state_vector &states, const O &observer = O() ) :
+    impl::encoder_base<>( states ),
+    _data( output ),
+    _observer( observer ),
+    _low( 0 ),
+    _range( 0xffffffff ),
+    _bytes_outstanding( 0 ),
+    _cache( 0 ),
+    _cached( false ),
+    _bytes( 0 ) {
+  }
+
+  /**
+   * Destructor.
+   *
+   * Writes the remaining four bytes of the lower interval bound, which the decoder reads ahead.
+   *
+   * @see encoder::~encoder
+   */
+  ~wide_encoder() {
+    for ( unsigned int i = 0; i < 5; ++i )
+      shift_low();
+  }
+
+  /**
+   * Get observer object.
+   */
+  inline O& observer() {
+    return _observer;
+  }
+
+  /**
+   * Get number of bytes written so far.
+   *
+   * Bytes which are held back by the encoder are not counted.
+   */
+  inline uint64_t bytes() const {
+    return _bytes;
+  }
+
+  /**
+   * Get number of bits produced so far.
+   *
+   * Counts the bytes shifted out of the lower interval bound, including those held back, and adds
+   * 32 - log2( range ) bits for the pending state, so that the difference between two calls approximates
+   * the self information of the bins coded in between. Takes constant time.
+   *
+   * @see encoder::tell_bits
+   *
+   * @return the number of bits in bits * 256
+   */
+  inline uint64_t tell_bits() const {
+    const uint64_t shifted = _bytes + _cached + _bytes_outstanding;
+    const unsigned int n = 31 - impl::clz( _range );
+    return ( ( shifted * 8 + 32 - n ) << 8 ) - range_bits_tab[ ( _range >> ( n - 8 ) ) - 0x100 ];
+  }
+
+  /**
+   * Encode a binary decision.
+   *
+   * @see encoder::encode
+   */
+  void encode( const state_vector::size_type idx, const bool bin_val ) {
+    assert( 0 <= idx );
+    assert( idx < _states.size() );
+    const unsigned int state = _states[ idx ];
+    _observer.decision( idx, state, _range, static_cast< unsigned int >( _low ), bin_val );
+    const uint32_t range_lps = static_cast< uint32_t >( ( static_cast< uint64_t >( _range ) * plps_tab16[ state >> 1 ] ) >> 16 );
+    const bool lps = ( state ^ bin_val ) & 1;
+    _range -= range_lps;
+    if ( lps ) {
+      _low += _range;
+      _range = range_lps;
+    }
+    _states[ idx ] = next_state_tab[ state ][ lps ];
+    renorm();
+  }
+
+  /**
+   * Encode a hard-to-predict binary decision.
+   *
+   * @see encoder::encode_unpredictable
+   */
+  inline void encode_unpredictable( const state_vector::size_type idx, const bool bin_val ) {
+    encode( idx, bin_val );
+  }
+
+  /**
+   * Encode a binary decision with a fixed state.
+   *
+   * @see encoder::encode_static
+   */
+  void encode_static( const unsigned int state, const bool bin_val ) {
+    assert( state < 128 );
+    _observer.decision( static_context, state, _range, static_cast< unsigned int >( _low ), bin_val );
+    const uint32_t range_lps = static_cast< uint32_t >( ( static_cast< uint64_t >( _range ) * plps_tab16[ state >> 1 ] ) >> 16 );
+    _range -= range_lps;
+    if ( ( state ^ bin_val ) & 1 ) {
+      _low += _range;
+      _range = range_lps;
+    }
+    renorm();
+  }
+
+  /**
+   * Encode a run of MPS, optionally followed by an LPS, with the same context.
+   *
+   * @see encoder::encode_run
+   */
+  void encode_run( const state_vector::size_type idx, uint64_t n_mps, const bool then_lps ) {
+    assert( idx < _states.size() );
+    const bool val_mps = _states[ idx ] & 1;
+    for ( ; n_mps; --n_mps )
+      encode( idx, val_mps );
+    if ( then_lps )
+      encode( idx, !val_mps );
+  }
+
+  /**
+   * Encode a binary decision using the bypass engine.
+   *
+   * @see encoder::encode_bypass
+   */
+  void encode_bypass( const bool bin_val ) {
+    _observer.bypass( _range, static_cast< unsigned int >( _low ), bin_val );
+    _range >>= 1;
+    if ( bin_val )
+      _low += _range;
+    renorm();
+  }
+
+  /**
+   * Encode several binary decisions using the bypass engine.
+   *
+   * Equivalent to n calls to encode_bypass(), so that binarizations coding bins in bulk (e.g.
+   * encode_ueg_array) yield the same bitstream as the scalar ones.
+   *
+   * @param value the values of the bins, the first in the most significant bit
+   * @param n the number of bins, at most 16
+   */
+  void encode_bypass_bits( const unsigned int value, unsigned int n ) {
+    assert( n <= 16 );
+    while ( n-- )
+      encode_bypass( ( value >> n ) & 1 );
+  }
+
+  /**
+   * Encode a terminal bit.
+   *
+   * The probability of a terminal bit of 1 is 2^-24 or less.
+   *
+   * @see encoder::encode_terminal
+   */
+  void encode_terminal( const bool bin_val ) {
+    _observer.terminal( _range, static_cast< unsigned int >( _low ), bin_val );
+    _range -= 0x100;
+    if ( bin_val ) {
+      _low += _range;
+      _range = 0x100;
+    }
+    renorm();
+  }
+
+};
+
+/**
+ * CABAC %decoder for bitstreams written by wide_encoder.
+ *
+ * @see decoder
+ */
+template< typename I, class O = null_observer >
+class wide_decoder : public impl::decoder_base<> {
+
+  I _data;
+  O _observer;
+
+  uint32_t _range;
+  uint32_t _offset;
+
+  // prohibit duplication of object
+  wide_decoder( const wide_decoder &other );
+  wide_decoder& operator=( const wide_decoder &other );
+
+  unsigned int read_byte() {
+    const unsigned int b = static_cast< uint8_t >( *_data );
+    _data++;
+    _observer.byte();
+    return b;
+  }
+
+  void renorm() {
+    unsigned int shifts = 0;
+    while ( _range < 0x1000000 ) {
+      _range <<= 8;
+      _offset = ( _offset << 8 ) | read_byte();
+      shifts += 8;
+    }
+    _observer.renorm( shifts );
+  }
+
+  public:
+
+  typedef I iterator_type;
+  typedef O observer_type;
+
+  /**
+   * Constructor.
+   *
+   * @param input an STL-compatible input iterator on a container of uint8_t, used to read the bitstream
+   * @param states the initial state vector
+   * @param observer the observer object
+   */
+  wide_decoder( const I &input, const state_vector &states, const O &observer = O() ) :
+    impl::decoder_base<>( states ),
+    _data( input ),
+    _observer( observer ),
+    _range( 0xffffffff ),
+    _offset( 0 ) {
+    for ( unsigned int i = 0; i < 4; ++i )
+      _offset = ( _offset << 8 ) | read_byte();
+  }
+
+  /**
+   * Get observer object.
+   */
+  inline O& observer() {
+    return _observer;
+  }
+
+  /**
+   * Decode a binary decision.
+   *
+   * @see wide_encoder::encode
+   */
+  bool decode( const state_vector::size_type idx ) {
+    assert( 0 <= idx );
+    assert( idx < _states.size() );
+    const unsigned int state = _states[ idx ];
+    const uint32_t range = _range;
+    const uint32_t offset = _offset;
+    const uint32_t range_lps = static_cast< uint32_t >( ( static_cast< uint64_t >( _range ) * plps_tab16[ state >> 1 ] ) >> 16 );
+    _range -= range_lps;
+    const bool lps = _offset >= _range;
+    if ( lps ) {
+      _offset -= _range;
+      _range = range_lps;
+    }
+    _states[ idx ] = next_state_tab[ state ][ lps ];
+    renorm();
+    const bool bin_val = ( state ^ lps ) & 1;
+    _observer.decision( idx, state, range, offset, bin_val );
+    return bin_val;
+  }
+
+  /**
+   * Decode a hard-to-predict binary decision.
+   *
+   * @see wide_encoder::encode_unpredictable
+   */
+  inline bool decode_unpredictable( const state_vector::size_type idx ) {
+    return decode( idx );
+  }
+
+  /**
+   * Decode a binary decision with a fixed state.
+   *
+   * @see wide_encoder::encode_static
+   */
+  bool decode_static( const unsigned int state ) {
+    assert( state < 128 );
+    const uint32_t range = _range;
+    const uint32_t offset = _offset;
+    const uint32_t range_lps = static_cast< uint32_t >( ( static_cast< uint64_t >( _range ) * plps_tab16[ state >> 1 ] ) >> 16 );
+    _range -= range_lps;
+    bool bin_val = state & 1;
+    if ( _offset >= _range ) {
+      bin_val = !bin_val;
+      _offset -= _range;
+      _range = range_lps;
+    }
+    renorm();
+    _observer.decision( static_context, state, range, offset, bin_val );
+    return bin_val;
+  }
+
+  /**
+   * Decode a run of MPS with the same context.
+   *
+   * @see decoder::decode_mps_run
+   */
+  uint64_t decode_mps_run( const state_vector::size_type idx, const uint64_t max_n ) {
+    assert( idx < _states.size() );
+    const bool val_mps = _states[ idx ] & 1;
+    uint64_t n = 0;
+    while ( n < max_n && decode( idx ) == val_mps )
+      ++n;
+    return n;
+  }
+
+  /**
+   * Decode a binary decision using the bypass engine.
+   *
+   * @see wide_encoder::encode_bypass
+   */
+  bool decode_bypass() {
+    const uint32_t range = _range;
+    const uint32_t offset = _offset;
+    _range >>= 1;
+    const bool bin_val = _offset >= _range;
+    if ( bin_val )
+      _offset -= _range;
+    renorm();
+    _observer.bypass( range, offset, bin_val );
+    return bin_val;
+  }
+
+  /**
+   * Decode several binary decisions using the bypass engine.
+   *
+   * @see wide_encoder::encode_bypass_bits
+   *
+   * @param n the number of bins, at most 16
+   * @return the values of the bins, the first in the most significant bit
+   */
+  unsigned int decode_bypass_bits( unsigned int n ) {
+    assert( n <= 16 );
+    unsigned int value = 0;
+    while ( n-- )
+      value = ( value << 1 ) | decode_bypass();
+    return value;
+  }
+
+  /**
+   * Decode a terminal bit.
+   *
+   * @see wide_encoder::encode_terminal
+   */
+  bool decode_terminal() {
+    _observer.terminal( _range, _offset, _offset >= _range - 0x100 );
+    _range -= 0x100;
+    const bool bin_val = _offset >= _range;
+    if ( bin_val ) {
+      _offset -= _range;
+      _range = 0x100;
+    }
+    renorm();
+    return bin_val;
+  }
+
+};
+
+}
+
+#endif
@@ -0,0 +1,77 @@
+//
+// This file is part of libcabac.
+//
+// Copyright 2008 Johannes Ballé <balle@ient.rwth-aachen.de>
+//
+// libcabac is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libcabac is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libcabac.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <cabac/append.h>
+#include "binary-io.h"
+#include <algorithm>
+
+namespace cabac {
+
+namespace {
+
+const char state_magic[ 8 ] = { 'C', 'A', 'B', 'A', 'C', 'E', 'S', '1' };
+
+}
+
+void write_encoder_state( ::std::ostream &os, const encoder_state &state ) {
+  assert( state.range >= 0x100 && state.range < 0x200 && state.low + state.range <= 0x400 && state.byte < 0x100 );
+  assert( 0 <= state.shift && state.shift <= 8 );
+  os.write( state_magic, sizeof( state_magic ) );
+  impl::put( os, state.bytes, 8 );
+  impl::put( os, state.low, 2 );
+  impl::put( os, state.range, 2 );
+  impl::put( os, state.bits_outstanding, 4 );
+  impl::put( os, state.byte, 1 );
+  impl::put( os, state.shift, 1 );
+  impl::put( os, state.states.size(), 4 );
+  os.write( reinterpret_cast< const char* >( state.states.data() ), state.states.size() );
+}
+
+bool read_encoder_state( ::std::istream &is, encoder_state &state ) {
+  char magic[ sizeof( state_magic ) ];
+  if ( !is.read( magic, sizeof( magic ) ) ||
+      !::std::equal( magic, magic + sizeof( magic ), state_magic ) )
+    return false;
+  uint64_t bytes, low, range, bits_outstanding, byte, shift, size;
+  if ( !impl::get( is, bytes, 8 ) || !impl::get( is, low, 2 ) || !impl::get( is, range, 2 ) ||
+      !impl::get( is, bits_outstanding, 4 ) || !impl::get( is, byte, 1 ) || !impl::get( is, shift, 1 ) ||
+      !impl::get( is, size, 4 ) )
+    return false;
+  // the interval lies within the 10 bit register, and the bits of the incomplete byte at and below
+  // the next bit are still zero, i.e. the whole byte before its first bit
+  if ( range < 0x100 || range >= 0x200 || low + range > 0x400 || shift > 8 || byte >= 0x100 ||
+      ( byte & ( ( 2u << shift ) - 1 ) ) )
+    return false;
+  ::std::vector< uint8_t > states;
+  if ( !impl::get( is, states, size ) )
+    return false;
+  for ( uint64_t i = 0; i < size; ++i )
+    if ( states[ i ] >= 128 )
+      return false;
+  state.states.swap( states );
+  state.bytes = bytes;
+  state.low = low;
+  state.range = range;
+  state.bits_outstanding = bits_outstanding;
+  state.byte = byte;
+  state.shift = static_cast< int >( shift );
+  return true;
+}
+
+}
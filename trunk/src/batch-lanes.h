@@ -0,0 +1,394 @@
+//
+// This file is part of libcabac.
+//
+// Copyright 2008 Johannes Ballé <balle@ient.rwth-aachen.de>
+//
+// libcabac is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libcabac is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libcabac.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+// Batch engines running one message per vector lane.
+//
+// This file is included by dispatch.cpp once per instruction set variant, inside a
+// namespace of its own and a region compiled for the respective target, with
+// CABAC_BATCH_LANES defined to the number of 32 bit lanes of the vector registers.
+//
+// The arithmetic of all lanes is done with GCC vector extensions, table lookups with
+// gather instructions. Only the byte output of the encoder and the byte input of the
+// decoder are done lane by lane, once every eight bits per lane.
+//
+// The encoder keeps the pending output bits in its low register and writes whole
+// bytes, resolving carries on the bytes written before (as done by x264). This yields
+// exactly the bitstream of the bitwise encoder.
+
+const unsigned int lanes = CABAC_BATCH_LANES;
+
+typedef uint32_t lane_u32 __attribute__(( vector_size( 4 * CABAC_BATCH_LANES ) ));
+typedef int32_t lane_s32 __attribute__(( vector_size( 4 * CABAC_BATCH_LANES ) ));
+typedef float lane_f32 __attribute__(( vector_size( 4 * CABAC_BATCH_LANES ) ));
+
+inline lane_u32 gather( const uint32_t *table, const lane_u32 index ) {
+#if CABAC_BATCH_LANES == 16
+  // the masked form, as the pass-through operand of the unmasked one is left undefined
+  return ( lane_u32 ) _mm512_mask_i32gather_epi32( _mm512_setzero_si512(), 0xffff, ( __m512i ) index, table, 4 );
+#else
+  return ( lane_u32 ) _mm256_i32gather_epi32( reinterpret_cast< const int* >( table ), ( __m256i ) index, 4 );
+#endif
+}
+
+// number of shifts to renormalize a range of 2 to 0x1ff, from the exponent of its floating point value
+inline lane_u32 renorm_shift( const lane_u32 range ) {
+  const lane_s32 exponent = ( ( lane_s32 ) __builtin_convertvector( ( lane_s32 ) range, lane_f32 ) >> 23 ) - 127;
+  const lane_s32 shift = 8 - exponent;
+  return ( lane_u32 ) ( shift & ( shift > 0 ) );
+}
+
+// tables widened to 32 bits for the gathers
+struct lane_tables {
+
+  uint32_t range_lps[ 64 * 4 ];
+  uint32_t next_state[ 128 * 2 ];
+  lane_u32 lane;
+
+  lane_tables() {
+    for ( unsigned int i = 0; i < 64 * 4; ++i )
+      range_lps[ i ] = range_tab_lps[ i >> 2 ][ i & 3 ];
+    for ( unsigned int i = 0; i < 128 * 2; ++i )
+      next_state[ i ] = next_state_tab[ i >> 1 ][ i & 1 ];
+    for ( unsigned int l = 0; l < lanes; ++l )
+      lane[ l ] = l;
+  }
+
+};
+
+// state vectors of all lanes, interleaved
+struct lane_states {
+
+  const state_vector &_initial;
+  ::std::vector< uint32_t > _states;
+
+  lane_states( const state_vector &initial ) :
+    _initial( initial ),
+    // at least one context, so that bypass lanes can gather index 0
+    _states( ( initial.size() ? initial.size() : 1 ) * lanes ) {
+  }
+
+  void reset( const unsigned int l ) {
+    for ( state_vector::size_type i = 0; i < _initial.size(); ++i )
+      _states[ i * lanes + l ] = _initial[ i ];
+  }
+
+  inline const uint32_t* data() const {
+    return &_states[ 0 ];
+  }
+
+  inline void store( const lane_u32 index, const lane_u32 states, const lane_u32 mask ) {
+#if CABAC_BATCH_LANES == 16
+    _mm512_mask_i32scatter_epi32( &_states[ 0 ], _mm512_test_epi32_mask( ( __m512i ) mask, ( __m512i ) mask ),
+      ( __m512i ) index, ( __m512i ) states, 4 );
+#else
+    for ( unsigned int l = 0; l < lanes; ++l )
+      if ( mask[ l ] )
+        _states[ index[ l ] ] = states[ l ];
+#endif
+  }
+
+};
+
+class batch_encoder {
+
+  const lane_tables _tables;
+  lane_states _states;
+
+  const batch_encode_message *_messages;
+  const ::std::size_t _num;
+  kernel_bitstream *_bitstreams;
+  ::std::size_t _next;
+
+  lane_u32 _low;
+  lane_u32 _range;
+  lane_s32 _queue;
+  unsigned int _outstanding[ lanes ];
+  ::std::size_t _message[ lanes ];
+  ::std::size_t _pos[ lanes ];
+  bool _active[ lanes ];
+
+  void put_byte( const unsigned int l ) {
+    const uint32_t out = _low[ l ] >> ( _queue[ l ] + 10 );
+    _low[ l ] &= ( 0x400u << _queue[ l ] ) - 1;
+    _queue[ l ] -= 8;
+    if ( ( out & 0xff ) == 0xff ) {
+      ++_outstanding[ l ];
+      return;
+    }
+    kernel_bitstream &bs = _bitstreams[ _message[ l ] ];
+    const uint8_t carry = out >> 8;
+    if ( carry && !bs.empty() )
+      bs.back() += carry;
+    for ( ; _outstanding[ l ]; --_outstanding[ l ] )
+      bs.push_back( carry - 1 );
+    bs.push_back( out );
+  }
+
+  void shift( const unsigned int l, const unsigned int n ) {
+    _low[ l ] <<= n;
+    _queue[ l ] += n;
+    while ( _queue[ l ] >= 0 )
+      put_byte( l );
+  }
+
+  // same as destroying the bitwise encoder
+  void finish( const unsigned int l ) {
+    // renormalization with a range of 2
+    shift( l, 7 );
+    // bits 9 and 8 of low, followed by the stop bit
+    _low[ l ] = ( _low[ l ] & ~0xffu ) | 0x80;
+    shift( l, 3 );
+    // padding up to and including the last, incomplete byte
+    shift( l, 8 - ( ( _queue[ l ] + 8 ) & 7 ) );
+    for ( ; _outstanding[ l ]; --_outstanding[ l ] )
+      _bitstreams[ _message[ l ] ].push_back( 0xff );
+  }
+
+  // assign the next message to a lane, finishing the current one
+  void refill( const unsigned int l ) {
+    while ( _active[ l ] && _pos[ l ] == _messages[ _message[ l ] ].num ) {
+      finish( l );
+      _active[ l ] = _next < _num;
+      if ( !_active[ l ] )
+        return;
+      _message[ l ] = _next++;
+      _pos[ l ] = 0;
+      _low[ l ] = 0;
+      _range[ l ] = 0x1fe;
+      _queue[ l ] = -9;
+      _outstanding[ l ] = 0;
+      _states.reset( l );
+    }
+  }
+
+  public:
+
+  batch_encoder( const state_vector &states, const batch_encode_message *messages, const ::std::size_t num,
+      kernel_bitstream *bitstreams ) :
+    _states( states ),
+    _messages( messages ),
+    _num( num ),
+    _bitstreams( bitstreams ),
+    _next( 0 ) {
+    for ( unsigned int l = 0; l < lanes; ++l ) {
+      _active[ l ] = _next < _num;
+      if ( _active[ l ] ) {
+        _message[ l ] = _next++;
+        _states.reset( l );
+      }
+      _pos[ l ] = 0;
+      _low[ l ] = 0;
+      _range[ l ] = 0x1fe;
+      _queue[ l ] = -9;
+      _outstanding[ l ] = 0;
+    }
+  }
+
+  void run() {
+    const lane_u32 bypass_idx = lane_u32() + kernel_bypass;
+    for ( ;; ) {
+      lane_u32 idx, bin, active;
+      bool any = false;
+      for ( unsigned int l = 0; l < lanes; ++l ) {
+        refill( l );
+        any |= _active[ l ];
+        if ( _active[ l ] ) {
+          const batch_encode_message &m = _messages[ _message[ l ] ];
+          idx[ l ] = m.idx[ _pos[ l ] ];
+          bin[ l ] = m.bins[ _pos[ l ] ] ? 1 : 0;
+          active[ l ] = ~0u;
+          ++_pos[ l ];
+        } else {
+          idx[ l ] = kernel_bypass;
+          bin[ l ] = 0;
+          active[ l ] = 0;
+        }
+      }
+      if ( !any )
+        return;
+      const lane_u32 is_bypass = ( lane_u32 ) ( idx == bypass_idx );
+      const lane_u32 ctx = active & ~is_bypass;
+      const lane_u32 bypass = active & is_bypass;
+
+      // context coded bins
+      const lane_u32 index = ( ( idx & ctx ) * lanes ) + _tables.lane;
+      const lane_u32 state = gather( _states.data(), index );
+      const lane_u32 range_lps = gather( _tables.range_lps, ( ( state >> 1 ) << 2 ) | ( ( _range >> 6 ) & 3 ) );
+      const lane_u32 lps = ( state ^ bin ) & 1;
+      const lane_u32 lps_mask = -lps;
+      const lane_u32 range_mps = _range - range_lps;
+      lane_u32 ctx_low = _low + ( range_mps & lps_mask );
+      lane_u32 ctx_range = ( range_mps & ~lps_mask ) | ( range_lps & lps_mask );
+      _states.store( index, gather( _tables.next_state, ( state << 1 ) | lps ), ctx );
+      const lane_u32 shift = renorm_shift( ctx_range ) & ctx;
+      ctx_range <<= shift;
+      ctx_low <<= shift;
+
+      // bypass bins
+      const lane_u32 bypass_low = ( _low << 1 ) + ( _range & -bin );
+
+      _low = ( ctx_low & ctx ) | ( bypass_low & bypass ) | ( _low & ~active );
+      _range = ( ctx_range & ctx ) | ( _range & ~ctx );
+      _queue += ( lane_s32 ) ( shift | ( bypass & 1 ) );
+
+      for ( unsigned int l = 0; l < lanes; ++l )
+        if ( _queue[ l ] >= 0 )
+          put_byte( l );
+    }
+  }
+
+};
+
+class batch_decoder {
+
+  const lane_tables _tables;
+  lane_states _states;
+
+  const batch_decode_message *_messages;
+  const ::std::size_t _num;
+  ::std::size_t _next;
+
+  // the offset, followed by _bits bits read ahead
+  lane_u32 _value;
+  lane_u32 _range;
+  lane_u32 _bits;
+  ::std::size_t _message[ lanes ];
+  ::std::size_t _pos[ lanes ];
+  ::std::size_t _byte[ lanes ];
+  bool _active[ lanes ];
+
+  inline uint32_t read_byte( const unsigned int l ) {
+    const batch_decode_message &m = _messages[ _message[ l ] ];
+    return _byte[ l ] < m.size ? m.data[ _byte[ l ]++ ] : 0;
+  }
+
+  void start( const unsigned int l ) {
+    _pos[ l ] = 0;
+    _byte[ l ] = 0;
+    _range[ l ] = 0x1fe;
+    _value[ l ] = read_byte( l ) << 8;
+    _value[ l ] |= read_byte( l );
+    _bits[ l ] = 7;
+    _states.reset( l );
+  }
+
+  void refill( const unsigned int l ) {
+    while ( _active[ l ] && _pos[ l ] == _messages[ _message[ l ] ].num ) {
+      _active[ l ] = _next < _num;
+      if ( !_active[ l ] )
+        return;
+      _message[ l ] = _next++;
+      start( l );
+    }
+  }
+
+  public:
+
+  batch_decoder( const state_vector &states, const batch_decode_message *messages, const ::std::size_t num ) :
+    _states( states ),
+    _messages( messages ),
+    _num( num ),
+    _next( 0 ) {
+    for ( unsigned int l = 0; l < lanes; ++l ) {
+      _active[ l ] = _next < _num;
+      if ( _active[ l ] ) {
+        _message[ l ] = _next++;
+        start( l );
+      } else {
+        _pos[ l ] = 0;
+        _value[ l ] = 0;
+        _range[ l ] = 0x1fe;
+        _bits[ l ] = 7;
+      }
+    }
+  }
+
+  void run() {
+    const lane_u32 bypass_idx = lane_u32() + kernel_bypass;
+    for ( ;; ) {
+      lane_u32 idx, active;
+      bool any = false;
+      for ( unsigned int l = 0; l < lanes; ++l ) {
+        refill( l );
+        any |= _active[ l ];
+        if ( _active[ l ] ) {
+          idx[ l ] = _messages[ _message[ l ] ].idx[ _pos[ l ] ];
+          active[ l ] = ~0u;
+        } else {
+          idx[ l ] = kernel_bypass;
+          active[ l ] = 0;
+        }
+      }
+      if ( !any )
+        return;
+      const lane_u32 is_bypass = ( lane_u32 ) ( idx == bypass_idx );
+      const lane_u32 ctx = active & ~is_bypass;
+      const lane_u32 bypass = active & is_bypass;
+
+      // context coded bins
+      const lane_u32 index = ( ( idx & ctx ) * lanes ) + _tables.lane;
+      const lane_u32 state = gather( _states.data(), index );
+      const lane_u32 range_lps = gather( _tables.range_lps, ( ( state >> 1 ) << 2 ) | ( ( _range >> 6 ) & 3 ) );
+      const lane_u32 range_mps = _range - range_lps;
+      const lane_u32 scaled_mps = range_mps << _bits;
+      const lane_u32 lps_mask = ( lane_u32 ) ( _value >= scaled_mps );
+      const lane_u32 lps = lps_mask & 1;
+      lane_u32 ctx_value = _value - ( scaled_mps & lps_mask );
+      lane_u32 ctx_range = ( range_mps & ~lps_mask ) | ( range_lps & lps_mask );
+      const lane_u32 ctx_bin = ( state & 1 ) ^ lps;
+      _states.store( index, gather( _tables.next_state, ( state << 1 ) | lps ), ctx );
+      const lane_u32 shift = renorm_shift( ctx_range ) & ctx;
+      ctx_range <<= shift;
+
+      // bypass bins
+      const lane_u32 bypass_bits = _bits - 1;
+      const lane_u32 scaled_range = _range << bypass_bits;
+      const lane_u32 bypass_mask = ( lane_u32 ) ( _value >= scaled_range );
+      const lane_u32 bypass_value = _value - ( scaled_range & bypass_mask );
+
+      const lane_u32 bin = ( ctx_bin & ctx ) | ( bypass_mask & bypass & 1 );
+      _value = ( ctx_value & ctx ) | ( bypass_value & bypass ) | ( _value & ~active );
+      _range = ( ctx_range & ctx ) | ( _range & ~ctx );
+      _bits -= shift | ( bypass & 1 );
+
+      for ( unsigned int l = 0; l < lanes; ++l ) {
+        if ( !_active[ l ] )
+          continue;
+        _messages[ _message[ l ] ].bins[ _pos[ l ]++ ] = bin[ l ];
+        // keep at least 7 bits read ahead, enough for the next renormalization
+        if ( _bits[ l ] < 7 ) {
+          _value[ l ] = ( _value[ l ] << 8 ) | read_byte( l );
+          _bits[ l ] += 8;
+        }
+      }
+    }
+  }
+
+};
+
+void encode_batch( const state_vector &states, const batch_encode_message *messages, ::std::size_t num,
+    kernel_bitstream *bitstreams ) {
+  batch_encoder e( states, messages, num, bitstreams );
+  e.run();
+}
+
+void decode_batch( const state_vector &states, const batch_decode_message *messages, ::std::size_t num ) {
+  batch_decoder d( states, messages, num );
+  d.run();
+}
@@ -0,0 +1,442 @@
+//
+// This file is part of libcabac.
+//
+// Copyright 2008 Johannes Ballé <balle@ient.rwth-aachen.de>
+//
+// libcabac is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libcabac is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libcabac.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <vector>
+#include <iterator>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cstdlib>
+#include <ctime>
+#include <cmath>
+#include <cabac.h>
+
+using namespace std;
+using namespace cabac;
+
+typedef vector< uint8_t > bitstream;
+typedef back_insert_iterator< bitstream > output_type;
+typedef bitstream::const_iterator input_type;
+
+static double ns_per_bin( const clock_t start, const unsigned int num ) {
+  return ( clock() - start ) * 1e9 / CLOCKS_PER_SEC / num;
+}
+
+// generate num bins which are one with probability p
+static vector< uint8_t > generate( const unsigned int num, const double p ) {
+  vector< uint8_t > bins( num );
+  for ( unsigned int i = 0; i < num; ++i )
+    bins[ i ] = rand() < p * RAND_MAX;
+  return bins;
+}
+
+static bool run( const char *name, const vector< uint8_t > &bins, const unsigned int num_ctx ) {
+  const unsigned int num = bins.size();
+  const state_vector states( num_ctx, 0 );
+  bitstream branching, branchless;
+  branching.reserve( num / 4 );
+  branchless.reserve( num / 4 );
+  double t_enc, t_enc_ul, t_dec, t_dec_ul;
+  unsigned int errors = 0;
+
+  {
+    encoder< output_type > e( output_type( branching ), states );
+    const clock_t start = clock();
+    for ( unsigned int i = 0; i < num; ++i )
+      e.encode( i % num_ctx, bins[ i ] );
+    t_enc = ns_per_bin( start, num );
+  }
+  {
+    encoder< output_type > e( output_type( branchless ), states );
+    const clock_t start = clock();
+    for ( unsigned int i = 0; i < num; ++i )
+      e.encode_unpredictable( i % num_ctx, bins[ i ] );
+    t_enc_ul = ns_per_bin( start, num );
+  }
+  if ( branching != branchless )
+    ++errors;
+  {
+    decoder< input_type > d( branching.begin(), states );
+    const clock_t start = clock();
+    for ( unsigned int i = 0; i < num; ++i )
+      errors += d.decode( i % num_ctx ) != bins[ i ];
+    t_dec = ns_per_bin( start, num );
+  }
+  {
+    decoder< input_type > d( branching.begin(), states );
+    const clock_t start = clock();
+    for ( unsigned int i = 0; i < num; ++i )
+      errors += d.decode_unpredictable( i % num_ctx ) != bins[ i ];
+    t_dec_ul = ns_per_bin( start, num );
+  }
+
+  cout << setw( 10 ) << left << name << right << fixed << setprecision( 2 )
+    << setw( 10 ) << 8. * branching.size() / num
+    << setw( 10 ) << t_enc << setw( 14 ) << t_enc_ul
+    << setw( 10 ) << t_dec << setw( 14 ) << t_dec_ul
+    << ( errors ? "  MISMATCH" : "" ) << endl;
+  return !errors;
+}
+
+// messages of 32 bins, every fourth of which is a bypass bin
+static bool run_batch( const vector< uint8_t > &bins, const unsigned int num_ctx ) {
+  const unsigned int size = 32, num = bins.size() / size;
+  const state_vector states( num_ctx, 0 );
+  vector< uint32_t > idx( bins.size() );
+  for ( unsigned int i = 0; i < idx.size(); ++i )
+    idx[ i ] = i % 4 == 3 ? kernel_bypass : i % num_ctx;
+  vector< batch_encode_message > messages( num );
+  for ( unsigned int i = 0; i < num; ++i ) {
+    const batch_encode_message m = { &idx[ i * size ], &bins[ i * size ], size };
+    messages[ i ] = m;
+  }
+  vector< kernel_bitstream > reference;
+  bool ok = true;
+
+  const char *variants[] = { "generic", "lzcnt", "bmi2", "avx2", "avx512" };
+  for ( unsigned int v = 0; v < sizeof( variants ) / sizeof( *variants ); ++v ) {
+    const kernel_table *k = find_kernels( variants[ v ] );
+    if ( !k )
+      continue;
+    vector< kernel_bitstream > streams( num );
+    clock_t start = clock();
+    k->encode_batch( states, &messages[ 0 ], num, &streams[ 0 ] );
+    const double t_enc = ( clock() - start ) / static_cast< double >( CLOCKS_PER_SEC );
+    vector< uint8_t > decoded( bins.size() );
+    vector< batch_decode_message > decode_messages( num );
+    for ( unsigned int i = 0; i < num; ++i ) {
+      const batch_decode_message m = { &streams[ i ][ 0 ], streams[ i ].size(), &idx[ i * size ], &decoded[ i * size ], size };
+      decode_messages[ i ] = m;
+    }
+    start = clock();
+    k->decode_batch( states, &decode_messages[ 0 ], num );
+    const double t_dec = ( clock() - start ) / static_cast< double >( CLOCKS_PER_SEC );
+    if ( reference.empty() )
+      reference.swap( streams );
+    const bool errors = ( !streams.empty() && streams != reference ) || !equal( decoded.begin(), decoded.begin() + num * size, bins.begin() );
+    cout << setw( 10 ) << left << k->name << right << fixed << setprecision( 2 )
+      << setw( 10 ) << k->batch_lanes
+      << setw( 14 ) << num / t_enc * 1e-6 << setw( 14 ) << num / t_dec * 1e-6
+      << ( errors ? "  MISMATCH" : "" ) << endl;
+    ok &= !errors;
+  }
+  return ok;
+}
+
+// 4x4 blocks with about a third of nonzero coefficients, coded with encode_block and decode_block
+static bool run_blocks( const unsigned int num_coeffs ) {
+  const unsigned int num = num_coeffs / 16;
+  vector< int16_t > coeffs( num * 16 ), decoded( num * 16 );
+  for ( unsigned int i = 0; i < coeffs.size(); ++i )
+    if ( rand() % 3 == 0 )
+      coeffs[ i ] = ( rand() % 4 ? 1 : 2 + rand() % 10 ) * ( rand() % 2 ? -1 : 1 );
+  for ( unsigned int b = 0; b < num; ++b )
+    coeffs[ b * 16 ] |= 1;
+  const state_vector states( 42, 0 );
+  const block_contexts ctx = { 0, 16, 32, 0, 0, 4 };
+  bitstream bs;
+  double t_enc, t_dec;
+  {
+    encoder< output_type > e( output_type( bs ), states );
+    const clock_t start = clock();
+    for ( unsigned int b = 0; b < num; ++b )
+      encode_block( e, &coeffs[ b * 16 ], 16, ctx );
+    t_enc = ns_per_bin( start, num * 16 );
+  }
+  {
+    decoder< input_type > d( bs.begin(), states );
+    const clock_t start = clock();
+    for ( unsigned int b = 0; b < num; ++b )
+      decode_block( d, &decoded[ b * 16 ], 16, ctx );
+    t_dec = ns_per_bin( start, num * 16 );
+  }
+  const bool ok = coeffs == decoded;
+  cout << "residual blocks: " << fixed << setprecision( 2 ) << t_enc << " ns / coefficient encode, "
+    << t_dec << " ns / coefficient decode" << ( ok ? "" : "  MISMATCH" ) << endl;
+  return ok;
+}
+
+// signed integers with a Laplacian-like distribution, coded one by one and as an array
+static bool run_arrays( const unsigned int num ) {
+  vector< int > values( num ), decoded( num );
+  for ( unsigned int i = 0; i < num; ++i )
+    values[ i ] = static_cast< int >( -log( ( rand() + 1. ) / ( RAND_MAX + 2. ) ) * 200 ) * ( rand() % 2 ? -1 : 1 );
+  const state_vector states( 4, 0 );
+  bitstream scalar_bs, array_bs;
+  double t_enc, t_enc_array, t_dec, t_dec_array;
+  {
+    encoder< output_type > e( output_type( scalar_bs ), states );
+    const clock_t start = clock();
+    for ( unsigned int i = 0; i < num; ++i )
+      encode_seg( e, values[ i ], 4, 0, 4 );
+    t_enc = ns_per_bin( start, num );
+  }
+  {
+    encoder< output_type > e( output_type( array_bs ), states );
+    const clock_t start = clock();
+    encode_seg_array( e, &values[ 0 ], num, 4, 0, 4 );
+    t_enc_array = ns_per_bin( start, num );
+  }
+  {
+    decoder< input_type > d( scalar_bs.begin(), states );
+    const clock_t start = clock();
+    for ( unsigned int i = 0; i < num; ++i )
+      decoded[ i ] = decode_seg( d, 4, 0, 4 );
+    t_dec = ns_per_bin( start, num );
+  }
+  bool ok = decoded == values;
+  {
+    decoder< input_type > d( array_bs.begin(), states );
+    const clock_t start = clock();
+    decode_seg_array( d, &decoded[ 0 ], num, 4, 0, 4 );
+    t_dec_array = ns_per_bin( start, num );
+  }
+  ok &= decoded == values && scalar_bs == array_bs;
+  cout << "signed integers, ns / value: " << fixed << setprecision( 2 ) << t_enc << " encode, " << t_enc_array
+    << " encode_seg_array, " << t_dec << " decode, " << t_dec_array << " decode_seg_array" << ( ok ? "" : "  MISMATCH" ) << endl;
+  return ok;
+}
+
+// flags which are one with probability 0.01, coded bin by bin and as runs of zeros
+static bool run_runs( const vector< uint8_t > &flags ) {
+  const unsigned int num = flags.size();
+  const state_vector states( 1, 124 );
+  vector< unsigned int > runs;
+  for ( unsigned int i = 0; i < num; ++i ) {
+    unsigned int n = 0;
+    while ( i < num && !flags[ i ] ) {
+      ++n;
+      ++i;
+    }
+    runs.push_back( n );
+  }
+  bitstream bin_bs, run_bs;
+  double t_enc, t_enc_run, t_dec, t_dec_run;
+  unsigned int errors = 0;
+  {
+    encoder< output_type > e( output_type( bin_bs ), states );
+    const clock_t start = clock();
+    for ( unsigned int i = 0; i < num; ++i )
+      e.encode( 0, flags[ i ] );
+    t_enc = ns_per_bin( start, num );
+  }
+  {
+    encoder< output_type > e( output_type( run_bs ), states );
+    const clock_t start = clock();
+    for ( unsigned int i = 0; i < runs.size(); ++i )
+      e.encode_run( 0, runs[ i ], i + 1 < runs.size() || flags.back() );
+    t_enc_run = ns_per_bin( start, num );
+  }
+  if ( bin_bs != run_bs )
+    ++errors;
+  {
+    decoder< input_type > d( bin_bs.begin(), states );
+    const clock_t start = clock();
+    for ( unsigned int i = 0; i < num; ++i )
+      errors += d.decode( 0 ) != flags[ i ];
+    t_dec = ns_per_bin( start, num );
+  }
+  {
+    decoder< input_type > d( bin_bs.begin(), states );
+    const clock_t start = clock();
+    for ( unsigned int i = 0; i < runs.size(); ++i )
+      errors += d.decode_mps_run( 0, runs[ i ] + ( i + 1 < runs.size() || flags.back() ) ) != runs[ i ];
+    t_dec_run = ns_per_bin( start, num );
+  }
+  cout << "flags at p=0.01, ns / bin: " << fixed << setprecision( 2 ) << t_enc << " encode, " << t_enc_run
+    << " encode_run, " << t_dec << " decode, " << t_dec_run << " decode_mps_run" << ( errors ? "  MISMATCH" : "" ) << endl;
+  return !errors;
+}
+
+// a bilevel image of random blobs, coded with contexts gathered pixel by pixel and with bilevel_coder
+static bool run_bilevel( const unsigned int width, const unsigned int height ) {
+  const size_t stride = ( width + 7 ) / 8;
+  vector< uint8_t > image( stride * height );
+  for ( unsigned int y = 0; y < height; ++y )
+    for ( unsigned int x = 0; x < width; ++x )
+      image[ y * stride + x / 8 ] |= ( ( ( x / 13 ) * 7 + ( y / 11 ) * 5 ) % 3 == 0 || rand() % 64 == 0 ) << ( 7 - x % 8 );
+  const bilevel_template t = jbig2_template0();
+  bilevel_coder coder( t, width, false );
+  const state_vector states( coder.num_contexts(), 0 );
+  bitstream gathered, rolled;
+  double t_gathered, t_rolled, t_dec;
+  {
+    encoder< output_type > e( output_type( gathered ), states );
+    const clock_t start = clock();
+    for ( unsigned int y = 0; y < height; ++y )
+      for ( unsigned int x = 0; x < width; ++x ) {
+        unsigned int ctx = 0;
+        for ( int dy = -2; dy <= 0; ++dy ) {
+          const int left = dy == -2 ? t.row2_left : dy == -1 ? t.row1_left : t.row0_left;
+          const int right = dy == -2 ? t.row2_right : dy == -1 ? t.row1_right : -1;
+          for ( int dx = left; dx <= right; ++dx ) {
+            const int px = x + dx, py = y + dy;
+            ctx = ( ctx << 1 ) | ( py >= 0 && px >= 0 && px < static_cast< int >( width ) &&
+              ( ( image[ py * stride + px / 8 ] >> ( 7 - px % 8 ) ) & 1 ) );
+          }
+        }
+        e.encode( ctx, ( image[ y * stride + x / 8 ] >> ( 7 - x % 8 ) ) & 1 );
+      }
+    t_gathered = ns_per_bin( start, width * height );
+  }
+  {
+    encoder< output_type > e( output_type( rolled ), states );
+    const clock_t start = clock();
+    for ( unsigned int y = 0; y < height; ++y )
+      coder.encode_row( e, &image[ y * stride ] );
+    t_rolled = ns_per_bin( start, width * height );
+  }
+  vector< uint8_t > decoded( image.size() );
+  coder.reset();
+  {
+    decoder< input_type > d( rolled.begin(), states );
+    const clock_t start = clock();
+    for ( unsigned int y = 0; y < height; ++y )
+      coder.decode_row( d, &decoded[ y * stride ] );
+    t_dec = ns_per_bin( start, width * height );
+  }
+  const bool ok = gathered == rolled && decoded == image;
+  cout << "bilevel image, ns / pixel: " << fixed << setprecision( 2 ) << t_gathered << " encode gathering pixels, "
+    << t_rolled << " encode_row, " << t_dec << " decode_row" << ( ok ? "" : "  MISMATCH" ) << endl;
+  return ok;
+}
+
+// Exp-Golomb coded values with long suffixes, with the bypass bins in the arithmetic stream and in a side stream
+static bool run_split( const unsigned int num ) {
+  vector< unsigned int > values( num ), decoded( num );
+  for ( unsigned int i = 0; i < num; ++i )
+    values[ i ] = static_cast< unsigned int >( -log( ( rand() + 1. ) / ( RAND_MAX + 2. ) ) * 5000 );
+  const state_vector states( 4, 0 );
+  bitstream single_bs, split_bs;
+  double t_enc, t_enc_split, t_dec, t_dec_split;
+  {
+    encoder< output_type > e( output_type( single_bs ), states );
+    const clock_t start = clock();
+    encode_ueg_array( e, &values[ 0 ], num, 3, 0, 4 );
+    t_enc = ns_per_bin( start, num );
+  }
+  {
+    split_encoder< output_type > e( output_type( split_bs ), states );
+    const clock_t start = clock();
+    encode_ueg_array( e, &values[ 0 ], num, 3, 0, 4 );
+    t_enc_split = ns_per_bin( start, num );
+  }
+  {
+    decoder< input_type > d( single_bs.begin(), states );
+    const clock_t start = clock();
+    decode_ueg_array( d, &decoded[ 0 ], num, 3, 0, 4 );
+    t_dec = ns_per_bin( start, num );
+  }
+  bool ok = decoded == values;
+  {
+    split_decoder<> d( &split_bs[ 0 ], states );
+    const clock_t start = clock();
+    decode_ueg_array( d, &decoded[ 0 ], num, 3, 0, 4 );
+    t_dec_split = ns_per_bin( start, num );
+  }
+  ok &= decoded == values;
+  cout << "bypass side stream, ns / value: " << fixed << setprecision( 2 ) << t_enc << " encode, " << t_enc_split
+    << " split_encoder, " << t_dec << " decode, " << t_dec_split << " split_decoder; " << single_bs.size() << " vs. "
+    << split_bs.size() << " bytes" << ( ok ? "" : "  MISMATCH" ) << endl;
+  return ok;
+}
+
+// the same bins written through a growing vector, a vector reserved with the prediction, and a raw pointer
+static bool run_output( const vector< uint8_t > &bins, const unsigned int num_ctx ) {
+  const unsigned int num = bins.size();
+  const state_vector states( num_ctx, 0 );
+  encoder< void > simulation( states );
+  for ( unsigned int i = 0; i < num; ++i )
+    simulation.encode( i % num_ctx, bins[ i ] );
+  bitstream growing, reserved, raw( max_encoded_bytes( num, 0, 1 ) );
+  reserved.reserve( simulation.predicted_bytes() );
+  double t_growing, t_reserved, t_raw;
+  {
+    encoder< output_type > e( output_type( growing ), states );
+    const clock_t start = clock();
+    for ( unsigned int i = 0; i < num; ++i )
+      e.encode( i % num_ctx, bins[ i ] );
+    e.encode_terminal( 1 );
+    t_growing = ns_per_bin( start, num );
+  }
+  {
+    encoder< output_type > e( output_type( reserved ), states );
+    const clock_t start = clock();
+    for ( unsigned int i = 0; i < num; ++i )
+      e.encode( i % num_ctx, bins[ i ] );
+    e.encode_terminal( 1 );
+    t_reserved = ns_per_bin( start, num );
+  }
+  uint64_t size;
+  {
+    encoder< uint8_t* > e( &raw[ 0 ], states );
+    const clock_t start = clock();
+    for ( unsigned int i = 0; i < num; ++i )
+      e.encode( i % num_ctx, bins[ i ] );
+    e.encode_terminal( 1 );
+    t_raw = ns_per_bin( start, num );
+    size = e.terminated_size();
+  }
+  raw.resize( size );
+  const bool ok = growing == reserved && growing == raw;
+  cout << "output, ns / bin: " << fixed << setprecision( 2 ) << t_growing << " growing vector, " << t_reserved
+    << " reserved vector, " << t_raw << " raw pointer; predicted " << simulation.predicted_bytes() << " bytes, actual "
+    << size << ", bound " << max_encoded_bytes( num, 0, 1 ) << ( ok ? "" : "  MISMATCH" ) << endl;
+  return ok;
+}
+
+int main( int argc, char *argv[] ) {
+
+  if ( argc != 2 ) {
+    cout << "syntax: " << argv[ 0 ] << " #decisions" << endl;
+    return -1;
+  }
+
+  const unsigned int num_decisions = atoi( argv[ 1 ] );
+
+  srand( time( 0 ) );
+
+  cout << "times in ns / bin" << endl;
+  cout << setw( 10 ) << left << "source" << right
+    << setw( 10 ) << "bits/bin"
+    << setw( 10 ) << "encode" << setw( 14 ) << "encode_unpr"
+    << setw( 10 ) << "decode" << setw( 14 ) << "decode_unpr" << endl;
+
+  bool ok = true;
+  ok &= run( "p=0.50", generate( num_decisions, 0.5 ), 16 );
+  ok &= run( "p=0.35", generate( num_decisions, 0.35 ), 16 );
+  ok &= run( "p=0.10", generate( num_decisions, 0.1 ), 16 );
+  ok &= run( "p=0.02", generate( num_decisions, 0.02 ), 16 );
+
+  cout << endl << "batches of 32-bin messages at p=0.35, in million messages / s" << endl;
+  cout << setw( 10 ) << left << "kernels" << right
+    << setw( 10 ) << "lanes" << setw( 14 ) << "encode" << setw( 14 ) << "decode" << endl;
+  ok &= run_batch( generate( num_decisions, 0.35 ), 16 );
+
+  cout << endl;
+  ok &= run_blocks( num_decisions );
+  ok &= run_arrays( num_decisions / 8 );
+  ok &= run_output( generate( num_decisions, 0.1 ), 16 );
+  ok &= run_runs( generate( num_decisions, 0.01 ) );
+  ok &= run_bilevel( 1024, num_decisions / 1024 + 1 );
+  ok &= run_split( num_decisions / 8 );
+
+  return ok ? 0 : 1;
+
+}
@@ -0,0 +1,69 @@
+//
+// This file is part of libcabac.
+//
+// Copyright 2008 Johannes Ballé <balle@ient.rwth-aachen.de>
+//
+// libcabac is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libcabac is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libcabac.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef _OHTU7AY3EI_CABAC_BINARY_IO_H
+#define _OHTU7AY3EI_CABAC_BINARY_IO_H 1
+
+// Helpers for the binary files written by the library.
+//
+// Files are stored little endian, independent of the host.
+
+#include <istream>
+#include <ostream>
+#include <stdint.h>
+#include <vector>
+
+namespace cabac {
+namespace impl {
+
+inline void put( ::std::ostream &os, uint64_t value, unsigned int bytes ) {
+  while ( bytes-- ) {
+    os.put( static_cast< char >( value & 0xff ) );
+    value >>= 8;
+  }
+}
+
+inline bool get( ::std::istream &is, uint64_t &value, const unsigned int bytes ) {
+  value = 0;
+  for ( unsigned int i = 0; i < bytes; ++i ) {
+    const int c = is.get();
+    if ( c == ::std::istream::traits_type::eof() )
+      return false;
+    value |= static_cast< uint64_t >( c & 0xff ) << ( 8 * i );
+  }
+  return true;
+}
+
+// reads in chunks, so that a corrupt size fails at the end of the stream instead of allocating
+inline bool get( ::std::istream &is, ::std::vector< uint8_t > &data, const uint64_t size ) {
+  data.clear();
+  for ( uint64_t read = 0; read < size; ) {
+    const uint64_t chunk = size - read < 0x10000 ? size - read : 0x10000;
+    data.resize( read + chunk );
+    if ( !is.read( reinterpret_cast< char* >( &data[ read ] ), chunk ) )
+      return false;
+    read += chunk;
+  }
+  return true;
+}
+
+}
+}
+
+#endif
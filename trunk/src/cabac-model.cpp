@@ -0,0 +1,54 @@
+//
+// This file is part of libcabac.
+//
+// Copyright 2008 Johannes Ballé <balle@ient.rwth-aachen.de>
+//
+// libcabac is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libcabac is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libcabac.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <cabac/training.h>
+#include <cabac/model.h>
+
+using namespace std;
+using namespace cabac;
+
+int main( int argc, char *argv[] ) {
+
+  if ( argc != 3 && argc != 5 ) {
+    cout << "syntax: " << argv[ 0 ] << " frequencies name [bypass-gain static-threshold]" << endl;
+    cout << "writes the C++ header of the compiled model to stdout" << endl;
+    return -1;
+  }
+
+  frequency_vector f;
+  ifstream is( argv[ 1 ], ios::binary );
+  if ( !is || !read_frequencies( is, f ) ) {
+    cerr << argv[ 1 ] << ": not a valid frequency vector" << endl;
+    return 1;
+  }
+
+  const model_plan plan = argc == 5 ? compile_model( f, atof( argv[ 3 ] ), atof( argv[ 4 ] ) ) : compile_model( f );
+  write_model_header( cout, plan, argv[ 2 ] );
+  unsigned int count[ 3 ] = { 0, 0, 0 };
+  for ( model_plan::size_type i = 0; i < plan.size(); ++i )
+    count[ plan[ i ].strategy ]++;
+  cerr << count[ strategy_adaptive ] << " adaptive, " << count[ strategy_bypass ] << " bypass, "
+    << count[ strategy_static ] << " static context(s)" << endl;
+  return 0;
+
+}
@@ -0,0 +1,122 @@
+//
+// This file is part of libcabac.
+//
+// Copyright 2008 Johannes Ballé <balle@ient.rwth-aachen.de>
+//
+// libcabac is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libcabac is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libcabac.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <vector>
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <bitset>
+#include <cstring>
+#include <cabac/trace.h>
+
+using namespace std;
+using namespace cabac;
+
+static bool load( const char *filename, uint64_t &first, vector< trace_record > &records ) {
+  ifstream is( filename, ios::binary );
+  if ( !is || !read_trace( is, first, records ) ) {
+    cerr << filename << ": not a valid trace dump" << endl;
+    return false;
+  }
+  return true;
+}
+
+static void print( const uint64_t seq, const trace_record &r, const char *low_name = "LOW" ) {
+  cout << setfill( ' ' ) << right << setw( 10 ) << seq << setfill( '0' );
+  switch ( r.kind ) {
+    case trace_decision:
+      if ( r.idx == static_cast< uint32_t >( static_context ) )
+        cout << " STATIC ";
+      else
+        cout << " CTX " << setw( 3 ) << r.idx;
+      break;
+    case trace_bypass:
+      cout << " BYPASS ";
+      break;
+    default:
+      cout << " TERM   ";
+  }
+  cout << " RNG " << bitset< 16 >( r.range ).to_string()
+    << " " << low_name << " " << bitset< 16 >( r.low ).to_string();
+  if ( r.kind == trace_decision )
+    cout << " MPS " << ( r.state & 1 ) << " IDX " << setw( 2 ) << ( r.state >> 1 );
+  else
+    cout << " MPS - IDX --";
+  cout << " DEC " << static_cast< int >( r.bin_val )
+    << " POS " << r.position << endl;
+}
+
+static int print_trace( const char *filename ) {
+  uint64_t first;
+  vector< trace_record > records;
+  if ( !load( filename, first, records ) )
+    return 1;
+  for ( vector< trace_record >::size_type i = 0; i < records.size(); ++i )
+    print( first + i, records[ i ] );
+  return 0;
+}
+
+// compare everything the encoder and the decoder have in common
+static bool match( const trace_record &e, const trace_record &d ) {
+  return e.kind == d.kind && e.idx == d.idx && e.state == d.state &&
+    e.range == d.range && e.bin_val == d.bin_val;
+}
+
+static int diff_trace( const char *enc_filename, const char *dec_filename ) {
+  uint64_t enc_first, dec_first;
+  vector< trace_record > enc, dec;
+  if ( !load( enc_filename, enc_first, enc ) || !load( dec_filename, dec_first, dec ) )
+    return 2;
+  const uint64_t first = max( enc_first, dec_first );
+  const uint64_t last = min( enc_first + enc.size(), dec_first + dec.size() );
+  if ( first >= last ) {
+    cout << "traces do not overlap" << endl;
+    return 2;
+  }
+  for ( uint64_t seq = first; seq < last; ++seq ) {
+    const trace_record &e = enc[ seq - enc_first ];
+    const trace_record &d = dec[ seq - dec_first ];
+    if ( match( e, d ) )
+      continue;
+    cout << "encoder and decoder diverge at bin " << seq << ":" << endl;
+    const uint64_t context = seq - first < 8 ? seq - first : 8;
+    for ( uint64_t i = seq - context; i <= seq; ++i ) {
+      cout << "enc";
+      print( i, enc[ i - enc_first ] );
+      cout << "dec";
+      print( i, dec[ i - dec_first ], "OFS" );
+    }
+    return 1;
+  }
+  cout << "bins " << first << " to " << last - 1 << " match" << endl;
+  return 0;
+}
+
+int main( int argc, char *argv[] ) {
+
+  if ( argc == 3 && !strcmp( argv[ 1 ], "print" ) )
+    return print_trace( argv[ 2 ] );
+  if ( argc == 4 && !strcmp( argv[ 1 ], "diff" ) )
+    return diff_trace( argv[ 2 ], argv[ 3 ] );
+
+  cout << "syntax: " << argv[ 0 ] << " print dump" << endl;
+  cout << "        " << argv[ 0 ] << " diff encoder-dump decoder-dump" << endl;
+  return -1;
+
+}
@@ -0,0 +1,230 @@
+//
+// This file is part of libcabac.
+//
+// Copyright 2008 Johannes Ballé <balle@ient.rwth-aachen.de>
+//
+// libcabac is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libcabac is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libcabac.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <cabac/dispatch.h>
+#include <cabac/integer.h>
+#include <cstdlib>
+#include <cstring>
+
+// The kernels below are plain loops over the inline engine methods. Each variant is
+// compiled with a target attribute, so the inlined engine code (in particular the
+// count-leading-zeroes in the renormalization and the variable shifts) is generated
+// for the respective instruction set, while the out-of-line copies of the engine
+// templates remain generic.
+#if defined( __GNUC__ ) && ( defined( __x86_64__ ) || defined( __i386__ ) )
+# define CABAC_KERNELS_X86 1
+# define CABAC_TARGET( isa ) __attribute__(( target( isa ) ))
+# include <immintrin.h>
+#endif
+
+namespace cabac {
+
+namespace {
+
+template< class E >
+inline void encode_decisions_loop( E &e, const uint32_t *idx, const uint8_t *bins, const ::std::size_t num ) {
+  for ( ::std::size_t i = 0; i < num; ++i ) {
+    if ( idx[ i ] == kernel_bypass )
+      e.encode_bypass( bins[ i ] );
+    else
+      e.encode( idx[ i ], bins[ i ] );
+  }
+}
+
+template< class D >
+inline void decode_decisions_loop( D &d, const uint32_t *idx, uint8_t *bins, const ::std::size_t num ) {
+  for ( ::std::size_t i = 0; i < num; ++i ) {
+    if ( idx[ i ] == kernel_bypass )
+      bins[ i ] = d.decode_bypass();
+    else
+      bins[ i ] = d.decode( idx[ i ] );
+  }
+}
+
+template< class D >
+inline void decode_ueg_loop( D &d, const unsigned int k, const state_vector::size_type idx, const unsigned int num_ctx,
+    unsigned int *values, const ::std::size_t num ) {
+  for ( ::std::size_t i = 0; i < num; ++i )
+    values[ i ] = decode_ueg( d, k, idx, num_ctx );
+}
+
+template< class D >
+inline void decode_seg_loop( D &d, const unsigned int k, const state_vector::size_type idx, const unsigned int num_ctx,
+    signed int *values, const ::std::size_t num ) {
+  for ( ::std::size_t i = 0; i < num; ++i )
+    values[ i ] = decode_seg( d, k, idx, num_ctx );
+}
+
+// scalar batch kernels, one message after the other
+template< class E >
+inline void encode_batch_loop( const state_vector &states, const batch_encode_message *messages, const ::std::size_t num,
+    kernel_bitstream *bitstreams ) {
+  for ( ::std::size_t i = 0; i < num; ++i ) {
+    E e( ::std::back_insert_iterator< kernel_bitstream >( bitstreams[ i ] ), states );
+    encode_decisions_loop( e, messages[ i ].idx, messages[ i ].bins, messages[ i ].num );
+  }
+}
+
+template< class D >
+inline void decode_batch_loop( const state_vector &states, const batch_decode_message *messages, const ::std::size_t num ) {
+  for ( ::std::size_t i = 0; i < num; ++i ) {
+    D d( messages[ i ].data, states );
+    decode_decisions_loop( d, messages[ i ].idx, messages[ i ].bins, messages[ i ].num );
+  }
+}
+
+}
+
+#ifdef CABAC_KERNELS_X86
+
+#pragma GCC push_options
+#pragma GCC target( "lzcnt,bmi,bmi2,avx2" )
+namespace avx2 {
+namespace {
+# define CABAC_BATCH_LANES 8
+# include "batch-lanes.h"
+# undef CABAC_BATCH_LANES
+}
+}
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target( "lzcnt,bmi,bmi2,avx2,avx512f" )
+namespace avx512 {
+namespace {
+# define CABAC_BATCH_LANES 16
+# include "batch-lanes.h"
+# undef CABAC_BATCH_LANES
+}
+}
+#pragma GCC pop_options
+
+#endif
+
+namespace {
+
+#define CABAC_DEFINE_KERNELS( variant, attr, lanes, batch ) \
+  attr void encode_decisions_##variant( kernel_encoder &e, const uint32_t *idx, const uint8_t *bins, ::std::size_t num ) { \
+    encode_decisions_loop( e, idx, bins, num ); \
+  } \
+  attr void decode_decisions_##variant( kernel_decoder &d, const uint32_t *idx, uint8_t *bins, ::std::size_t num ) { \
+    decode_decisions_loop( d, idx, bins, num ); \
+  } \
+  attr void decode_ueg_##variant( kernel_decoder &d, unsigned int k, state_vector::size_type idx, unsigned int num_ctx, \
+      unsigned int *values, ::std::size_t num ) { \
+    decode_ueg_loop( d, k, idx, num_ctx, values, num ); \
+  } \
+  attr void decode_seg_##variant( kernel_decoder &d, unsigned int k, state_vector::size_type idx, unsigned int num_ctx, \
+      signed int *values, ::std::size_t num ) { \
+    decode_seg_loop( d, k, idx, num_ctx, values, num ); \
+  } \
+  attr void encode_batch_##variant( const state_vector &states, const batch_encode_message *messages, ::std::size_t num, \
+      kernel_bitstream *bitstreams ) { \
+    batch::encode_batch( states, messages, num, bitstreams ); \
+  } \
+  attr void decode_batch_##variant( const state_vector &states, const batch_decode_message *messages, ::std::size_t num ) { \
+    batch::decode_batch( states, messages, num ); \
+  } \
+  const kernel_table kernels_##variant = { \
+    #variant, \
+    lanes, \
+    encode_decisions_##variant, \
+    decode_decisions_##variant, \
+    decode_ueg_##variant, \
+    decode_seg_##variant, \
+    encode_batch_##variant, \
+    decode_batch_##variant, \
+  };
+
+// the scalar batch kernels, in a form matching the SIMD ones
+namespace scalar {
+inline void encode_batch( const state_vector &states, const batch_encode_message *messages, ::std::size_t num,
+    kernel_bitstream *bitstreams ) {
+  encode_batch_loop< kernel_encoder >( states, messages, num, bitstreams );
+}
+inline void decode_batch( const state_vector &states, const batch_decode_message *messages, ::std::size_t num ) {
+  decode_batch_loop< kernel_decoder >( states, messages, num );
+}
+}
+
+CABAC_DEFINE_KERNELS( generic, , 1, scalar )
+#ifdef CABAC_KERNELS_X86
+CABAC_DEFINE_KERNELS( lzcnt, CABAC_TARGET( "lzcnt" ), 1, scalar )
+CABAC_DEFINE_KERNELS( bmi2, CABAC_TARGET( "lzcnt,bmi,bmi2" ), 1, scalar )
+CABAC_DEFINE_KERNELS( avx2, CABAC_TARGET( "lzcnt,bmi,bmi2,avx2" ), avx2::lanes, avx2 )
+CABAC_DEFINE_KERNELS( avx512, CABAC_TARGET( "lzcnt,bmi,bmi2,avx2,avx512f" ), avx512::lanes, avx512 )
+#endif
+
+bool supported( const kernel_table &k ) {
+  if ( &k == &kernels_generic )
+    return true;
+#ifdef CABAC_KERNELS_X86
+  __builtin_cpu_init();
+  if ( &k == &kernels_lzcnt )
+    return __builtin_cpu_supports( "abm" );
+  const bool bmi2 = __builtin_cpu_supports( "abm" ) && __builtin_cpu_supports( "bmi" ) && __builtin_cpu_supports( "bmi2" );
+  if ( &k == &kernels_bmi2 )
+    return bmi2;
+  if ( &k == &kernels_avx2 )
+    return bmi2 && __builtin_cpu_supports( "avx2" );
+  if ( &k == &kernels_avx512 )
+    return bmi2 && __builtin_cpu_supports( "avx2" ) && __builtin_cpu_supports( "avx512f" );
+#endif
+  return false;
+}
+
+// all variants, fastest first
+const kernel_table * const variants[] = {
+#ifdef CABAC_KERNELS_X86
+  &kernels_avx512,
+  &kernels_avx2,
+  &kernels_bmi2,
+  &kernels_lzcnt,
+#endif
+  &kernels_generic,
+};
+
+const kernel_table& select_kernels() {
+  const char *name = ::std::getenv( "CABAC_KERNELS" );
+  if ( name ) {
+    const kernel_table *k = find_kernels( name );
+    if ( k )
+      return *k;
+  }
+  for ( unsigned int i = 0; i < sizeof( variants ) / sizeof( *variants ); ++i )
+    if ( supported( *variants[ i ] ) )
+      return *variants[ i ];
+  return kernels_generic;
+}
+
+}
+
+const kernel_table& kernels() {
+  static const kernel_table &k = select_kernels();
+  return k;
+}
+
+const kernel_table* find_kernels( const char *name ) {
+  for ( unsigned int i = 0; i < sizeof( variants ) / sizeof( *variants ); ++i )
+    if ( !::std::strcmp( variants[ i ]->name, name ) && supported( *variants[ i ] ) )
+      return variants[ i ];
+  return 0;
+}
+
+}
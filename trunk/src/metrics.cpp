@@ -0,0 +1,61 @@
+//
+// This file is part of libcabac.
+//
+// Copyright 2008 Johannes Ballé <balle@ient.rwth-aachen.de>
+//
+// libcabac is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libcabac is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libcabac.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <cabac/metrics.h>
+
+namespace cabac {
+
+namespace {
+
+// the counters of engine_metrics, in the order in which they are stored in a metrics_sink
+uint64_t engine_metrics::* const fields[] = {
+  &engine_metrics::decisions,
+  &engine_metrics::bypass_bins,
+  &engine_metrics::terminal_bins,
+  &engine_metrics::renorms,
+  &engine_metrics::renorm_shifts,
+  &engine_metrics::bytes,
+  &engine_metrics::outstanding_runs,
+  &engine_metrics::max_outstanding,
+  &engine_metrics::periods,
+  &engine_metrics::period_ns,
+  &engine_metrics::max_period_ns,
+};
+
+}
+
+metrics_sink::metrics_sink() {
+  static_assert( sizeof( fields ) / sizeof( *fields ) == num_counters, "counter list incomplete" );
+  for ( unsigned int i = 0; i < num_counters; ++i )
+    _counters[ i ].store( 0, ::std::memory_order_relaxed );
+}
+
+void metrics_sink::publish( const engine_metrics &m ) {
+  for ( unsigned int i = 0; i < num_counters; ++i )
+    _counters[ i ].store( m.*fields[ i ], ::std::memory_order_relaxed );
+}
+
+engine_metrics metrics_sink::snapshot() const {
+  engine_metrics m;
+  for ( unsigned int i = 0; i < num_counters; ++i )
+    m.*fields[ i ] = _counters[ i ].load( ::std::memory_order_relaxed );
+  return m;
+}
+
+}
@@ -0,0 +1,41 @@
+//
+// This file is part of libcabac.
+//
+// Copyright 2008 Johannes Ballé <balle@ient.rwth-aachen.de>
+//
+// libcabac is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libcabac is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libcabac.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include <cabac/model.h>
+#include <ostream>
+
+namespace cabac {
+
+void write_model_header( ::std::ostream &os, const model_plan &plan, const ::std::string &name ) {
+  static const char *const strategies[] = { "strategy_adaptive", "strategy_bypass", "strategy_static" };
+  const ::std::string guard = "_CABAC_MODEL_" + name + "_H";
+  os << "// generated by cabac::write_model_header() from measured context frequencies, do not edit\n\n"
+    << "#ifndef " << guard << "\n#define " << guard << " 1\n\n#include <cabac/model.h>\n\n"
+    << "struct " << name << " {\n"
+    << "  enum { size = " << plan.size() << " };\n"
+    << "  template< unsigned int idx > struct context;\n"
+    << "};\n\n";
+  for ( model_plan::size_type i = 0; i < plan.size(); ++i )
+    os << "template<> struct " << name << "::context< " << i << " > : cabac::context_model< cabac::"
+      << strategies[ plan[ i ].strategy ] << ", " << static_cast< unsigned int >( plan[ i ].state ) << " > {};\n";
+  os << "\n#endif\n";
+}
+
+}
@@ -0,0 +1,113 @@
+//
+// This file is part of libcabac.
+//
+// Copyright 2008 Johannes Ballé <balle@ient.rwth-aachen.de>
+//
+// libcabac is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libcabac is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libcabac.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <cabac/seek.h>
+#include "binary-io.h"
+
+namespace cabac {
+
+namespace {
+
+const char index_magic[ 8 ] = { 'C', 'A', 'B', 'A', 'C', 'S', 'I', '1' };
+
+}
+
+void write_seek_index( ::std::ostream &os, const seek_index &index ) {
+  os.write( index_magic, sizeof( index_magic ) );
+  impl::put( os, index._interval, 8 );
+  impl::put( os, index._key_interval, 4 );
+  impl::put( os, index._entries.size(), 8 );
+  for ( ::std::size_t i = 0; i < index._entries.size(); ++i ) {
+    const seek_index::entry &e = index._entries[ i ];
+    impl::put( os, e.position, 8 );
+    impl::put( os, e.bit, 8 );
+    impl::put( os, e.range, 2 );
+    impl::put( os, e.low, 2 );
+    impl::put( os, e.changes, 4 );
+    impl::put( os, e.offset, 8 );
+  }
+  impl::put( os, index._data.size(), 8 );
+  os.write( reinterpret_cast< const char* >( index._data.data() ), index._data.size() );
+}
+
+bool read_seek_index( ::std::istream &is, seek_index &index ) {
+  char magic[ sizeof( index_magic ) ];
+  if ( !is.read( magic, sizeof( magic ) ) ||
+      !::std::equal( magic, magic + sizeof( magic ), index_magic ) )
+    return false;
+  uint64_t interval, key_interval, size;
+  if ( !impl::get( is, interval, 8 ) || !impl::get( is, key_interval, 4 ) || !key_interval ||
+      !impl::get( is, size, 8 ) )
+    return false;
+  seek_index result( interval, static_cast< unsigned int >( key_interval ) );
+  for ( uint64_t i = 0; i < size; ++i ) {
+    uint64_t position, bit, range, low, changes, offset;
+    if ( !impl::get( is, position, 8 ) || !impl::get( is, bit, 8 ) || !impl::get( is, range, 2 ) ||
+        !impl::get( is, low, 2 ) || !impl::get( is, changes, 4 ) || !impl::get( is, offset, 8 ) )
+      return false;
+    const seek_index::entry e = { position, bit, static_cast< uint16_t >( range ), static_cast< uint16_t >( low ),
+      static_cast< uint32_t >( changes ), offset };
+    result._entries.push_back( e );
+  }
+  if ( !impl::get( is, size, 8 ) )
+    return false;
+  if ( !impl::get( is, result._data, size ) )
+    return false;
+  // check every entry, so that get() never reads or writes out of bounds
+  const uint8_t *const data = result._data.data();
+  const uint64_t num_states = result._entries.empty() ? 0 : result._entries[ 0 ].changes;
+  for ( ::std::size_t i = 0; i < result._entries.size(); ++i ) {
+    const seek_index::entry &e = result._entries[ i ];
+    if ( e.offset > size || e.range < 0x100 || e.range >= 0x200 || e.low >= 0x200 )
+      return false;
+    if ( i % result._key_interval == 0 ) {
+      if ( e.changes != num_states || e.changes > size - e.offset )
+        return false;
+      for ( uint64_t j = 0; j < e.changes; ++j )
+        if ( data[ e.offset + j ] >= 128 )
+          return false;
+      continue;
+    }
+    const uint8_t *p = data + e.offset, *const end = data + size;
+    uint64_t idx = 0;
+    for ( uint32_t c = 0; c < e.changes; ++c ) {
+      uint64_t d = 0;
+      for ( unsigned int s = 0; ; s += 7 ) {
+        if ( s >= 64 || p == end )
+          return false;
+        d |= static_cast< uint64_t >( *p & 0x7f ) << s;
+        if ( !( *p++ & 0x80 ) )
+          break;
+      }
+      if ( d >= num_states - idx || p == end || *p++ >= 128 )
+        return false;
+      idx += d;
+    }
+  }
+  // the states of the last entry are needed to continue the index
+  if ( !result._entries.empty() ) {
+    resync_point point;
+    result.get( result._entries.size() - 1, point );
+    result._last.swap( point.states );
+  }
+  index = result;
+  return true;
+}
+
+}
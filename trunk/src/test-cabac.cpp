@@ -21,10 +21,15 @@
 #include <iterator>
 #include <algorithm>
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
 #include <iomanip>
 #include <cstdlib>
 #include <ctime>
 #include <cmath>
+#include <thread>
+#include <atomic>
 #include <cabac.h>
 
 using namespace std;
@@ -41,10 +46,90 @@ struct rand_gen {
   }
 };
 
+// packet unit: a group of signed integers
+struct seg_unit {
+  const signed int *values;
+  unsigned int num;
+  seg_unit( const signed int *v, unsigned int n ) :
+    values( v ), num( n ) {
+  }
+  void operator()( packet_encoder::encoder_type &e ) const {
+    for ( unsigned int i = 0; i < num; ++i )
+      encode_seg( e, values[ i ], 2, 0, 20 );
+  }
+};
+
+// decodes consecutive seg_units
+struct seg_sink {
+  signed int *pos, *end;
+  unsigned int num;
+  seg_sink( signed int *p, signed int *e, unsigned int n ) :
+    pos( p ), end( e ), num( n ) {
+  }
+  void operator()( decoder< packet::const_iterator > &d ) {
+    for ( unsigned int i = 0; i < num && pos < end; ++i )
+      *pos++ = decode_seg( d, 2, 0, 20 );
+  }
+};
+
+// position of a decoder in bits after the initial 9 bits, i.e. one bit per bypass bin and renormalization shift
+struct bit_counter : public null_observer {
+  uint64_t *bits;
+  explicit bit_counter( uint64_t *b ) :
+    bits( b ) {
+  }
+  void bypass( const unsigned int, const unsigned int, const bool ) {
+    ++*bits;
+  }
+  void renorm( const unsigned int shifts ) {
+    *bits += shifts;
+  }
+};
+
+// binarization trees, with the contexts numbered from the first context of each tree
+typedef truncated_unary< 5, 0, 3 > tu_tree;
+typedef fixed_length< 4 > fl_tree;
+typedef fixed_length< 3, 0, true > fl_node_tree;
+typedef decision< 0, symbol< 2 >, decision< bypass_context, symbol< 0 >, decision< 1, symbol< 1 >, symbol< 3 > > > > prefix_tree;
+typedef fixed_length< 8 > wide_fl_tree;
+// neither separable by a comparison nor small enough for a bit mask
+typedef decision< bypass_context, decision< bypass_context, symbol< 100 >, symbol< 300 > >, symbol< 200 > > sparse_tree;
+
+// the context of a pixel of a bilevel image, gathered pixel by pixel
+static unsigned int bilevel_context( const vector< uint8_t > &image, const size_t stride, const unsigned int width,
+    const unsigned int y, const unsigned int x, const bilevel_template &t ) {
+  struct {
+    const vector< uint8_t > &image;
+    size_t stride;
+    unsigned int width;
+    unsigned int operator()( const int y, const int x ) const {
+      return y < 0 || x < 0 || x >= static_cast< int >( width ) ? 0 : ( image[ y * stride + ( x >> 3 ) ] >> ( 7 - ( x & 7 ) ) ) & 1;
+    }
+  } pixel = { image, stride, width };
+  unsigned int ctx = 0;
+  for ( int dx = t.row2_left; dx <= t.row2_right; ++dx )
+    ctx = ( ctx << 1 ) | pixel( y - 2, x + dx );
+  for ( int dx = t.row1_left; dx <= t.row1_right; ++dx )
+    ctx = ( ctx << 1 ) | pixel( y - 1, x + dx );
+  for ( int dx = t.row0_left; dx < 0; ++dx )
+    ctx = ( ctx << 1 ) | pixel( y, x + dx );
+  return ctx;
+}
+
+// a compiled model, as written by write_model_header()
+struct test_model {
+  enum { size = 3 };
+  template< unsigned int idx > struct context;
+};
+
+template<> struct test_model::context< 0 > : cabac::context_model< cabac::strategy_bypass, 0 > {};
+template<> struct test_model::context< 1 > : cabac::context_model< cabac::strategy_static, 124 > {};
+template<> struct test_model::context< 2 > : cabac::context_model< cabac::strategy_adaptive, 36 > {};
+
 int main( int argc, char *argv[] ) {
 
-  if ( argc != 3 ) {
-    cout << "syntax: " << argv[ 0 ] << " #states #decisions" << endl;
+  if ( argc != 3 && argc != 4 ) {
+    cout << "syntax: " << argv[ 0 ] << " #states #decisions [trace-prefix]" << endl;
     return -1;
   }
 
@@ -67,20 +152,21 @@ int main( int argc, char *argv[] ) {
 
   frequency_vector freq_enc;
 
+  // bins are traced if a file name prefix for the dumps is given
+  typedef observer_pair< trace_recorder, metrics_observer > observer_type;
+  trace_buffer enc_trace( 2 * num_decisions ), dec_trace( 2 * num_decisions );
+  const bool trace = argc == 4;
+  metrics_sink enc_metrics;
+
   {
-    counting_encoder< back_insert_iterator< vector< uint8_t > > >
-      e( back_insert_iterator< vector< uint8_t > >( buffer ), states );
+    counting_encoder< back_insert_iterator< vector< uint8_t > >, observer_type >
+      e( back_insert_iterator< vector< uint8_t > >( buffer ), states,
+        observer_type( trace_recorder( trace ? &enc_trace : 0 ), metrics_observer( &enc_metrics, 1 ) ) );
 
-#ifdef CABAC_DEBUG_OUTPUT
-    cout << "ENCODING:" << endl;
-#else
     cout << ::std::setw( ( int ) ceil( log10( num_decisions ) ) ) << right;
-#endif
 
     for ( int i = 0; i < num_decisions; ++i ) {
-#ifndef CABAC_DEBUG_OUTPUT
       cout << "\rencoding decisions: " << i + 1 << flush;
-#endif
       if ( indexes[ i ] == 0 )
         e.encode_bypass( decisions[ i ] );
       else
@@ -88,9 +174,7 @@ int main( int argc, char *argv[] ) {
     }
     cout << endl;
     for ( int i = 0; i < num_decisions; ++i ) {
-#ifndef CABAC_DEBUG_OUTPUT
       cout << "\rencoding integers: " << i + 1 << flush;
-#endif
       encode_seg( e, ints[ i ], 2, 0, 20 );
     }
     cout << endl;
@@ -98,26 +182,15 @@ int main( int argc, char *argv[] ) {
     freq_enc = e.frequencies();
   }
 
-#ifdef CABAC_DEBUG_OUTPUT
-  cout << "BITSTREAM:" << endl;
-  for ( unsigned int i = 0; i < buffer.size(); ++i ) {
-    cout << bitset< 8 >( buffer[ i ] ).to_string() << " ";
-  }
-  cout << endl << endl;
-  cout << "DECODING:" << endl;
-#endif
-
-  counting_decoder< vector< uint8_t >::const_iterator >
-    d( buffer.begin(), states );
+  counting_decoder< vector< uint8_t >::const_iterator, observer_type >
+    d( buffer.begin(), states, observer_type( trace_recorder( trace ? &dec_trace : 0 ) ) );
 
   bool b;
   int x;
   unsigned int errors = 0;
 
   for ( int i = 0; i < num_decisions; ++i ) {
-#ifndef CABAC_DEBUG_OUTPUT
     cout << "\rdecoding decisions: " << i + 1 << flush;
-#endif
     if ( indexes[ i ] == 0 )
       b = d.decode_bypass();
     else
@@ -127,9 +200,7 @@ int main( int argc, char *argv[] ) {
   }
   cout << endl;
   for ( int i = 0; i < num_decisions; ++i ) {
-#ifndef CABAC_DEBUG_OUTPUT
     cout << "\rdecoding integers: " << i + 1 << flush;
-#endif
     x = decode_seg( d, 2, 0, 20 );
     if ( x != ints[ i ] )
       ++errors;
@@ -138,6 +209,1074 @@ int main( int argc, char *argv[] ) {
 
   cout << errors << " decoder mismatch(es)." << endl;
 
+  const engine_metrics em = enc_metrics.snapshot();
+  const engine_metrics &dm = d.observer().second.metrics();
+  cout << "encoder: " << em.decisions << " decisions, " << em.bypass_bins << " bypass bins, "
+    << em.renorm_shifts << " renormalization shifts, " << em.bytes << " bytes, longest outstanding run "
+    << em.max_outstanding << "." << endl;
+  if ( em.decisions != dm.decisions || em.bypass_bins != dm.bypass_bins || em.bytes != buffer.size() ) {
+    cout << "Encoder and decoder metrics do not match." << endl;
+    ++errors;
+  }
+
+  if ( trace ) {
+    vector< trace_record > records;
+    uint64_t first = enc_trace.snapshot( records );
+    ofstream enc_os( ( string( argv[ 3 ] ) + "-enc.trace" ).c_str(), ios::binary );
+    write_trace( enc_os, first, records );
+    first = dec_trace.snapshot( records );
+    ofstream dec_os( ( string( argv[ 3 ] ) + "-dec.trace" ).c_str(), ios::binary );
+    write_trace( dec_os, first, records );
+  }
+
+  {
+    // snapshots taken while another thread appends must be contiguous and intact
+    trace_buffer ring( 256 );
+    const uint32_t num_records = 200000;
+    atomic< bool > done( false );
+    thread writer( [&]() {
+      trace_record r = trace_record();
+      for ( uint32_t i = 0; i < num_records; ++i ) {
+        if ( i == num_records / 2 )
+          ring.clear();
+        r.position = i;
+        r.idx = ~i;
+        ring.append( r );
+      }
+      done = true;
+    } );
+    unsigned int ring_errors = 0, snapshots = 0;
+    vector< trace_record > records;
+    do {
+      const uint64_t first = ring.snapshot( records );
+      for ( size_t i = 0; i < records.size(); ++i )
+        if ( records[ i ].idx != ~records[ i ].position || records[ i ].position != records[ 0 ].position + i )
+          ++ring_errors;
+      // sequence numbers restart at the clear
+      if ( !records.empty() && first != records[ 0 ].position && first + num_records / 2 != records[ 0 ].position )
+        ++ring_errors;
+      ++snapshots;
+    } while ( !done );
+    writer.join();
+    const uint64_t first = ring.snapshot( records );
+    if ( ring.total() != num_records / 2 || first != num_records / 2 - ring.capacity() || records.size() != ring.capacity()
+        || records.back().position != num_records - 1 )
+      ++ring_errors;
+    cout << "trace buffer, " << snapshots << " concurrent snapshot(s): " << ring_errors << " mismatch(es)." << endl;
+    errors += ring_errors;
+  }
+
+  for ( unsigned int max_outstanding = 0; max_outstanding <= 16; max_outstanding += 4 ) {
+    vector< uint8_t > bounded_buffer;
+    uint64_t latency, forced;
+    {
+      bounded_encoder< back_insert_iterator< vector< uint8_t > > >
+        e( back_insert_iterator< vector< uint8_t > >( bounded_buffer ), states, max_outstanding );
+      for ( int i = 0; i < num_decisions; ++i ) {
+        if ( indexes[ i ] == 0 )
+          e.encode_bypass( decisions[ i ] );
+        else
+          e.encode( indexes[ i ] - 1, decisions[ i ] );
+      }
+      for ( int i = 0; i < num_decisions; ++i )
+        encode_seg( e, ints[ i ], 2, 0, 20 );
+      encode_seg_array( e, &ints[ 0 ], num_decisions, 2 );
+      e.encode_terminal( 1 );
+      latency = e.max_latency();
+      forced = e.forced_resolutions();
+    }
+    bounded_decoder< vector< uint8_t >::const_iterator > bd( bounded_buffer.begin(), states, max_outstanding );
+    unsigned int bounded_errors = 0;
+    for ( int i = 0; i < num_decisions; ++i ) {
+      if ( indexes[ i ] == 0 )
+        b = bd.decode_bypass();
+      else
+        b = bd.decode( indexes[ i ] - 1 );
+      if ( b != decisions[ i ] )
+        ++bounded_errors;
+    }
+    for ( int i = 0; i < num_decisions; ++i ) {
+      if ( decode_seg( bd, 2, 0, 20 ) != ints[ i ] )
+        ++bounded_errors;
+    }
+    vector< int > bounded_ints( num_decisions );
+    decode_seg_array( bd, &bounded_ints[ 0 ], num_decisions, 2 );
+    if ( bounded_ints != ints || !bd.decode_terminal() )
+      ++bounded_errors;
+    cout << "bounded, max. " << max_outstanding << " outstanding bits: " << bounded_errors << " decoder mismatch(es), "
+      << bounded_buffer.size() << " bytes, " << forced << " forced resolutions, max. latency " << latency << " bins." << endl;
+    errors += bounded_errors;
+  }
+
+  {
+    // the wide engine codes the same bins with the same states, compare its size with the standard engine
+    vector< uint8_t > wide_buffer, skewed_buffer, wide_skewed_buffer;
+    unsigned int wide_tell_errors = 0;
+    vector< unsigned int > uvalues( num_decisions );
+    for ( int i = 0; i < num_decisions; ++i )
+      uvalues[ i ] = static_cast< unsigned int >( rand() ) & 0x1ffff;
+    {
+      wide_encoder< back_insert_iterator< vector< uint8_t > > >
+        e( back_insert_iterator< vector< uint8_t > >( wide_buffer ), states );
+      for ( int i = 0; i < num_decisions; ++i ) {
+        if ( indexes[ i ] == 0 )
+          e.encode_bypass( decisions[ i ] );
+        else
+          e.encode( indexes[ i ] - 1, decisions[ i ] );
+      }
+      for ( int i = 0; i < num_decisions; ++i )
+        encode_seg( e, ints[ i ], 2, 0, 20 );
+      encode_uf_array( e, &uvalues[ 0 ], num_decisions, 17 );
+      // static contexts and runs, the bit count never decreases and the byte count follows the output
+      uint64_t last = e.tell_bits();
+      for ( int i = 0; i < num_decisions; ++i ) {
+        encode_context< test_model, 1 >( e, decisions[ i ] );
+        e.encode_run( 0, i % 5, decisions[ i ] );
+        wide_tell_errors += e.tell_bits() < last || e.bytes() != wide_buffer.size();
+        last = e.tell_bits();
+      }
+      e.encode_terminal( 1 );
+    }
+    wide_decoder< vector< uint8_t >::const_iterator > wd( wide_buffer.begin(), states );
+    unsigned int wide_errors = wide_tell_errors;
+    for ( int i = 0; i < num_decisions; ++i ) {
+      if ( indexes[ i ] == 0 )
+        b = wd.decode_bypass();
+      else
+        b = wd.decode( indexes[ i ] - 1 );
+      if ( b != decisions[ i ] )
+        ++wide_errors;
+    }
+    for ( int i = 0; i < num_decisions; ++i )
+      if ( decode_seg( wd, 2, 0, 20 ) != ints[ i ] )
+        ++wide_errors;
+    vector< unsigned int > decoded_uvalues( num_decisions );
+    decode_uf_array( wd, &decoded_uvalues[ 0 ], num_decisions, 17 );
+    if ( decoded_uvalues != uvalues )
+      ++wide_errors;
+    for ( int i = 0; i < num_decisions; ++i ) {
+      wide_errors += decode_context< test_model, 1 >( wd ) != decisions[ i ];
+      wide_errors += wd.decode_mps_run( 0, i % 5 + decisions[ i ] ) != static_cast< uint64_t >( i % 5 );
+    }
+    if ( !wd.decode_terminal() )
+      ++wide_errors;
+    // a highly skewed source, where the quantization of the standard engine costs most; the length is
+    // fixed, so that the gain is well above the three bytes the wide engine spends more on termination
+    const state_vector skewed_states( 1, 0 );
+    const unsigned int skewed_bins = 1 << 21;
+    {
+      encoder< back_insert_iterator< vector< uint8_t > > >
+        e( back_insert_iterator< vector< uint8_t > >( skewed_buffer ), skewed_states );
+      wide_encoder< back_insert_iterator< vector< uint8_t > > >
+        we( back_insert_iterator< vector< uint8_t > >( wide_skewed_buffer ), skewed_states );
+      for ( unsigned int i = 0; i < skewed_bins; ++i ) {
+        const bool bin = rand() % 200 == 0;
+        e.encode( 0, bin );
+        we.encode( 0, bin );
+      }
+    }
+    // the unquantized LPS range of the wide engine must pay off on the skewed source
+    if ( wide_skewed_buffer.size() > skewed_buffer.size() )
+      ++wide_errors;
+    cout << "wide engine: " << wide_errors << " decoder mismatch(es), " << wide_buffer.size() << " bytes, skewed source "
+      << wide_skewed_buffer.size() << " bytes (standard engine " << skewed_buffer.size() << " bytes)." << endl;
+    errors += wide_errors;
+  }
+
+  {
+    // encoding through a raw pointer into memory sized by the bound gives the same bitstream
+    vector< uint8_t > raw_buffer( max_encoded_bytes( em.decisions, em.bypass_bins ) );
+    encoder< void > simulation( states );
+    uint64_t size, told;
+    unsigned int tell_errors = 0;
+    {
+      encoder< uint8_t* > e( &raw_buffer[ 0 ], states );
+      // the bit count never decreases and grows by exactly one bit per bypass bin
+      uint64_t last = e.tell_bits();
+      for ( int i = 0; i < num_decisions; ++i ) {
+        if ( indexes[ i ] == 0 ) {
+          e.encode_bypass( decisions[ i ] );
+          simulation.encode_bypass( decisions[ i ] );
+          tell_errors += e.tell_bits() != last + 256;
+        } else {
+          e.encode( indexes[ i ] - 1, decisions[ i ] );
+          simulation.encode( indexes[ i ] - 1, decisions[ i ] );
+          tell_errors += e.tell_bits() < last;
+        }
+        last = e.tell_bits();
+      }
+      for ( int i = 0; i < num_decisions; ++i ) {
+        encode_seg( e, ints[ i ], 2, 0, 20 );
+        encode_seg( simulation, ints[ i ], 2, 0, 20 );
+        tell_errors += e.tell_bits() < last;
+        last = e.tell_bits();
+      }
+      size = e.terminated_size();
+      told = e.tell_bits();
+    }
+    // terminating adds more than the 8 bits of the terminal bin and at most 17 bits including the padding
+    tell_errors += size * 8 * 256 <= told + 8 * 256 || size * 8 * 256 > told + 17 * 256;
+    // after the terminal bin, the count is exact up to the zero bits padding the last byte
+    for ( int n = 0; n < min( num_decisions, 500 ); n += 7 ) {
+      vector< uint8_t > terminated;
+      uint64_t before, after;
+      {
+        encoder< back_insert_iterator< vector< uint8_t > > > e( back_insert_iterator< vector< uint8_t > >( terminated ), states );
+        for ( int i = 0; i < n; ++i ) {
+          if ( indexes[ i ] == 0 )
+            e.encode_bypass( decisions[ i ] );
+          else
+            e.encode( indexes[ i ] - 1, decisions[ i ] );
+        }
+        before = e.tell_bits();
+        e.encode_terminal( 1 );
+        after = e.tell_bits();
+        tell_errors += e.terminated_size() * 8 * 256 <= after;
+      }
+      unsigned int padding = 0;
+      while ( padding < 8 && !( ( terminated.back() >> padding ) & 1 ) )
+        ++padding;
+      tell_errors += after < before || after != ( terminated.size() * 8 - padding ) * 256;
+    }
+    unsigned int size_errors = size != buffer.size() || !equal( buffer.begin(), buffer.end(), raw_buffer.begin() );
+    size_errors += tell_errors;
+    // coding the LPS whenever the state is most skewed comes close to the worst case
+    const state_vector skewed_states( 1, 0 );
+    const unsigned int skewed_bins = 16 * num_decisions;
+    vector< uint8_t > skewed_buffer;
+    {
+      encoder< back_insert_iterator< vector< uint8_t > > >
+        e( back_insert_iterator< vector< uint8_t > >( skewed_buffer ), skewed_states );
+      for ( unsigned int i = 0; i < skewed_bins; ++i ) {
+        const unsigned int state = e.states()[ 0 ];
+        e.encode( 0, ( state & 1 ) ^ ( state >> 1 >= 62 ) );
+      }
+    }
+    if ( skewed_buffer.size() > max_encoded_bytes( skewed_bins ) )
+      ++size_errors;
+    // the LPS of state 126 always costs 7 bits, the raw buffer sized by the bound must not overflow
+    for ( unsigned int n = 1; n <= 1000; n = n * 3 + 1 ) {
+      vector< uint8_t > lps_buffer( max_encoded_bytes( n ) + 16, 0xa5 );
+      uint64_t lps_size;
+      {
+        encoder< uint8_t* > e( &lps_buffer[ 0 ], state_vector( 1, 126 ) );
+        for ( unsigned int i = 0; i < n; ++i )
+          e.encode( 0, !( e.states()[ 0 ] & 1 ) );
+        lps_size = e.terminated_size();
+      }
+      size_errors += lps_size > max_encoded_bytes( n ) ||
+        count( lps_buffer.begin() + max_encoded_bytes( n ), lps_buffer.end(), 0xa5 ) != 16;
+    }
+    cout << "output size: " << size_errors << " mismatch(es), " << size << " bytes, predicted "
+      << simulation.predicted_bytes() << ", bound " << raw_buffer.size() << "; worst case " << skewed_buffer.size()
+      << " bytes, bound " << max_encoded_bytes( skewed_bins ) << "; " << told / 256. << " bits told, "
+      << simulation.bits() / 256. << " estimated, " << tell_errors << " mismatch(es)." << endl;
+    errors += size_errors;
+  }
+
+  {
+    // flags which are nearly always the MPS, coded as runs and bin by bin, with runs split at random lengths
+    const state_vector run_states( 2, 80 );
+    const unsigned int num_flags = 50 * num_decisions;
+    vector< uint8_t > flags( num_flags );
+    for ( unsigned int i = 0; i < num_flags; ++i )
+      flags[ i ] = rand() % 100 == 0;
+    vector< uint8_t > run_buffer, bin_buffer;
+    {
+      encoder< back_insert_iterator< vector< uint8_t > > >
+        e( back_insert_iterator< vector< uint8_t > >( run_buffer ), run_states );
+      for ( unsigned int i = 0; i < num_flags; ) {
+        unsigned int n = 0;
+        while ( i + n < num_flags && !flags[ i + n ] )
+          ++n;
+        e.encode_run( i & 1, n, i + n < num_flags );
+        i += n + 1;
+      }
+    }
+    {
+      encoder< back_insert_iterator< vector< uint8_t > > >
+        e( back_insert_iterator< vector< uint8_t > >( bin_buffer ), run_states );
+      for ( unsigned int i = 0; i < num_flags; ) {
+        unsigned int n = 0;
+        while ( i + n < num_flags && !flags[ i + n ] )
+          ++n;
+        for ( unsigned int j = 0; j < n; ++j )
+          e.encode( i & 1, e.states()[ i & 1 ] & 1 );
+        if ( i + n < num_flags )
+          e.encode( i & 1, !( e.states()[ i & 1 ] & 1 ) );
+        i += n + 1;
+      }
+    }
+    unsigned int run_errors = run_buffer != bin_buffer;
+    decoder< const uint8_t* > rd( &run_buffer[ 0 ], run_states );
+    for ( unsigned int i = 0; i < num_flags; ) {
+      unsigned int n = 0;
+      while ( i + n < num_flags && !flags[ i + n ] )
+        ++n;
+      // decode the run in chunks of random length
+      uint64_t decoded = 0;
+      bool lps = false;
+      while ( decoded < n && !lps ) {
+        uint64_t max_n = 1 + rand() % 64;
+        if ( i + n == num_flags )
+          max_n = min< uint64_t >( max_n, n - decoded );
+        const uint64_t m = rd.decode_mps_run( i & 1, max_n );
+        decoded += m;
+        lps = m < max_n;
+      }
+      if ( i + n < num_flags && !lps )
+        lps = !rd.decode_mps_run( i & 1, 1 );
+      if ( decoded != n || lps != ( i + n < num_flags ) )
+        ++run_errors;
+      i += n + 1;
+    }
+    cout << "mps runs: " << run_errors << " mismatch(es), " << run_buffer.size() << " bytes." << endl;
+    errors += run_errors;
+  }
+
+  {
+    // equiprobable, nearly deterministic and skewed contexts
+    const double p[ 3 ] = { 0.5, 0.005, 0.2 };
+    const unsigned int num_bins = 30 * num_decisions;
+    vector< uint8_t > bins( num_bins );
+    for ( unsigned int i = 0; i < num_bins; ++i )
+      bins[ i ] = rand() < p[ i % 3 ] * RAND_MAX;
+    counting_encoder< void > ce( state_vector( 3, 0 ) );
+    for ( unsigned int i = 0; i < num_bins; ++i )
+      ce.encode( i % 3, bins[ i ] );
+    const model_plan plan = compile_model( ce.frequencies() );
+    unsigned int model_errors = plan[ 0 ].strategy != strategy_bypass || plan[ 1 ].strategy != strategy_static ||
+      plan[ 2 ].strategy != strategy_adaptive;
+    model_plan fixed_plan( 3 );
+    for ( unsigned int i = 0; i < 3; ++i ) {
+      fixed_plan[ i ].strategy = i == 0 ? strategy_bypass : i == 1 ? strategy_static : strategy_adaptive;
+      fixed_plan[ i ].state = i == 0 ? 0 : i == 1 ? 124 : 36;
+    }
+    ostringstream header;
+    write_model_header( header, fixed_plan, "test_model" );
+    if ( header.str().find( "template<> struct test_model::context< 1 > : "
+        "cabac::context_model< cabac::strategy_static, 124 > {};\n" ) == string::npos )
+      ++model_errors;
+    // the compiled model and the plan yield the same bitstream
+    const state_vector model_states( 3, 36 );
+    vector< uint8_t > compiled_buffer, planned_buffer;
+    {
+      encoder< back_insert_iterator< vector< uint8_t > > >
+        e( back_insert_iterator< vector< uint8_t > >( compiled_buffer ), model_states );
+      for ( unsigned int i = 0; i < num_bins; i += 3 ) {
+        encode_context< test_model, 0 >( e, bins[ i ] );
+        encode_context< test_model, 1 >( e, bins[ i + 1 ] );
+        encode_context< test_model, 2 >( e, bins[ i + 2 ] );
+      }
+    }
+    {
+      encoder< back_insert_iterator< vector< uint8_t > > >
+        e( back_insert_iterator< vector< uint8_t > >( planned_buffer ), model_states );
+      for ( unsigned int i = 0; i < num_bins; ++i )
+        encode_planned( e, fixed_plan, i % 3, bins[ i ] );
+    }
+    model_errors += compiled_buffer != planned_buffer;
+    decoder< const uint8_t* > md( &compiled_buffer[ 0 ], model_states );
+    for ( unsigned int i = 0; i < num_bins; i += 3 ) {
+      model_errors += decode_context< test_model, 0 >( md ) != bins[ i ];
+      model_errors += decode_context< test_model, 1 >( md ) != bins[ i + 1 ];
+      model_errors += decode_planned( md, fixed_plan, 2 ) != bins[ i + 2 ];
+    }
+    // observers see the static context as static_context, not as a context index
+    trace_buffer model_trace( 3 );
+    decoder< const uint8_t*, trace_recorder > td( &compiled_buffer[ 0 ], model_states, trace_recorder( &model_trace ) );
+    decode_context< test_model, 1 >( td );
+    decode_context< test_model, 2 >( td );
+    vector< trace_record > model_records;
+    model_trace.snapshot( model_records );
+    model_errors += model_records.size() != 2 || model_records[ 0 ].idx != static_cast< uint32_t >( static_context ) ||
+      model_records[ 1 ].idx != 2;
+    cout << "compiled model: " << model_errors << " mismatch(es), " << compiled_buffer.size() << " bytes." << endl;
+    errors += model_errors;
+  }
+
+  {
+    // a scan of filled shapes with noisy edges, blank and repeated rows, and garbage in the padding bits
+    const unsigned int width = 203, height = 150;
+    const size_t stride = ( width + 7 ) / 8;
+    vector< uint8_t > image( stride * height, 0 );
+    for ( unsigned int y = 0; y < height; ++y ) {
+      for ( unsigned int x = 0; x < width; ++x ) {
+        const int dx = x - 100, dy = y - 70;
+        const bool on = ( dx * dx + dy * dy < 2500 + rand() % 200 ) || ( y > 120 && y < 140 && x % 40 < 25 );
+        image[ y * stride + x / 8 ] |= on << ( 7 - x % 8 );
+      }
+      image[ y * stride + stride - 1 ] |= rand() & 0x1f;
+    }
+    // a masked copy for the reference
+    vector< uint8_t > masked( image );
+    for ( unsigned int y = 0; y < height; ++y )
+      masked[ y * stride + stride - 1 ] &= 0xe0;
+    const bilevel_template templates[] = { jbig_two_line_template(), jbig_three_line_template(), jbig2_template0() };
+    const char *names[] = { "two-line", "three-line", "jbig2 template 0" };
+    for ( unsigned int t = 0; t < 3; ++t ) {
+      bilevel_coder coder( templates[ t ], width );
+      const state_vector bilevel_states( coder.num_contexts(), 0 );
+      vector< uint8_t > bilevel_buffer, reference_buffer;
+      {
+        encoder< back_insert_iterator< vector< uint8_t > > >
+          e( back_insert_iterator< vector< uint8_t > >( bilevel_buffer ), bilevel_states );
+        for ( unsigned int y = 0; y < height; ++y )
+          coder.encode_row( e, &image[ y * stride ] );
+      }
+      {
+        encoder< back_insert_iterator< vector< uint8_t > > >
+          e( back_insert_iterator< vector< uint8_t > >( reference_buffer ), bilevel_states );
+        for ( unsigned int y = 0; y < height; ++y ) {
+          const bool typical = y > 0 ?
+            equal( &masked[ y * stride ], &masked[ ( y + 1 ) * stride ], &masked[ ( y - 1 ) * stride ] ) :
+            count( &masked[ 0 ], &masked[ stride ], 0 ) == static_cast< int >( stride );
+          e.encode( coder.num_contexts() - 1, typical );
+          if ( !typical )
+            for ( unsigned int x = 0; x < width; ++x )
+              e.encode( bilevel_context( masked, stride, width, y, x, templates[ t ] ),
+                ( masked[ y * stride + x / 8 ] >> ( 7 - x % 8 ) ) & 1 );
+        }
+      }
+      unsigned int bilevel_errors = bilevel_buffer != reference_buffer;
+      coder.reset();
+      decoder< const uint8_t* > bd( &bilevel_buffer[ 0 ], bilevel_states );
+      vector< uint8_t > decoded( stride * height );
+      for ( unsigned int y = 0; y < height; ++y )
+        coder.decode_row( bd, &decoded[ y * stride ] );
+      bilevel_errors += decoded != masked;
+      cout << "bilevel image, " << names[ t ] << ": " << bilevel_errors << " mismatch(es), " << bilevel_buffer.size()
+        << " bytes." << endl;
+      errors += bilevel_errors;
+    }
+  }
+
+  {
+    // the trees give the same bitstream as the hand-written binarizations
+    const unsigned int tu_idx = 0, fl_idx = tu_idx + tu_tree::contexts, prefix_idx = fl_idx + fl_node_tree::contexts;
+    const state_vector tree_states( prefix_idx + prefix_tree::contexts, 0 );
+    vector< unsigned int > symbols( num_decisions );
+    for ( int i = 0; i < num_decisions; ++i )
+      symbols[ i ] = rand() % 4 ? rand() % 3 : rand() % 16;
+    vector< uint8_t > tree_buffer, manual_buffer;
+    unsigned int tree_errors = 0;
+    {
+      encoder< back_insert_iterator< vector< uint8_t > > >
+        e( back_insert_iterator< vector< uint8_t > >( tree_buffer ), tree_states );
+      encoder< void > rate( tree_states );
+      for ( int i = 0; i < num_decisions; ++i ) {
+        encode_symbol< tu_tree >( e, tu_idx, symbols[ i ] % 6 );
+        encode_symbol< fl_tree >( e, 0, symbols[ i ] );
+        const unsigned int cost = symbol_cost< fl_node_tree >( e, fl_idx, symbols[ i ] % 8 );
+        rate = e;
+        encode_symbol< fl_node_tree >( rate, fl_idx, symbols[ i ] % 8 );
+        tree_errors += rate.bits() != cost;
+        encode_symbol< fl_node_tree >( e, fl_idx, symbols[ i ] % 8 );
+        encode_symbol< prefix_tree >( e, prefix_idx, symbols[ i ] % 4 );
+        encode_symbol< wide_fl_tree >( e, 0, symbols[ i ] * 17 );
+        encode_symbol< sparse_tree >( e, 0, 100 + 100 * ( symbols[ i ] % 3 ) );
+      }
+    }
+    {
+      encoder< back_insert_iterator< vector< uint8_t > > >
+        e( back_insert_iterator< vector< uint8_t > >( manual_buffer ), tree_states );
+      for ( int i = 0; i < num_decisions; ++i ) {
+        const unsigned int tu = symbols[ i ] % 6;
+        for ( unsigned int j = 0; j < tu; ++j )
+          e.encode( tu_idx + min( j, 2u ), 1 );
+        if ( tu < 5 )
+          e.encode( tu_idx + min( tu, 2u ), 0 );
+        encode_uf( e, symbols[ i ], 4 );
+        const unsigned int fl = symbols[ i ] % 8;
+        e.encode( fl_idx, fl >> 2 );
+        e.encode( fl_idx + 1 + ( fl >> 2 ), ( fl >> 1 ) & 1 );
+        e.encode( fl_idx + 3 + ( fl >> 1 ), fl & 1 );
+        const unsigned int prefix = symbols[ i ] % 4;
+        e.encode( prefix_idx, prefix != 2 );
+        if ( prefix != 2 ) {
+          e.encode_bypass( prefix != 0 );
+          if ( prefix != 0 )
+            e.encode( prefix_idx + 1, prefix == 3 );
+        }
+        encode_uf( e, symbols[ i ] * 17, 8 );
+        const unsigned int sparse = symbols[ i ] % 3;
+        e.encode_bypass( sparse == 1 );
+        if ( sparse != 1 )
+          e.encode_bypass( sparse == 2 );
+      }
+    }
+    tree_errors += tree_buffer != manual_buffer;
+    decoder< const uint8_t* > td( &tree_buffer[ 0 ], tree_states );
+    for ( int i = 0; i < num_decisions; ++i ) {
+      tree_errors += decode_symbol< tu_tree >( td, tu_idx ) != symbols[ i ] % 6;
+      tree_errors += decode_symbol< fl_tree >( td, 0 ) != symbols[ i ];
+      tree_errors += decode_symbol< fl_node_tree >( td, fl_idx ) != symbols[ i ] % 8;
+      tree_errors += decode_symbol< prefix_tree >( td, prefix_idx ) != symbols[ i ] % 4;
+      tree_errors += decode_symbol< wide_fl_tree >( td, 0 ) != symbols[ i ] * 17;
+      tree_errors += decode_symbol< sparse_tree >( td, 0 ) != 100 + 100 * ( symbols[ i ] % 3 );
+    }
+    cout << "binarization trees: " << tree_errors << " mismatch(es), " << tree_buffer.size() << " bytes." << endl;
+    errors += tree_errors;
+  }
+
+  {
+    // two blocks, the second continuing with the states of the first
+    vector< uint8_t > split_buffer;
+    vector< unsigned int > uvalues( num_decisions );
+    for ( int i = 0; i < num_decisions; ++i )
+      uvalues[ i ] = static_cast< unsigned int >( rand() ) & 0xfffff;
+    state_vector carried;
+    for ( int block = 0; block < 2; ++block ) {
+      split_encoder< back_insert_iterator< vector< uint8_t > > >
+        e( back_insert_iterator< vector< uint8_t > >( split_buffer ), block ? carried : states );
+      for ( int i = 0; i < num_decisions; ++i ) {
+        if ( indexes[ i ] == 0 )
+          e.encode_bypass( decisions[ i ] );
+        else
+          e.encode( indexes[ i ] - 1, decisions[ i ] );
+      }
+      for ( int i = 0; i < num_decisions; ++i )
+        encode_seg( e, ints[ i ], 2, 0, 20 );
+      encode_uf_array( e, &uvalues[ 0 ], num_decisions, 20 );
+      carried = e.states();
+    }
+    unsigned int split_errors = 0;
+    const uint8_t *block_start = &split_buffer[ 0 ];
+    for ( int block = 0; block < 2; ++block ) {
+      split_decoder<> sd( block_start, block ? carried : states );
+      for ( int i = 0; i < num_decisions; ++i ) {
+        if ( indexes[ i ] == 0 )
+          b = sd.decode_bypass();
+        else
+          b = sd.decode( indexes[ i ] - 1 );
+        if ( b != decisions[ i ] )
+          ++split_errors;
+      }
+      for ( int i = 0; i < num_decisions; ++i )
+        if ( decode_seg( sd, 2, 0, 20 ) != ints[ i ] )
+          ++split_errors;
+      vector< unsigned int > decoded_uvalues( num_decisions );
+      decode_uf_array( sd, &decoded_uvalues[ 0 ], num_decisions, 20 );
+      split_errors += decoded_uvalues != uvalues;
+      carried = sd.states();
+      block_start = sd.end();
+    }
+    split_errors += block_start != &split_buffer[ 0 ] + split_buffer.size();
+    cout << "split stream: " << split_errors << " decoder mismatch(es), " << split_buffer.size() << " bytes in 2 blocks."
+      << endl;
+    errors += split_errors;
+  }
+
+  for ( int carry = 0; carry < 2; ++carry ) {
+    const unsigned int max_size = 200, unit_size = 16;
+    packet_encoder pe( max_size, states, carry );
+    unsigned int packet_errors = 0;
+    for ( int i = 0; i < num_decisions; i += unit_size )
+      if ( !pe.encode( seg_unit( &ints[ i ], min< int >( unit_size, num_decisions - i ) ) ) )
+        ++packet_errors;
+    pe.finish();
+    vector< signed int > values( num_decisions );
+    state_vector packet_states = states;
+    unsigned int packets = 0, decoded = 0;
+    size_t min_size = max_size;
+    packet p;
+    while ( pe.pop( p ) ) {
+      if ( p.size() > max_size )
+        ++packet_errors;
+      if ( pe.ready() )
+        min_size = min( min_size, p.size() );
+      if ( !carry )
+        packet_states = states;
+      decoded += unit_size * decode_packet( p, packet_states,
+        seg_sink( &values[ 0 ] + decoded, &values[ 0 ] + num_decisions, unit_size ) );
+      ++packets;
+    }
+    for ( int i = 0; i < num_decisions; ++i )
+      if ( values[ i ] != ints[ i ] )
+        ++packet_errors;
+    cout << "packets of max. " << max_size << " bytes" << ( carry ? ", carried states: " : ": " ) << packet_errors
+      << " decoder mismatch(es), " << packets << " packets, min. " << min_size << " bytes." << endl;
+    errors += packet_errors;
+  }
+
+  {
+    const int shard_size = 1000;
+    const size_t num_shards = ( num_decisions + shard_size - 1 ) / shard_size;
+    const trainer::shard_function code_shard = [&]( counting_encoder< void > &e, size_t shard ) {
+      for ( int i = shard * shard_size; i < num_decisions && i < static_cast< int >( shard + 1 ) * shard_size; ++i )
+        encode_seg( e, ints[ i ], 2, 0, 20 );
+    };
+    frequency_vector serial( states.size() );
+    for ( size_t shard = 0; shard < num_shards; ++shard ) {
+      counting_encoder< void > e( states );
+      code_shard( e, shard );
+      serial += e.frequencies();
+    }
+    frequency_vector twice = serial;
+    twice += serial;
+    unsigned int training_errors = 0;
+    for ( unsigned int threads = 1; threads <= 8; threads <<= 1 ) {
+      trainer t( states, threads );
+      t.train( num_shards, code_shard );
+      if ( t.frequencies() != serial || t.initialization_vector() != initialization_vector( serial ) )
+        ++training_errors;
+      // the workers are reused by further calls
+      t.train( num_shards, code_shard );
+      if ( t.frequencies() != twice )
+        ++training_errors;
+    }
+    // incremental training from saved frequencies
+    stringstream ss;
+    write_frequencies( ss, serial );
+    frequency_vector saved;
+    trainer t( states, 4 );
+    if ( !read_frequencies( ss, saved ) || saved != serial )
+      ++training_errors;
+    t.add( saved );
+    t.train( num_shards, code_shard );
+    serial += serial;
+    if ( t.frequencies() != serial )
+      ++training_errors;
+    cout << "training, " << num_shards << " shards: " << training_errors << " mismatch(es)." << endl;
+    errors += training_errors;
+  }
+
+  {
+    unsigned int rate_errors = 0;
+    ueg_rate rate( 2, 0, 20 );
+    rate.update( states );
+    for ( int i = 0; i < num_decisions; ++i ) {
+      encoder< void > e( states );
+      encode_seg( e, ints[ i ], 2, 0, 20 );
+      if ( rate.seg( ints[ i ] ) != e.bits() || seg_bits( states, ints[ i ], 2, 0, 20 ) != e.bits() )
+        ++rate_errors;
+      const state_vector::size_type idx = i % states.size();
+      const unsigned int n = i % 100;
+      encoder< void > r( states );
+      for ( unsigned int j = 0; j < n; ++j )
+        r.encode( idx, states[ idx ] & 1 );
+      if ( run_bits( states[ idx ], n ) != r.bits() )
+        ++rate_errors;
+      r.encode( idx, !( states[ idx ] & 1 ) );
+      if ( run_bits( states[ idx ], n, true ) != r.bits() )
+        ++rate_errors;
+    }
+    cout << "rate estimation: " << rate_errors << " mismatch(es)." << endl;
+    errors += rate_errors;
+  }
+
+  {
+    // raw bytes inserted after every 100 decisions
+    vector< uint8_t > raw_buffer, raw( 256 );
+    for ( unsigned int i = 0; i < raw.size(); ++i )
+      raw[ i ] = rand();
+    {
+      encoder< back_insert_iterator< vector< uint8_t > > > e( back_insert_iterator< vector< uint8_t > >( raw_buffer ), states );
+      for ( int i = 0; i < num_decisions; ++i ) {
+        if ( indexes[ i ] == 0 )
+          e.encode_bypass( decisions[ i ] );
+        else
+          e.encode( indexes[ i ] - 1, decisions[ i ] );
+        if ( i % 100 == 99 )
+          e.encode_raw( raw.begin() + i % 200, i % 57 );
+      }
+    }
+    decoder< const uint8_t* > rd( &raw_buffer[ 0 ], states );
+    unsigned int raw_errors = 0;
+    for ( int i = 0; i < num_decisions; ++i ) {
+      if ( indexes[ i ] == 0 )
+        b = rd.decode_bypass();
+      else
+        b = rd.decode( indexes[ i ] - 1 );
+      if ( b != decisions[ i ] )
+        ++raw_errors;
+      if ( i % 100 == 99 && !equal( raw.begin() + i % 200, raw.begin() + i % 200 + i % 57, rd.decode_raw( i % 57 ) ) )
+        ++raw_errors;
+    }
+    cout << "raw bytes: " << raw_errors << " decoder mismatch(es), " << raw_buffer.size() << " bytes." << endl;
+    errors += raw_errors;
+  }
+
+  {
+    // arrays coded in bulk must give the same bitstream as the scalar binarizations
+    typedef back_insert_iterator< vector< uint8_t > > iter_type;
+    vector< unsigned int > uvalues( num_decisions );
+    for ( int i = 0; i < num_decisions; ++i )
+      uvalues[ i ] = rand() % 8 ? rand() % 100 : static_cast< unsigned int >( rand() ) * 2654435761u;
+    vector< uint8_t > scalar_buffer, array_buffer;
+    {
+      encoder< iter_type > e( iter_type( scalar_buffer ), states );
+      for ( int i = 0; i < num_decisions; ++i )
+        encode_seg( e, ints[ i ], 2, 0, 10 );
+      for ( int i = 0; i < num_decisions; ++i )
+        encode_ueg( e, uvalues[ i ] >> 1, 0 );
+      for ( int i = 0; i < num_decisions; ++i )
+        encode_uf( e, uvalues[ i ] & 0x1ffff, 17 );
+    }
+    {
+      encoder< iter_type > e( iter_type( array_buffer ), states );
+      encode_seg_array( e, &ints[ 0 ], num_decisions, 2, 0, 10 );
+      vector< unsigned int > halves( num_decisions ), low_bits( num_decisions );
+      for ( int i = 0; i < num_decisions; ++i ) {
+        halves[ i ] = uvalues[ i ] >> 1;
+        low_bits[ i ] = uvalues[ i ] & 0x1ffff;
+      }
+      encode_ueg_array( e, &halves[ 0 ], num_decisions, 0 );
+      encode_uf_array( e, &low_bits[ 0 ], num_decisions, 17 );
+    }
+    unsigned int array_errors = scalar_buffer != array_buffer;
+    decoder< const uint8_t* > ad( &array_buffer[ 0 ], states );
+    vector< int > decoded_ints( num_decisions );
+    vector< unsigned int > decoded_halves( num_decisions ), decoded_low_bits( num_decisions );
+    decode_seg_array( ad, &decoded_ints[ 0 ], num_decisions, 2, 0, 10 );
+    decode_ueg_array( ad, &decoded_halves[ 0 ], num_decisions, 0 );
+    decode_uf_array( ad, &decoded_low_bits[ 0 ], num_decisions, 17 );
+    for ( int i = 0; i < num_decisions; ++i )
+      if ( decoded_ints[ i ] != ints[ i ] || decoded_halves[ i ] != uvalues[ i ] >> 1 ||
+          decoded_low_bits[ i ] != ( uvalues[ i ] & 0x1ffff ) )
+        ++array_errors;
+    cout << "integer arrays: " << array_errors << " mismatch(es), " << array_buffer.size() << " bytes." << endl;
+    errors += array_errors;
+  }
+
+  {
+    // limited prefix with a 32 bin escape, including the extremes of the value range
+    const unsigned int max_prefix = 12, escape_bits = 32;
+    vector< unsigned int > uvalues( num_decisions );
+    for ( int i = 0; i < num_decisions; ++i )
+      uvalues[ i ] = i % 4 == 3 ? ~0u - i % 8 : rand() % 8 ? rand() % 100 : static_cast< unsigned int >( rand() ) * 2654435761u;
+    vector< uint8_t > limited_buffer;
+    unsigned int limited_errors = 0;
+    {
+      encoder< back_insert_iterator< vector< uint8_t > > > e( back_insert_iterator< vector< uint8_t > >( limited_buffer ), states );
+      ueg_rate rate( 1, 0, 10, max_prefix, escape_bits );
+      for ( int i = 0; i < num_decisions; ++i ) {
+        rate.update( e.states() );
+        encoder< void > r( e.states() );
+        encode_ueg_limited( r, uvalues[ i ], 1, max_prefix, escape_bits, 0, 10 );
+        if ( rate( uvalues[ i ] ) != r.bits() || ueg_limited_bits( e.states(), uvalues[ i ], 1, max_prefix, escape_bits, 0, 10 ) != r.bits() )
+          ++limited_errors;
+        encode_ueg_limited( e, uvalues[ i ], 1, max_prefix, escape_bits, 0, 10 );
+        encoder< void > s( e.states() );
+        encode_seg_limited( s, ints[ i ], 0, max_prefix, escape_bits );
+        if ( seg_limited_bits( e.states(), ints[ i ], 0, max_prefix, escape_bits ) != s.bits() )
+          ++limited_errors;
+        encode_seg_limited( e, ints[ i ], 0, max_prefix, escape_bits );
+        // bypass bins only, so that the bit count is the bin count
+        if ( eg_length( uvalues[ i ], 0, max_prefix, escape_bits ) > ueg_limited_max_bins( 0, max_prefix, escape_bits ) )
+          ++limited_errors;
+        if ( uvalues[ i ] < 4095 && eg_length( uvalues[ i ], 0, max_prefix, escape_bits ) != eg_length( uvalues[ i ], 0 ) )
+          ++limited_errors;
+      }
+    }
+    decoder< const uint8_t* > ld( &limited_buffer[ 0 ], states );
+    for ( int i = 0; i < num_decisions; ++i ) {
+      if ( decode_ueg_limited( ld, 1, max_prefix, escape_bits, 0, 10 ) != uvalues[ i ] )
+        ++limited_errors;
+      if ( decode_seg_limited( ld, 0, max_prefix, escape_bits ) != ints[ i ] )
+        ++limited_errors;
+    }
+    // a stream of ones must not make the decoder read more than the worst case
+    vector< uint8_t > ones( 1024, 0xff );
+    uint64_t position = 0;
+    decoder< const uint8_t*, bit_counter > od( &ones[ 0 ], states, bit_counter( &position ) );
+    for ( unsigned int p = 1; p <= 20; ++p ) {
+      for ( unsigned int k = 0; k + p <= 32 && k < 12; k += 3 ) {
+        const uint64_t before = position;
+        decode_ueg_limited( od, k, p, escape_bits );
+        if ( position - before > ueg_limited_max_bins( k, p, escape_bits ) )
+          ++limited_errors;
+      }
+    }
+    cout << "limited Exp-Golomb: " << limited_errors << " mismatch(es), " << limited_buffer.size() << " bytes, max. "
+      << ueg_limited_max_bins( 1, max_prefix, escape_bits, 10 ) << " bins per value." << endl;
+    errors += limited_errors;
+  }
+
+  {
+    // blocks of 4 (chroma DC), 15, 16 and 64 coefficients, the latter with mapped contexts
+    const unsigned int sizes[] = { 4, 15, 16, 64 };
+    uint8_t map64[ 64 ];
+    for ( unsigned int i = 0; i < 64; ++i )
+      map64[ i ] = i / 4;
+    const unsigned int num_blocks = num_decisions / 16;
+    vector< int16_t > coeffs( num_blocks * 64 ), decoded( 64 );
+    vector< unsigned int > block_sizes( num_blocks );
+    for ( unsigned int b = 0; b < num_blocks; ++b ) {
+      block_sizes[ b ] = sizes[ rand() % 4 ];
+      int16_t *c = &coeffs[ b * 64 ];
+      for ( unsigned int i = 0; i < block_sizes[ b ]; ++i )
+        if ( rand() % 5 < 2 )
+          c[ i ] = ( rand() % 4 ? 1 + rand() % 3 : rand() % 20 ? rand() % 40 : rand() % 30000 ) * ( rand() % 2 ? -1 : 1 );
+      c[ rand() % block_sizes[ b ] ] = -1;
+    }
+    const state_vector block_states( 42, 20 );
+    vector< uint8_t > block_buffer;
+    {
+      encoder< back_insert_iterator< vector< uint8_t > > > e( back_insert_iterator< vector< uint8_t > >( block_buffer ), block_states );
+      for ( unsigned int b = 0; b < num_blocks; ++b ) {
+        const block_contexts ctx = { 0, 16, 32, block_sizes[ b ] == 64 ? map64 : 0, block_sizes[ b ] == 64 ? map64 : 0,
+          block_sizes[ b ] == 4 ? 3u : 4u };
+        encode_block( e, &coeffs[ b * 64 ], block_sizes[ b ], ctx );
+      }
+    }
+    decoder< const uint8_t* > bd( &block_buffer[ 0 ], block_states );
+    unsigned int block_errors = 0;
+    for ( unsigned int b = 0; b < num_blocks; ++b ) {
+      const block_contexts ctx = { 0, 16, 32, block_sizes[ b ] == 64 ? map64 : 0, block_sizes[ b ] == 64 ? map64 : 0,
+        block_sizes[ b ] == 4 ? 3u : 4u };
+      const int16_t *c = &coeffs[ b * 64 ];
+      const unsigned int nonzero = decode_block( bd, &decoded[ 0 ], block_sizes[ b ], ctx );
+      if ( !equal( c, c + block_sizes[ b ], decoded.begin() ) ||
+          nonzero != block_sizes[ b ] - count( c, c + block_sizes[ b ], 0 ) )
+        ++block_errors;
+    }
+    cout << "residual blocks: " << block_errors << " decoder mismatch(es), " << block_buffer.size() << " bytes." << endl;
+    errors += block_errors;
+  }
+
+  {
+    // appending in sessions of up to 1000 decisions, each of which leaves a terminated bitstream
+    typedef back_insert_iterator< vector< uint8_t > > iter_type;
+    vector< uint8_t > one_pass, appended;
+    {
+      encoder< iter_type > e( iter_type( one_pass ), states );
+      for ( int i = 0; i < num_decisions; ++i )
+        if ( indexes[ i ] == 0 )
+          e.encode_bypass( decisions[ i ] );
+        else
+          e.encode( indexes[ i ] - 1, decisions[ i ] );
+    }
+    stringstream tail_file;
+    encoder_state tail;
+    unsigned int append_errors = 0;
+    for ( int first = 0; first < num_decisions; ) {
+      const int last = min( num_decisions, first + 1 + rand() % 1000 );
+      if ( first ) {
+        tail_file.seekg( 0 );
+        if ( !read_encoder_state( tail_file, tail ) )
+          ++append_errors;
+        appended.resize( tail.bytes );
+      }
+      {
+        encoder< iter_type > e( iter_type( appended ), states );
+        if ( first )
+          e.restore( tail, iter_type( appended ) );
+        for ( int i = first; i < last; ++i )
+          if ( indexes[ i ] == 0 )
+            e.encode_bypass( decisions[ i ] );
+          else
+            e.encode( indexes[ i ] - 1, decisions[ i ] );
+        e.save( tail );
+      }
+      tail_file.str( "" );
+      write_encoder_state( tail_file, tail );
+      // the terminated bitstream decodes after each session
+      decoder< const uint8_t* > ad( &appended[ 0 ], states );
+      for ( int i = 0; i < last; ++i )
+        if ( ( indexes[ i ] == 0 ? ad.decode_bypass() : ad.decode( indexes[ i ] - 1 ) ) != decisions[ i ] )
+          ++append_errors;
+      first = last;
+    }
+    if ( appended != one_pass )
+      ++append_errors;
+    // malformed states are rejected: a range below 256, a context state of 128, an incomplete byte with
+    // bits set below the next bit, and a state vector longer than the file
+    const string valid = tail_file.str();
+    const size_t range_pos = 18, byte_pos = 24, size_pos = 26, states_pos = 30;
+    for ( int m = 0; m < 4; ++m ) {
+      string malformed = valid;
+      if ( m == 0 ) {
+        malformed[ range_pos ] = static_cast< char >( 0xff );
+        malformed[ range_pos + 1 ] = 0;
+      } else if ( m == 1 ) {
+        malformed[ states_pos ] = static_cast< char >( 128 );
+      } else if ( m == 2 ) {
+        malformed[ byte_pos ] = static_cast< char >( 0xff );
+      } else {
+        malformed[ size_pos + 3 ] = 0x7f;
+      }
+      stringstream malformed_file( malformed );
+      encoder_state rejected;
+      if ( read_encoder_state( malformed_file, rejected ) )
+        ++append_errors;
+    }
+    cout << "appending: " << append_errors << " mismatch(es), " << appended.size() << " bytes." << endl;
+    errors += append_errors;
+  }
+
+  {
+    // resync points at least every 64 bytes, each decoded to the end of the stream from a serialized index
+    vector< uint8_t > indexed;
+    seek_index index( 64, 4 );
+    {
+      encoder< back_insert_iterator< vector< uint8_t > > > e( back_insert_iterator< vector< uint8_t > >( indexed ), states );
+      for ( int i = 0; i < num_decisions; ++i ) {
+        index.add_if_due( e, i );
+        if ( indexes[ i ] == 0 )
+          e.encode_bypass( decisions[ i ] );
+        else
+          e.encode( indexes[ i ] - 1, decisions[ i ] );
+      }
+    }
+    stringstream index_file;
+    write_seek_index( index_file, index );
+    seek_index read_index;
+    unsigned int seek_errors = !read_seek_index( index_file, read_index ) || read_index.size() != index.size();
+    resync_point point;
+    for ( size_t j = 0; j < read_index.size(); j += 1 + rand() % 8 ) {
+      read_index.get( j, point );
+      decoder< const uint8_t* > sd( &indexed[ 0 ], point );
+      for ( int i = read_index.position( j ); i < num_decisions; ++i )
+        if ( ( indexes[ i ] == 0 ? sd.decode_bypass() : sd.decode( indexes[ i ] - 1 ) ) != decisions[ i ] )
+          ++seek_errors;
+      if ( index.find( read_index.position( j ) ) != j )
+        ++seek_errors;
+    }
+    // corrupt files are either rejected or give valid resync points
+    const string file = index_file.str();
+    unsigned int rejected = 0;
+    for ( size_t pos = 0; pos < file.size(); ++pos ) {
+      string corrupt = file;
+      corrupt[ pos ] = static_cast< char >( pos & 1 ? 0xff : 0x80 );
+      stringstream corrupt_file( corrupt );
+      seek_index corrupt_index;
+      if ( !read_seek_index( corrupt_file, corrupt_index ) ) {
+        ++rejected;
+        continue;
+      }
+      for ( size_t j = 0; j < corrupt_index.size(); ++j ) {
+        corrupt_index.get( j, point );
+        if ( point.states.size() != states.size() || point.range < 0x100 || point.range >= 0x200 )
+          ++seek_errors;
+        for ( size_t c = 0; c < point.states.size(); ++c )
+          seek_errors += point.states[ c ] >= 128;
+      }
+    }
+    cout << "seek index: " << seek_errors << " decoder mismatch(es), " << index.size() << " entries, "
+      << index.data_size() << " bytes of states, " << rejected << " of " << file.size() << " corrupt files rejected." << endl;
+    errors += seek_errors;
+  }
+
+  for ( unsigned int max_bytes = 4096; max_bytes <= 1 << 20; max_bytes <<= 8 ) {
+    // thousands of contexts spread over the whole index range, replaced if the memory budget is small
+    typedef back_insert_iterator< vector< uint8_t > > iter_type;
+    const int num_dense = 256 * ( num_states + 1 );
+    vector< uint32_t > dense_idx( num_decisions );
+    vector< bool > used( num_dense );
+    int num_used = 0;
+    for ( int i = 0; i < num_decisions; ++i ) {
+      dense_idx[ i ] = indexes[ i ] + ( i % 256 ) * ( num_states + 1 );
+      num_used += !used[ dense_idx[ i ] ];
+      used[ dense_idx[ i ] ] = true;
+    }
+    vector< uint8_t > sparse_buffer;
+    sparse_states sparse( max_bytes, 20 );
+    unsigned int sparse_errors = 0;
+    {
+      encoder< iter_type, null_observer, sparse_states > e( iter_type( sparse_buffer ), sparse );
+      encoder< void, null_observer, sparse_states > v( sparse );
+      encoder< void > dense_v( state_vector( num_dense, 20 ) );
+      for ( int i = 0; i < num_decisions; ++i ) {
+        if ( i + 1 < num_decisions )
+          e.states().prefetch( dense_idx[ i + 1 ] * 0x2545f491u );
+        e.encode( dense_idx[ i ] * 0x2545f491u, decisions[ i ] );
+        v.encode( dense_idx[ i ] * 0x2545f491u, decisions[ i ] );
+        dense_v.encode( dense_idx[ i ], decisions[ i ] );
+      }
+      sparse = e.states();
+      if ( v.states().touched() != sparse.touched() || v.states().evictions() != sparse.evictions() )
+        ++sparse_errors;
+      // without replacement, the estimate is the same as with a state vector
+      if ( !sparse.evictions() && v.bits() != dense_v.bits() )
+        ++sparse_errors;
+    }
+    // 64 buckets of 12 contexts fit into the smallest budget
+    if ( max_bytes == 4096 && num_used > 64 * 12 && !sparse.evictions() )
+      ++sparse_errors;
+    decoder< const uint8_t*, null_observer, sparse_states > sd( &sparse_buffer[ 0 ], sparse_states( max_bytes, 20 ) );
+    for ( int i = 0; i < num_decisions; ++i )
+      if ( sd.decode( dense_idx[ i ] * 0x2545f491u ) != decisions[ i ] )
+        ++sparse_errors;
+    if ( sd.states().touched() != sparse.touched() || sd.states().evictions() != sparse.evictions() )
+      ++sparse_errors;
+    // without replacement, the bitstream is the same as with a state vector
+    if ( !sparse.evictions() ) {
+      vector< uint8_t > dense_buffer;
+      {
+        encoder< iter_type > e( iter_type( dense_buffer ), state_vector( num_dense, 20 ) );
+        for ( int i = 0; i < num_decisions; ++i )
+          e.encode( dense_idx[ i ], decisions[ i ] );
+      }
+      if ( dense_buffer != sparse_buffer )
+        ++sparse_errors;
+    }
+    cout << "sparse states, " << max_bytes << " bytes: " << sparse_errors << " decoder mismatch(es), "
+      << sparse.touched() << " of " << num_used << " contexts, " << sparse.evictions() << " evictions." << endl;
+    errors += sparse_errors;
+  }
+
+  // messages of 0 to 63 decisions for the batch kernels, encoded by the scalar engine for reference
+  vector< uint32_t > message_idx( num_decisions );
+  vector< uint8_t > message_bins( decisions.begin(), decisions.end() );
+  for ( int i = 0; i < num_decisions; ++i )
+    message_idx[ i ] = indexes[ i ] ? indexes[ i ] - 1 : kernel_bypass;
+  vector< batch_encode_message > messages;
+  vector< kernel_bitstream > message_streams;
+  for ( int i = 0, n = 0; i < num_decisions; i += n, n = rand() % 64 ) {
+    const batch_encode_message m = { &message_idx[ i ], &message_bins[ i ], min< size_t >( n, num_decisions - i ) };
+    messages.push_back( m );
+    message_streams.push_back( kernel_bitstream() );
+    kernel_encoder e( back_insert_iterator< kernel_bitstream >( message_streams.back() ), states );
+    for ( size_t j = 0; j < m.num; ++j ) {
+      if ( m.idx[ j ] == kernel_bypass )
+        e.encode_bypass( m.bins[ j ] );
+      else
+        e.encode( m.idx[ j ], m.bins[ j ] );
+    }
+  }
+
+  const char *variants[] = { "generic", "lzcnt", "bmi2", "avx2", "avx512" };
+  for ( unsigned int v = 0; v < sizeof( variants ) / sizeof( *variants ); ++v ) {
+    const kernel_table *k = find_kernels( variants[ v ] );
+    if ( !k ) {
+      cout << "kernels " << variants[ v ] << ": not available." << endl;
+      continue;
+    }
+    vector< uint32_t > idx( num_decisions );
+    vector< uint8_t > bins( num_decisions );
+    vector< signed int > values( num_decisions );
+    for ( int i = 0; i < num_decisions; ++i )
+      idx[ i ] = indexes[ i ] ? indexes[ i ] - 1 : kernel_bypass;
+    kernel_decoder kd( &buffer[ 0 ], states );
+    k->decode_decisions( kd, &idx[ 0 ], &bins[ 0 ], num_decisions );
+    k->decode_seg( kd, 2, 0, 20, &values[ 0 ], num_decisions );
+    unsigned int kernel_errors = 0;
+    for ( int i = 0; i < num_decisions; ++i ) {
+      if ( bins[ i ] != decisions[ i ] )
+        ++kernel_errors;
+      if ( values[ i ] != ints[ i ] )
+        ++kernel_errors;
+    }
+    vector< kernel_bitstream > batch_streams( messages.size() );
+    k->encode_batch( states, &messages[ 0 ], messages.size(), &batch_streams[ 0 ] );
+    vector< uint8_t > batch_bins( num_decisions + 1 );
+    vector< batch_decode_message > decode_messages;
+    for ( size_t i = 0; i < messages.size(); ++i ) {
+      if ( batch_streams[ i ] != message_streams[ i ] )
+        ++kernel_errors;
+      const batch_decode_message m = { &message_streams[ i ][ 0 ], message_streams[ i ].size(), messages[ i ].idx,
+        &batch_bins[ messages[ i ].bins - &message_bins[ 0 ] ], messages[ i ].num };
+      decode_messages.push_back( m );
+    }
+    k->decode_batch( states, &decode_messages[ 0 ], decode_messages.size() );
+    batch_bins.pop_back();
+    if ( batch_bins != message_bins )
+      ++kernel_errors;
+    cout << "kernels " << k->name << ", " << k->batch_lanes << " lane(s): " << kernel_errors << " decoder mismatch(es)." << endl;
+    errors += kernel_errors;
+  }
+
   if ( d.frequencies() == freq_enc ) {
     cout << "Number of encoded and decoded decisions matches." << endl;
     return errors ? 1 : 0;
@@ -0,0 +1,148 @@
+//
+// This file is part of libcabac.
+//
+// Copyright 2008 Johannes Ballé <balle@ient.rwth-aachen.de>
+//
+// libcabac is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libcabac is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libcabac.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <cabac/trace.h>
+#include <istream>
+#include <ostream>
+#include <cstring>
+
+namespace cabac {
+
+namespace {
+
+const char trace_magic[ 8 ] = { 'C', 'A', 'B', 'A', 'C', 'T', 'R', '1' };
+
+// dumps are stored little endian, independent of the host
+void put( ::std::ostream &os, uint64_t value, unsigned int bytes ) {
+  while ( bytes-- ) {
+    os.put( static_cast< char >( value & 0xff ) );
+    value >>= 8;
+  }
+}
+
+bool get( ::std::istream &is, uint64_t &value, const unsigned int bytes ) {
+  value = 0;
+  for ( unsigned int i = 0; i < bytes; ++i ) {
+    const int c = is.get();
+    if ( c == ::std::istream::traits_type::eof() )
+      return false;
+    value |= static_cast< uint64_t >( c & 0xff ) << ( 8 * i );
+  }
+  return true;
+}
+
+}
+
+trace_buffer::trace_buffer( ::std::size_t capacity ) :
+  _head( 0 ),
+  _first( 0 ) {
+  ::std::size_t size = 1;
+  while ( size < capacity )
+    size <<= 1;
+  _slots.reset( new slot[ size ] );
+  for ( ::std::size_t i = 0; i < size; ++i ) {
+    _slots[ i ].seq.store( 0, ::std::memory_order_relaxed );
+    _slots[ i ].words[ 0 ].store( 0, ::std::memory_order_relaxed );
+    _slots[ i ].words[ 1 ].store( 0, ::std::memory_order_relaxed );
+  }
+  _size = size;
+  _mask = size - 1;
+}
+
+uint64_t trace_buffer::snapshot( ::std::vector< trace_record > &records ) const {
+  const uint64_t head = _head.load( ::std::memory_order_acquire );
+  const uint64_t cleared = _first.load( ::std::memory_order_acquire );
+  uint64_t first = head > _size ? head - _size : 0;
+  if ( first < cleared )
+    first = cleared < head ? cleared : head;
+  records.clear();
+  records.reserve( head - first );
+  for ( uint64_t i = first; i < head; ++i ) {
+    const slot &s = _slots[ i & _mask ];
+    const uint64_t seq = s.seq.load( ::std::memory_order_acquire );
+    uint64_t words[ 2 ];
+    words[ 0 ] = s.words[ 0 ].load( ::std::memory_order_relaxed );
+    words[ 1 ] = s.words[ 1 ].load( ::std::memory_order_relaxed );
+    ::std::atomic_thread_fence( ::std::memory_order_acquire );
+    if ( seq != 2 * i + 2 || s.seq.load( ::std::memory_order_relaxed ) != seq ) {
+      // overwritten by a newer record, and so are all records before it
+      records.clear();
+      first = i + 1;
+      continue;
+    }
+    trace_record r;
+    ::std::memcpy( &r, words, sizeof( r ) );
+    records.push_back( r );
+  }
+  return first - cleared;
+}
+
+void trace_buffer::clear() {
+  _first.store( _head.load( ::std::memory_order_relaxed ), ::std::memory_order_release );
+}
+
+trace_buffer& trace_buffer::local() {
+  static thread_local trace_buffer buffer;
+  return buffer;
+}
+
+void write_trace( ::std::ostream &os, const uint64_t first, const ::std::vector< trace_record > &records ) {
+  os.write( trace_magic, sizeof( trace_magic ) );
+  put( os, first, 8 );
+  put( os, records.size(), 8 );
+  for ( ::std::vector< trace_record >::const_iterator r = records.begin(); r != records.end(); ++r ) {
+    put( os, r->position, 4 );
+    put( os, r->idx, 4 );
+    put( os, r->range, 2 );
+    put( os, r->low, 2 );
+    put( os, r->state, 1 );
+    put( os, r->bin_val, 1 );
+    put( os, r->kind, 1 );
+    put( os, r->reserved, 1 );
+  }
+}
+
+bool read_trace( ::std::istream &is, uint64_t &first, ::std::vector< trace_record > &records ) {
+  char magic[ sizeof( trace_magic ) ];
+  if ( !is.read( magic, sizeof( magic ) ) || ::std::memcmp( magic, trace_magic, sizeof( magic ) ) )
+    return false;
+  uint64_t size;
+  if ( !get( is, first, 8 ) || !get( is, size, 8 ) )
+    return false;
+  records.clear();
+  for ( uint64_t i = 0; i < size; ++i ) {
+    uint64_t position, idx, range, low, state, bin_val, kind, reserved;
+    if ( !get( is, position, 4 ) || !get( is, idx, 4 ) || !get( is, range, 2 ) || !get( is, low, 2 ) ||
+        !get( is, state, 1 ) || !get( is, bin_val, 1 ) || !get( is, kind, 1 ) || !get( is, reserved, 1 ) )
+      return false;
+    trace_record r;
+    r.position = position;
+    r.idx = idx;
+    r.range = range;
+    r.low = low;
+    r.state = state;
+    r.bin_val = bin_val;
+    r.kind = kind;
+    r.reserved = reserved;
+    records.push_back( r );
+  }
+  return true;
+}
+
+}
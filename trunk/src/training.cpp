@@ -0,0 +1,172 @@
+//
+// This file is part of libcabac.
+//
+// Copyright 2008 Johannes Ballé <balle@ient.rwth-aachen.de>
+//
+// libcabac is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// libcabac is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with libcabac.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <cabac/training.h>
+#include "binary-io.h"
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+
+namespace cabac {
+
+namespace {
+
+const char frequencies_magic[ 8 ] = { 'C', 'A', 'B', 'A', 'C', 'F', 'V', '1' };
+
+void work( const state_vector &states, const trainer::shard_function &f, ::std::atomic< ::std::size_t > &next,
+    const ::std::size_t num, frequency_vector &frequencies ) {
+  for ( ::std::size_t shard = next++; shard < num; shard = next++ ) {
+    counting_encoder< void > e( states );
+    f( e, shard );
+    frequencies += e.frequencies();
+  }
+}
+
+}
+
+// worker threads, kept between calls to train()
+struct trainer::pool {
+  ::std::vector< ::std::thread > threads;
+  ::std::mutex mutex;
+  ::std::condition_variable start, done;
+  // incremented for each call to train(), stop ends the threads
+  uint64_t generation;
+  bool stop;
+  unsigned int running;
+  // the current job, worker i accumulates to partial[ i + 1 ]
+  const shard_function *f;
+  ::std::size_t num;
+  ::std::atomic< ::std::size_t > next;
+  ::std::vector< frequency_vector > partial;
+
+  pool() :
+    generation( 0 ),
+    stop( false ),
+    running( 0 ),
+    f( 0 ),
+    num( 0 ),
+    next( 0 ) {
+  }
+
+  void run( const state_vector &states, const unsigned int i ) {
+    uint64_t seen = 0;
+    for ( ;; ) {
+      {
+        ::std::unique_lock< ::std::mutex > lock( mutex );
+        while ( !stop && generation == seen )
+          start.wait( lock );
+        if ( stop )
+          return;
+        seen = generation;
+      }
+      work( states, *f, next, num, partial[ i + 1 ] );
+      ::std::lock_guard< ::std::mutex > lock( mutex );
+      if ( !--running )
+        done.notify_one();
+    }
+  }
+};
+
+trainer::trainer( const state_vector &states, const unsigned int threads ) :
+  _states( states ),
+  _threads( threads ? threads : ::std::max( ::std::thread::hardware_concurrency(), 1u ) ),
+  _frequencies( states.size() ) {
+}
+
+trainer::~trainer() {
+  if ( !_pool )
+    return;
+  {
+    ::std::lock_guard< ::std::mutex > lock( _pool->mutex );
+    _pool->stop = true;
+  }
+  _pool->start.notify_all();
+  for ( ::std::size_t i = 0; i < _pool->threads.size(); ++i )
+    _pool->threads[ i ].join();
+}
+
+void trainer::train( const ::std::size_t num, const shard_function &f ) {
+  if ( !num )
+    return;
+  if ( !_pool ) {
+    _pool.reset( new pool );
+    _pool->partial.assign( _threads, frequency_vector( _states.size() ) );
+    _pool->threads.reserve( _threads - 1 );
+    for ( unsigned int i = 0; i + 1 < _threads; ++i )
+      _pool->threads.push_back( ::std::thread( &pool::run, _pool.get(), ::std::cref( _states ), i ) );
+  }
+  pool &p = *_pool;
+  for ( unsigned int i = 0; i < _threads; ++i )
+    ::std::fill( p.partial[ i ].begin(), p.partial[ i ].end(), frequency_vector::value_type( 0, 0 ) );
+  {
+    ::std::lock_guard< ::std::mutex > lock( p.mutex );
+    p.f = &f;
+    p.num = num;
+    p.next = 0;
+    p.running = _threads - 1;
+    ++p.generation;
+  }
+  p.start.notify_all();
+  // the calling thread is a worker as well
+  work( _states, f, p.next, num, p.partial[ 0 ] );
+  {
+    ::std::unique_lock< ::std::mutex > lock( p.mutex );
+    while ( p.running )
+      p.done.wait( lock );
+  }
+  // tree reduction, the result is identical for any number of workers
+  for ( unsigned int step = 1; step < _threads; step <<= 1 )
+    for ( unsigned int i = 0; i + step < _threads; i += step << 1 )
+      p.partial[ i ] += p.partial[ i + step ];
+  _frequencies += p.partial[ 0 ];
+}
+
+void trainer::add( const frequency_vector &f ) {
+  _frequencies += f;
+}
+
+void write_frequencies( ::std::ostream &os, const frequency_vector &f ) {
+  os.write( frequencies_magic, sizeof( frequencies_magic ) );
+  impl::put( os, f.size(), 4 );
+  for ( frequency_vector::size_type i = 0; i < f.size(); ++i ) {
+    impl::put( os, f[ i ].first, 4 );
+    impl::put( os, f[ i ].second, 4 );
+  }
+}
+
+bool read_frequencies( ::std::istream &is, frequency_vector &f ) {
+  char magic[ sizeof( frequencies_magic ) ];
+  if ( !is.read( magic, sizeof( magic ) ) ||
+      !::std::equal( magic, magic + sizeof( magic ), frequencies_magic ) )
+    return false;
+  uint64_t size, first, second;
+  if ( !impl::get( is, size, 4 ) )
+    return false;
+  f.clear();
+  for ( uint64_t i = 0; i < size; ++i ) {
+    if ( !impl::get( is, first, 4 ) || !impl::get( is, second, 4 ) )
+      return false;
+    f.push_back( frequency_vector::value_type( first, second ) );
+  }
+  return true;
+}
+
+}